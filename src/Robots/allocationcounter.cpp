@@ -0,0 +1,343 @@
+/**
+* @file allocationcounter.cpp
+* @brief Implementation of the AllocationCounter class, which counts heap allocations, and of the TickStatistics class,
+* which reports them per simulation tick.
+* @details The counting is compiled in only with the ROBOTS_COUNT_ALLOCATIONS option, which replaces the global
+* operator new, including its aligned forms. Qt containers such as QPolygonF and QPainterPath allocate with malloc
+* instead, so with the GNU C library malloc, calloc, realloc, memalign, aligned_alloc and posix_memalign are replaced
+* as well and operator new is counted through them. Other C libraries only count operator new. Without the option
+* nothing is replaced and the counts stay at zero.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "allocationcounter.h"
+
+#ifdef ROBOTS_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<quint64> allocationCount{0};
+static std::atomic<quint64> allocatedBytes{0};
+
+/**
+ * @brief Records one allocation, it may be called from any thread.
+ * @param size Size of the allocation in bytes.
+ */
+static void record(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t count, std::size_t size);
+extern "C" void *__libc_realloc(void *pointer, std::size_t size);
+extern "C" void *__libc_memalign(std::size_t alignment, std::size_t size);
+
+// The definitions in the executable take the place of the ones of the C library, also for the Qt libraries
+extern "C" void *malloc(std::size_t size) noexcept
+{
+    record(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(std::size_t count, std::size_t size) noexcept
+{
+    record(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, std::size_t size) noexcept
+{
+    record(size);
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void *memalign(std::size_t alignment, std::size_t size) noexcept
+{
+    record(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+{
+    record(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **pointer, std::size_t alignment, std::size_t size) noexcept
+{
+    if (alignment == 0 || alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    record(size);
+    void *result = __libc_memalign(alignment, size);
+    if (result == nullptr)
+        return ENOMEM;
+
+    *pointer = result;
+    return 0;
+}
+
+/**
+ * @brief Allocates memory for operator new, counted by the replaced malloc.
+ */
+static void *allocate(std::size_t size)
+{
+    return std::malloc(size > 0 ? size : 1);
+}
+
+/**
+ * @brief Allocates aligned memory for operator new, counted by the replaced posix_memalign.
+ */
+static void *allocateAligned(std::size_t size, std::size_t alignment)
+{
+    void *pointer = nullptr;
+    if (posix_memalign(&pointer, alignment < sizeof(void*) ? sizeof(void*) : alignment, size > 0 ? size : 1) != 0)
+        return nullptr;
+
+    return pointer;
+}
+#else
+/**
+ * @brief Allocates and counts memory for operator new.
+ */
+static void *allocate(std::size_t size)
+{
+    record(size);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+/**
+ * @brief Allocates and counts aligned memory for operator new.
+ */
+static void *allocateAligned(std::size_t size, std::size_t alignment)
+{
+    record(size);
+
+    void *pointer = nullptr;
+    if (posix_memalign(&pointer, alignment < sizeof(void*) ? sizeof(void*) : alignment, size > 0 ? size : 1) != 0)
+        return nullptr;
+
+    return pointer;
+}
+#endif // __GLIBC__
+
+void *operator new(std::size_t size)
+{
+    void *pointer = allocate(size);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    void *pointer = allocateAligned(size, static_cast<std::size_t>(alignment));
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(pointer);
+}
+#endif // ROBOTS_COUNT_ALLOCATIONS
+
+/**
+ * @brief Checks whether the allocations are counted in this build.
+ * @return True if the program was built with the ROBOTS_COUNT_ALLOCATIONS option.
+ */
+bool AllocationCounter::IsEnabled()
+{
+#ifdef ROBOTS_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Returns the allocations made by all threads since the start of the program.
+ * @return The counts, zero if the allocations are not counted.
+ */
+AllocationCounter::Counts AllocationCounter::Current()
+{
+#ifdef ROBOTS_COUNT_ALLOCATIONS
+    return { allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+#else
+    return { 0, 0 };
+#endif
+}
+
+/**
+ * @brief Constructor for the TickStatistics class, no tick is recorded yet.
+ */
+TickStatistics::TickStatistics()
+{
+    Reset();
+}
+
+/**
+ * @brief Marks the start of a tick.
+ */
+void TickStatistics::BeginTick()
+{
+    start = AllocationCounter::Current();
+}
+
+/**
+ * @brief Marks the end of a tick and records the allocations made since its start.
+ */
+void TickStatistics::EndTick()
+{
+    AllocationCounter::Counts now = AllocationCounter::Current();
+    last.allocations = now.allocations - start.allocations;
+    last.bytes = now.bytes - start.bytes;
+
+    total.allocations += last.allocations;
+    total.bytes += last.bytes;
+    ticks++;
+    if (last.allocations > 0)
+        allocatingTicks++;
+}
+
+/**
+ * @brief Forgets all recorded ticks.
+ */
+void TickStatistics::Reset()
+{
+    start = { 0, 0 };
+    last = { 0, 0 };
+    total = { 0, 0 };
+    ticks = 0;
+    allocatingTicks = 0;
+}
+
+/**
+ * @brief Returns the allocations of the last recorded tick.
+ * @return The counts of the tick.
+ */
+AllocationCounter::Counts TickStatistics::GetLast()
+{
+    return last;
+}
+
+/**
+ * @brief Returns the allocations of all recorded ticks.
+ * @return The sum of the counts.
+ */
+AllocationCounter::Counts TickStatistics::GetTotal()
+{
+    return total;
+}
+
+/**
+ * @brief Returns the number of recorded ticks.
+ * @return Number of ticks since the last reset.
+ */
+quint64 TickStatistics::GetTicks()
+{
+    return ticks;
+}
+
+/**
+ * @brief Returns the number of recorded ticks which allocated at all.
+ * @return Number of ticks with at least one allocation.
+ */
+quint64 TickStatistics::GetAllocatingTicks()
+{
+    return allocatingTicks;
+}
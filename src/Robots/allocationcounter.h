@@ -0,0 +1,48 @@
+/**
+* @file allocationcounter.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+class AllocationCounter
+{
+public:
+    /**
+     * @brief Number and total size of the heap allocations made so far.
+     */
+    struct Counts
+    {
+        quint64 allocations;
+        quint64 bytes;
+    };
+
+    static bool IsEnabled();
+    static Counts Current();
+};
+
+class TickStatistics
+{
+private:
+    AllocationCounter::Counts start;
+    AllocationCounter::Counts last;
+    AllocationCounter::Counts total;
+    quint64 ticks;
+    quint64 allocatingTicks;
+
+public:
+    TickStatistics();
+    void BeginTick();
+    void EndTick();
+    void Reset();
+    AllocationCounter::Counts GetLast();
+    AllocationCounter::Counts GetTotal();
+    quint64 GetTicks();
+    quint64 GetAllocatingTicks();
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,325 @@
+/**
+* @file channel.cpp
+* @brief Implementation of the Channel class, messages over a UNIX domain socket between simulator processes.
+* @details Every message is a header with its type and the size of its data, followed by the data. The processes run
+* on one machine, so robot states are sent in the memory layout of the RobotState structure.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "channel.h"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Header preceding the data of every message.
+ */
+struct MessageHeader
+{
+    quint32 type;
+    quint32 size;
+};
+
+/**
+ * @brief Constructor for the Channel class, the channel takes ownership of a connected socket.
+ * @param socket File descriptor of the socket, -1 for a closed channel.
+ */
+Channel::Channel(int socket)
+{
+    this->socket = socket;
+}
+
+/**
+ * @brief Destructor for the Channel class, closes the socket.
+ */
+Channel::~Channel()
+{
+    Close();
+}
+
+/**
+ * @brief Checks whether the channel has a socket.
+ * @return True if the socket is open.
+ */
+bool Channel::IsOpen()
+{
+    return socket >= 0;
+}
+
+/**
+ * @brief Closes the socket, the other process reads the end of the stream.
+ */
+void Channel::Close()
+{
+    if (socket >= 0)
+        ::close(socket);
+
+    socket = -1;
+}
+
+/**
+ * @brief Sends a message.
+ * @param type Type of the message.
+ * @param data The data of the message.
+ * @param size Size of the data in bytes.
+ * @return False if the socket has been closed.
+ */
+bool Channel::Send(Type type, const void *data, size_t size)
+{
+    MessageHeader header = { static_cast<quint32>(type), static_cast<quint32>(size) };
+
+    return writeAll(&header, sizeof(header)) && (size == 0 || writeAll(data, size));
+}
+
+/**
+ * @brief Sends a message with robot states.
+ * @param type Type of the message.
+ * @param states The states.
+ * @return False if the socket has been closed.
+ */
+bool Channel::Send(Type type, const std::vector<Environment::RobotState> &states)
+{
+    return Send(type, states.data(), states.size() * sizeof(Environment::RobotState));
+}
+
+/**
+ * @brief Sends a message with robot numbers or flags.
+ * @param type Type of the message.
+ * @param numbers The numbers.
+ * @return False if the socket has been closed.
+ */
+bool Channel::Send(Type type, const std::vector<qint32> &numbers)
+{
+    return Send(type, numbers.data(), numbers.size() * sizeof(qint32));
+}
+
+/**
+ * @brief Waits for the next message.
+ * @param type Set to the type of the message.
+ * @param data Set to the data of the message.
+ * @return False if the socket has been closed.
+ */
+bool Channel::Receive(Type &type, std::vector<char> &data)
+{
+    MessageHeader header;
+    if (!readAll(&header, sizeof(header)))
+        return false;
+
+    type = static_cast<Type>(header.type);
+    data.resize(header.size);
+
+    return header.size == 0 || readAll(data.data(), header.size);
+}
+
+/**
+ * @brief Waits for the next message, which has to carry robot states of the expected type.
+ * @param expected The expected type.
+ * @param states Set to the received states.
+ * @return False if the socket has been closed or another message has arrived.
+ */
+bool Channel::Receive(Type expected, std::vector<Environment::RobotState> &states)
+{
+    Type type;
+    std::vector<char> data;
+
+    if (!Receive(type, data) || type != expected)
+        return false;
+
+    states = States(data);
+    return true;
+}
+
+/**
+ * @brief Waits for the next message, which has to carry robot numbers or flags of the expected type.
+ * @param expected The expected type.
+ * @param numbers Set to the received numbers.
+ * @return False if the socket has been closed or another message has arrived.
+ */
+bool Channel::Receive(Type expected, std::vector<qint32> &numbers)
+{
+    Type type;
+    std::vector<char> data;
+
+    if (!Receive(type, data) || type != expected)
+        return false;
+
+    numbers = Numbers(data);
+    return true;
+}
+
+/**
+ * @brief Decodes the robot states of a message.
+ * @param data The data of the message.
+ * @return The states.
+ */
+std::vector<Environment::RobotState> Channel::States(const std::vector<char> &data)
+{
+    std::vector<Environment::RobotState> states(data.size() / sizeof(Environment::RobotState));
+    if (!states.empty())
+        std::memcpy(states.data(), data.data(), states.size() * sizeof(Environment::RobotState));
+
+    return states;
+}
+
+/**
+ * @brief Decodes the robot numbers or flags of a message.
+ * @param data The data of the message.
+ * @return The numbers.
+ */
+std::vector<qint32> Channel::Numbers(const std::vector<char> &data)
+{
+    std::vector<qint32> numbers(data.size() / sizeof(qint32));
+    if (!numbers.empty())
+        std::memcpy(numbers.data(), data.data(), numbers.size() * sizeof(qint32));
+
+    return numbers;
+}
+
+/**
+ * @brief Decodes the obstacle edits of a message.
+ * @param data The data of the message.
+ * @return The edits in the order they were performed.
+ */
+std::vector<Environment::ObstacleEdit> Channel::ObstacleEdits(const std::vector<char> &data)
+{
+    std::vector<Environment::ObstacleEdit> edits(data.size() / sizeof(Environment::ObstacleEdit));
+    if (!edits.empty())
+        std::memcpy(edits.data(), data.data(), edits.size() * sizeof(Environment::ObstacleEdit));
+
+    return edits;
+}
+
+/**
+ * @brief Creates a socket listening at a path, fails if a file exists at the path.
+ * @param path Path of the socket file.
+ * @return File descriptor of the socket or -1 on failure.
+ */
+int Channel::Listen(const std::string &path)
+{
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0)
+        return -1;
+
+    if (::bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(server, 64) < 0)
+    {
+        ::close(server);
+        return -1;
+    }
+
+    return server;
+}
+
+/**
+ * @brief Waits for a process to connect to a listening socket.
+ * @param server File descriptor of the listening socket.
+ * @param timeout Longest time to wait in milliseconds.
+ * @return File descriptor of the connection or -1 on failure or when no process has connected in time.
+ */
+int Channel::Accept(int server, int timeout)
+{
+    pollfd listening = { server, POLLIN, 0 };
+    int ready;
+
+    do
+        ready = ::poll(&listening, 1, timeout);
+    while (ready < 0 && errno == EINTR);
+
+    if (ready <= 0)
+        return -1;
+
+    int connection;
+
+    do
+        connection = ::accept(server, nullptr, nullptr);
+    while (connection < 0 && errno == EINTR);
+
+    return connection;
+}
+
+/**
+ * @brief Connects to a listening socket.
+ * @param path Path of the socket file.
+ * @return File descriptor of the connection or -1 on failure.
+ */
+int Channel::Connect(const std::string &path)
+{
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0)
+        return -1;
+
+    if (::connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        ::close(connection);
+        return -1;
+    }
+
+    return connection;
+}
+
+/**
+ * @brief Writes all bytes to the socket.
+ * @param data The bytes.
+ * @param size Number of the bytes.
+ * @return False if the socket has been closed.
+ */
+bool Channel::writeAll(const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char*>(data);
+
+    while (socket >= 0 && size > 0)
+    {
+        ssize_t written = ::send(socket, bytes, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+
+        bytes += written;
+        size -= written;
+    }
+
+    return socket >= 0;
+}
+
+/**
+ * @brief Reads exactly the given number of bytes from the socket.
+ * @param data Buffer for the bytes.
+ * @param size Number of the bytes.
+ * @return False if the socket has been closed.
+ */
+bool Channel::readAll(void *data, size_t size)
+{
+    char *bytes = static_cast<char*>(data);
+
+    while (socket >= 0 && size > 0)
+    {
+        ssize_t read = ::recv(socket, bytes, size, 0);
+        if (read < 0 && errno == EINTR)
+            continue;
+        if (read <= 0)
+            return false;
+
+        bytes += read;
+        size -= read;
+    }
+
+    return socket >= 0;
+}
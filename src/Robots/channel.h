@@ -0,0 +1,81 @@
+/**
+* @file channel.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "environment.h"
+#include <string>
+#include <vector>
+
+class Channel
+{
+private:
+    int socket;
+    bool writeAll(const void *data, size_t size);
+    bool readAll(void *data, size_t size);
+
+public:
+    /**
+     * @brief Types of the messages between the coordinator and the worker processes.
+     */
+    enum Type
+    {
+        Init,
+        Step,
+        Sleepers,
+        Blocked,
+        Ghosts,
+        GhostsLeft,
+        GhostsRight,
+        Migrants,
+        ListsDirty,
+        Adopt,
+        Update,
+        SnapshotRequest,
+        Snapshot,
+        Obstacles,
+        Quit
+    };
+
+    /**
+     * @brief Part of the world simulated by a worker, sent in the Init message followed by the obstacles and the
+     * states of the robots within the strip and the bands around it.
+     */
+    struct Region
+    {
+        qint32 index;
+        qint32 count;
+        quint32 seed;
+        qint32 obstacles;
+        qint32 robots;
+        double width;
+        double height;
+        double left;
+        double right;
+        double band;
+    };
+
+    explicit Channel(int socket = -1);
+    ~Channel();
+    bool IsOpen();
+    void Close();
+    bool Send(Type type, const void *data, size_t size);
+    bool Send(Type type, const std::vector<Environment::RobotState> &states);
+    bool Send(Type type, const std::vector<qint32> &numbers);
+    bool Receive(Type &type, std::vector<char> &data);
+    bool Receive(Type expected, std::vector<Environment::RobotState> &states);
+    bool Receive(Type expected, std::vector<qint32> &numbers);
+
+    static std::vector<Environment::RobotState> States(const std::vector<char> &data);
+    static std::vector<qint32> Numbers(const std::vector<char> &data);
+    static std::vector<Environment::ObstacleEdit> ObstacleEdits(const std::vector<char> &data);
+    static int Listen(const std::string &path);
+    static int Accept(int server, int timeout);
+    static int Connect(const std::string &path);
+};
+
+#endif // CHANNEL_H
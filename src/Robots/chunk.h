@@ -0,0 +1,25 @@
+/**
+* @file chunk.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include "obstacle.h"
+#include "robot.h"
+#include <vector>
+
+/**
+ * @brief Square part of the environment holding the objects located in it.
+ * @details An obstacle is stored in every chunk it overlaps, a robot only in the chunk containing its center.
+ * Chunks without any object are not stored at all.
+ */
+struct Chunk
+{
+    std::vector<Obstacle*> obstacles;
+    std::vector<Robot*> robots;
+};
+
+#endif // CHUNK_H
@@ -0,0 +1,839 @@
+/**
+* @file collisionkernel.cpp
+* @brief Implementation of the CollisionKernel class, which tests a robot against many other robots at once.
+* @details The robot is given by the disc at its next position and by its triangle, the other robots by their centers
+* relative to the center of the disc, stored in two contiguous arrays. A robot blocks the tested robot if its disc
+* touches the disc or the triangle, which is the same as its center being closer than the sum of the radii to the disc
+* or closer than its radius to the triangle. The same arithmetic is performed for every other robot, so it is
+* evaluated for 4, 8 or 16 robots per instruction with SSE2, AVX2 or AVX-512. The instruction set is selected when
+* the kernel is first used, the scalar version is used on other processors and, in debug builds, to verify every
+* result of the vector versions. A batch holds different pairs of robots in its lanes, so a whole tick of pairwise
+* tests is evaluated in one call, with a padding which reports pairs that could touch once the other robot moves.
+* SelfTest compares every level with the scalar version on random inputs in any build.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "collisionkernel.h"
+#include <QtGlobal>
+#include <QtMath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COLLISIONKERNEL_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Builds the query of a triangle relative to the center of the disc.
+ * @param cornerX The x coordinates of the corners relative to the center of the disc.
+ * @param cornerY The y coordinates of the corners relative to the center of the disc.
+ * @return The query with the edges from each corner to the next one.
+ */
+CollisionQuery CollisionKernel::MakeQuery(const float cornerX[3], const float cornerY[3])
+{
+    CollisionQuery query;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int next = (i + 1) % 3;
+        float directionX = cornerX[next] - cornerX[i];
+        float directionY = cornerY[next] - cornerY[i];
+        float length = directionX * directionX + directionY * directionY;
+
+        query.edgeX[i] = cornerX[i];
+        query.edgeY[i] = cornerY[i];
+        query.directionX[i] = directionX;
+        query.directionY[i] = directionY;
+        query.inverseLength[i] = length > 0 ? 1 / length : 0;
+    }
+
+    // A triangle without area has no inside, only its edges are tested
+    float area = query.directionX[0] * query.directionY[1] - query.directionY[0] * query.directionX[1];
+    query.hasArea = area != 0;
+
+    return query;
+}
+
+/**
+ * @brief Tests other robots one at a time.
+ * @param query The tested disc and triangle.
+ * @param xs The x coordinates of the other robots relative to the center of the disc.
+ * @param ys The y coordinates of the other robots relative to the center of the disc.
+ * @param count Number of the other robots.
+ * @return True if any of the other robots blocks the disc or the triangle.
+ */
+static bool anyHitScalar(const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    const float disc = CollisionKernel::DiscDistance * CollisionKernel::DiscDistance;
+    const float radius = CollisionKernel::RobotRadius * CollisionKernel::RobotRadius;
+
+    for (int i = 0; i < count; i++)
+    {
+        float x = xs[i];
+        float y = ys[i];
+
+        if (x * x + y * y < disc)
+            return true;
+
+        int positive = 0;
+        int negative = 0;
+        for (int edge = 0; edge < 3; edge++)
+        {
+            float dx = x - query.edgeX[edge];
+            float dy = y - query.edgeY[edge];
+
+            // Nearest point of the edge
+            float t = (dx * query.directionX[edge] + dy * query.directionY[edge]) * query.inverseLength[edge];
+            t = qMin(qMax(t, 0.0f), 1.0f);
+            float rx = dx - t * query.directionX[edge];
+            float ry = dy - t * query.directionY[edge];
+            if (rx * rx + ry * ry < radius)
+                return true;
+
+            // Side of the edge
+            float side = query.directionX[edge] * dy - query.directionY[edge] * dx;
+            positive += side > 0;
+            negative += side < 0;
+        }
+
+        if (query.hasArea && (positive == 3 || negative == 3))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Tests one lane of a batch.
+ * @details The padding extends the distances at which the other robot touches the disc and the triangle, the result
+ * within the padded distances is reported as near.
+ * @param batch The pairs of robots.
+ * @param i Index of the lane.
+ * @return HitFlag and NearFlag if the other robot touches the disc or the triangle, NearFlag alone if it only comes
+ * within the padding, zero otherwise.
+ */
+static quint8 testLaneScalar(const CollisionBatch &batch, int i)
+{
+    const float disc = CollisionKernel::DiscDistance * CollisionKernel::DiscDistance;
+    const float radius = CollisionKernel::RobotRadius * CollisionKernel::RobotRadius;
+    const quint8 both = CollisionKernel::HitFlag | CollisionKernel::NearFlag;
+
+    float x = batch.x[i];
+    float y = batch.y[i];
+    float paddedDisc = CollisionKernel::DiscDistance + batch.padding[i];
+    float paddedRadius = CollisionKernel::RobotRadius + batch.padding[i];
+    quint8 result = 0;
+
+    float distance = x * x + y * y;
+    if (distance < disc)
+        result |= both;
+    else if (distance < paddedDisc * paddedDisc)
+        result |= CollisionKernel::NearFlag;
+
+    int positive = 0;
+    int negative = 0;
+    for (int edge = 0; edge < 3; edge++)
+    {
+        float directionX = batch.directionX[edge][i];
+        float directionY = batch.directionY[edge][i];
+        float dx = x - batch.edgeX[edge][i];
+        float dy = y - batch.edgeY[edge][i];
+
+        // Nearest point of the edge
+        float t = (dx * directionX + dy * directionY) * batch.inverseLength[edge][i];
+        t = qMin(qMax(t, 0.0f), 1.0f);
+        float rx = dx - t * directionX;
+        float ry = dy - t * directionY;
+        float edgeDistance = rx * rx + ry * ry;
+        if (edgeDistance < radius)
+            result |= both;
+        else if (edgeDistance < paddedRadius * paddedRadius)
+            result |= CollisionKernel::NearFlag;
+
+        // Side of the edge
+        float side = directionX * dy - directionY * dx;
+        positive += side > 0;
+        negative += side < 0;
+    }
+
+    if (batch.area[i] > 0 && (positive == 3 || negative == 3))
+        result |= both;
+
+    return result;
+}
+
+/**
+ * @brief Tests the lanes of a batch one at a time.
+ * @param batch The pairs of robots, the results are written to it.
+ * @param count Number of the tested lanes.
+ */
+static void testBatchScalar(CollisionBatch &batch, int count)
+{
+    for (int i = 0; i < count; i++)
+        batch.results[i] = testLaneScalar(batch, i);
+}
+
+#ifdef COLLISIONKERNEL_X86
+
+/**
+ * @brief Tests other robots four at a time with SSE2.
+ * @details The count has to be a multiple of four.
+ */
+__attribute__((target("sse2")))
+static bool anyHitSSE2(const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    const __m128 disc = _mm_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m128 radius = _mm_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 area = query.hasArea ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : zero;
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+
+        __m128 hit = _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), disc);
+        __m128 positive = area;
+        __m128 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m128 directionX = _mm_set1_ps(query.directionX[edge]);
+            __m128 directionY = _mm_set1_ps(query.directionY[edge]);
+            __m128 dx = _mm_sub_ps(x, _mm_set1_ps(query.edgeX[edge]));
+            __m128 dy = _mm_sub_ps(y, _mm_set1_ps(query.edgeY[edge]));
+
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx, directionX), _mm_mul_ps(dy, directionY)), _mm_set1_ps(query.inverseLength[edge]));
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            __m128 rx = _mm_sub_ps(dx, _mm_mul_ps(t, directionX));
+            __m128 ry = _mm_sub_ps(dy, _mm_mul_ps(t, directionY));
+            hit = _mm_or_ps(hit, _mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), radius));
+
+            __m128 side = _mm_sub_ps(_mm_mul_ps(directionX, dy), _mm_mul_ps(directionY, dx));
+            positive = _mm_and_ps(positive, _mm_cmpgt_ps(side, zero));
+            negative = _mm_and_ps(negative, _mm_cmplt_ps(side, zero));
+        }
+
+        hit = _mm_or_ps(hit, _mm_or_ps(positive, negative));
+        if (_mm_movemask_ps(hit))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Tests other robots eight at a time with AVX2.
+ * @details The count has to be a multiple of eight.
+ */
+__attribute__((target("avx2")))
+static bool anyHitAVX2(const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    const __m256 disc = _mm256_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m256 radius = _mm256_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 area = query.hasArea ? _mm256_castsi256_ps(_mm256_set1_epi32(-1)) : zero;
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+
+        __m256 hit = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), disc, _CMP_LT_OQ);
+        __m256 positive = area;
+        __m256 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m256 directionX = _mm256_set1_ps(query.directionX[edge]);
+            __m256 directionY = _mm256_set1_ps(query.directionY[edge]);
+            __m256 dx = _mm256_sub_ps(x, _mm256_set1_ps(query.edgeX[edge]));
+            __m256 dy = _mm256_sub_ps(y, _mm256_set1_ps(query.edgeY[edge]));
+
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(dx, directionX), _mm256_mul_ps(dy, directionY)), _mm256_set1_ps(query.inverseLength[edge]));
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            __m256 rx = _mm256_sub_ps(dx, _mm256_mul_ps(t, directionX));
+            __m256 ry = _mm256_sub_ps(dy, _mm256_mul_ps(t, directionY));
+            hit = _mm256_or_ps(hit, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(rx, rx), _mm256_mul_ps(ry, ry)), radius, _CMP_LT_OQ));
+
+            __m256 side = _mm256_sub_ps(_mm256_mul_ps(directionX, dy), _mm256_mul_ps(directionY, dx));
+            positive = _mm256_and_ps(positive, _mm256_cmp_ps(side, zero, _CMP_GT_OQ));
+            negative = _mm256_and_ps(negative, _mm256_cmp_ps(side, zero, _CMP_LT_OQ));
+        }
+
+        hit = _mm256_or_ps(hit, _mm256_or_ps(positive, negative));
+        if (_mm256_movemask_ps(hit))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Tests other robots sixteen at a time with AVX-512.
+ * @details The count has to be a multiple of sixteen.
+ */
+__attribute__((target("avx512f")))
+static bool anyHitAVX512(const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    const __m512 disc = _mm512_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m512 radius = _mm512_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __mmask16 area = query.hasArea ? 0xFFFF : 0;
+
+    for (int i = 0; i < count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(xs + i);
+        __m512 y = _mm512_loadu_ps(ys + i);
+
+        __mmask16 hit = _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y)), disc, _CMP_LT_OQ);
+        __mmask16 positive = area;
+        __mmask16 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m512 directionX = _mm512_set1_ps(query.directionX[edge]);
+            __m512 directionY = _mm512_set1_ps(query.directionY[edge]);
+            __m512 dx = _mm512_sub_ps(x, _mm512_set1_ps(query.edgeX[edge]));
+            __m512 dy = _mm512_sub_ps(y, _mm512_set1_ps(query.edgeY[edge]));
+
+            __m512 t = _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(dx, directionX), _mm512_mul_ps(dy, directionY)), _mm512_set1_ps(query.inverseLength[edge]));
+            t = _mm512_min_ps(_mm512_max_ps(t, zero), one);
+            __m512 rx = _mm512_sub_ps(dx, _mm512_mul_ps(t, directionX));
+            __m512 ry = _mm512_sub_ps(dy, _mm512_mul_ps(t, directionY));
+            hit |= _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(rx, rx), _mm512_mul_ps(ry, ry)), radius, _CMP_LT_OQ);
+
+            __m512 side = _mm512_sub_ps(_mm512_mul_ps(directionX, dy), _mm512_mul_ps(directionY, dx));
+            positive &= _mm512_cmp_ps_mask(side, zero, _CMP_GT_OQ);
+            negative &= _mm512_cmp_ps_mask(side, zero, _CMP_LT_OQ);
+        }
+
+        if (hit | positive | negative)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Tests the lanes of a batch four at a time with SSE2.
+ * @details The count has to be a multiple of four.
+ */
+__attribute__((target("sse2")))
+static void testBatchSSE2(CollisionBatch &batch, int count)
+{
+    const __m128 disc = _mm_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m128 radius = _mm_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(batch.x.data() + i);
+        __m128 y = _mm_loadu_ps(batch.y.data() + i);
+        __m128 padding = _mm_loadu_ps(batch.padding.data() + i);
+        __m128 paddedDisc = _mm_add_ps(_mm_set1_ps(CollisionKernel::DiscDistance), padding);
+        __m128 paddedRadius = _mm_add_ps(_mm_set1_ps(CollisionKernel::RobotRadius), padding);
+        paddedDisc = _mm_mul_ps(paddedDisc, paddedDisc);
+        paddedRadius = _mm_mul_ps(paddedRadius, paddedRadius);
+
+        __m128 distance = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        __m128 hit = _mm_cmplt_ps(distance, disc);
+        __m128 near = _mm_cmplt_ps(distance, paddedDisc);
+        __m128 area = _mm_cmpgt_ps(_mm_loadu_ps(batch.area.data() + i), zero);
+        __m128 positive = area;
+        __m128 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m128 directionX = _mm_loadu_ps(batch.directionX[edge].data() + i);
+            __m128 directionY = _mm_loadu_ps(batch.directionY[edge].data() + i);
+            __m128 dx = _mm_sub_ps(x, _mm_loadu_ps(batch.edgeX[edge].data() + i));
+            __m128 dy = _mm_sub_ps(y, _mm_loadu_ps(batch.edgeY[edge].data() + i));
+
+            __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx, directionX), _mm_mul_ps(dy, directionY)), _mm_loadu_ps(batch.inverseLength[edge].data() + i));
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            __m128 rx = _mm_sub_ps(dx, _mm_mul_ps(t, directionX));
+            __m128 ry = _mm_sub_ps(dy, _mm_mul_ps(t, directionY));
+            __m128 edgeDistance = _mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry));
+            hit = _mm_or_ps(hit, _mm_cmplt_ps(edgeDistance, radius));
+            near = _mm_or_ps(near, _mm_cmplt_ps(edgeDistance, paddedRadius));
+
+            __m128 side = _mm_sub_ps(_mm_mul_ps(directionX, dy), _mm_mul_ps(directionY, dx));
+            positive = _mm_and_ps(positive, _mm_cmpgt_ps(side, zero));
+            negative = _mm_and_ps(negative, _mm_cmplt_ps(side, zero));
+        }
+
+        hit = _mm_or_ps(hit, _mm_or_ps(positive, negative));
+        int hits = _mm_movemask_ps(hit);
+        int nears = _mm_movemask_ps(_mm_or_ps(near, hit));
+        for (int lane = 0; lane < 4; lane++)
+            batch.results[i + lane] = ((hits >> lane) & 1) * CollisionKernel::HitFlag | ((nears >> lane) & 1) * CollisionKernel::NearFlag;
+    }
+}
+
+/**
+ * @brief Tests the lanes of a batch eight at a time with AVX2.
+ * @details The count has to be a multiple of eight.
+ */
+__attribute__((target("avx2")))
+static void testBatchAVX2(CollisionBatch &batch, int count)
+{
+    const __m256 disc = _mm256_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m256 radius = _mm256_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(batch.x.data() + i);
+        __m256 y = _mm256_loadu_ps(batch.y.data() + i);
+        __m256 padding = _mm256_loadu_ps(batch.padding.data() + i);
+        __m256 paddedDisc = _mm256_add_ps(_mm256_set1_ps(CollisionKernel::DiscDistance), padding);
+        __m256 paddedRadius = _mm256_add_ps(_mm256_set1_ps(CollisionKernel::RobotRadius), padding);
+        paddedDisc = _mm256_mul_ps(paddedDisc, paddedDisc);
+        paddedRadius = _mm256_mul_ps(paddedRadius, paddedRadius);
+
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        __m256 hit = _mm256_cmp_ps(distance, disc, _CMP_LT_OQ);
+        __m256 near = _mm256_cmp_ps(distance, paddedDisc, _CMP_LT_OQ);
+        __m256 area = _mm256_cmp_ps(_mm256_loadu_ps(batch.area.data() + i), zero, _CMP_GT_OQ);
+        __m256 positive = area;
+        __m256 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m256 directionX = _mm256_loadu_ps(batch.directionX[edge].data() + i);
+            __m256 directionY = _mm256_loadu_ps(batch.directionY[edge].data() + i);
+            __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(batch.edgeX[edge].data() + i));
+            __m256 dy = _mm256_sub_ps(y, _mm256_loadu_ps(batch.edgeY[edge].data() + i));
+
+            __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(dx, directionX), _mm256_mul_ps(dy, directionY)), _mm256_loadu_ps(batch.inverseLength[edge].data() + i));
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            __m256 rx = _mm256_sub_ps(dx, _mm256_mul_ps(t, directionX));
+            __m256 ry = _mm256_sub_ps(dy, _mm256_mul_ps(t, directionY));
+            __m256 edgeDistance = _mm256_add_ps(_mm256_mul_ps(rx, rx), _mm256_mul_ps(ry, ry));
+            hit = _mm256_or_ps(hit, _mm256_cmp_ps(edgeDistance, radius, _CMP_LT_OQ));
+            near = _mm256_or_ps(near, _mm256_cmp_ps(edgeDistance, paddedRadius, _CMP_LT_OQ));
+
+            __m256 side = _mm256_sub_ps(_mm256_mul_ps(directionX, dy), _mm256_mul_ps(directionY, dx));
+            positive = _mm256_and_ps(positive, _mm256_cmp_ps(side, zero, _CMP_GT_OQ));
+            negative = _mm256_and_ps(negative, _mm256_cmp_ps(side, zero, _CMP_LT_OQ));
+        }
+
+        hit = _mm256_or_ps(hit, _mm256_or_ps(positive, negative));
+        int hits = _mm256_movemask_ps(hit);
+        int nears = _mm256_movemask_ps(_mm256_or_ps(near, hit));
+        for (int lane = 0; lane < 8; lane++)
+            batch.results[i + lane] = ((hits >> lane) & 1) * CollisionKernel::HitFlag | ((nears >> lane) & 1) * CollisionKernel::NearFlag;
+    }
+}
+
+/**
+ * @brief Tests the lanes of a batch sixteen at a time with AVX-512.
+ * @details The count has to be a multiple of sixteen.
+ */
+__attribute__((target("avx512f")))
+static void testBatchAVX512(CollisionBatch &batch, int count)
+{
+    const __m512 disc = _mm512_set1_ps(CollisionKernel::DiscDistance * CollisionKernel::DiscDistance);
+    const __m512 radius = _mm512_set1_ps(CollisionKernel::RobotRadius * CollisionKernel::RobotRadius);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+
+    for (int i = 0; i < count; i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(batch.x.data() + i);
+        __m512 y = _mm512_loadu_ps(batch.y.data() + i);
+        __m512 padding = _mm512_loadu_ps(batch.padding.data() + i);
+        __m512 paddedDisc = _mm512_add_ps(_mm512_set1_ps(CollisionKernel::DiscDistance), padding);
+        __m512 paddedRadius = _mm512_add_ps(_mm512_set1_ps(CollisionKernel::RobotRadius), padding);
+        paddedDisc = _mm512_mul_ps(paddedDisc, paddedDisc);
+        paddedRadius = _mm512_mul_ps(paddedRadius, paddedRadius);
+
+        __m512 distance = _mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y));
+        __mmask16 hit = _mm512_cmp_ps_mask(distance, disc, _CMP_LT_OQ);
+        __mmask16 near = _mm512_cmp_ps_mask(distance, paddedDisc, _CMP_LT_OQ);
+        __mmask16 area = _mm512_cmp_ps_mask(_mm512_loadu_ps(batch.area.data() + i), zero, _CMP_GT_OQ);
+        __mmask16 positive = area;
+        __mmask16 negative = area;
+
+        for (int edge = 0; edge < 3; edge++)
+        {
+            __m512 directionX = _mm512_loadu_ps(batch.directionX[edge].data() + i);
+            __m512 directionY = _mm512_loadu_ps(batch.directionY[edge].data() + i);
+            __m512 dx = _mm512_sub_ps(x, _mm512_loadu_ps(batch.edgeX[edge].data() + i));
+            __m512 dy = _mm512_sub_ps(y, _mm512_loadu_ps(batch.edgeY[edge].data() + i));
+
+            __m512 t = _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(dx, directionX), _mm512_mul_ps(dy, directionY)), _mm512_loadu_ps(batch.inverseLength[edge].data() + i));
+            t = _mm512_min_ps(_mm512_max_ps(t, zero), one);
+            __m512 rx = _mm512_sub_ps(dx, _mm512_mul_ps(t, directionX));
+            __m512 ry = _mm512_sub_ps(dy, _mm512_mul_ps(t, directionY));
+            __m512 edgeDistance = _mm512_add_ps(_mm512_mul_ps(rx, rx), _mm512_mul_ps(ry, ry));
+            hit |= _mm512_cmp_ps_mask(edgeDistance, radius, _CMP_LT_OQ);
+            near |= _mm512_cmp_ps_mask(edgeDistance, paddedRadius, _CMP_LT_OQ);
+
+            __m512 side = _mm512_sub_ps(_mm512_mul_ps(directionX, dy), _mm512_mul_ps(directionY, dx));
+            positive &= _mm512_cmp_ps_mask(side, zero, _CMP_GT_OQ);
+            negative &= _mm512_cmp_ps_mask(side, zero, _CMP_LT_OQ);
+        }
+
+        hit |= positive | negative;
+        near |= hit;
+        for (int lane = 0; lane < 16; lane++)
+            batch.results[i + lane] = ((hit >> lane) & 1) * CollisionKernel::HitFlag | ((near >> lane) & 1) * CollisionKernel::NearFlag;
+    }
+}
+
+#endif // COLLISIONKERNEL_X86
+
+/**
+ * @brief Finds the widest instruction set supported by the processor.
+ * @return The level used by AnyHit.
+ */
+CollisionKernel::Level CollisionKernel::Detect()
+{
+#ifdef COLLISIONKERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SSE2;
+#endif
+
+    return Scalar;
+}
+
+/**
+ * @brief Returns the name of an instruction set level.
+ * @param level The level.
+ * @return The name for messages.
+ */
+const char* CollisionKernel::LevelName(Level level)
+{
+    switch (level)
+    {
+    case SSE2:
+        return "SSE2";
+    case AVX2:
+        return "AVX2";
+    case AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief Tests other robots with the widest instruction set supported by the processor.
+ * @param query The tested disc and triangle.
+ * @param xs The x coordinates of the other robots relative to the center of the disc.
+ * @param ys The y coordinates of the other robots relative to the center of the disc.
+ * @param count Number of the other robots, a multiple of Lanes. Unused entries are set to Far.
+ * @return True if any of the other robots blocks the disc or the triangle.
+ */
+bool CollisionKernel::AnyHit(const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    static const Level level = Detect();
+
+    bool hit = AnyHit(level, query, xs, ys, count);
+
+    // Debug builds verify the vector versions against the scalar one
+    Q_ASSERT(hit == anyHitScalar(query, xs, ys, count));
+
+    return hit;
+}
+
+/**
+ * @brief Tests other robots with the given instruction set.
+ * @details Levels which are not compiled in fall back to the scalar version. The processor has to support the level.
+ * @param level The instruction set.
+ * @param query The tested disc and triangle.
+ * @param xs The x coordinates of the other robots relative to the center of the disc.
+ * @param ys The y coordinates of the other robots relative to the center of the disc.
+ * @param count Number of the other robots, a multiple of Lanes. Unused entries are set to Far.
+ * @return True if any of the other robots blocks the disc or the triangle.
+ */
+bool CollisionKernel::AnyHit(Level level, const CollisionQuery &query, const float *xs, const float *ys, int count)
+{
+    switch (level)
+    {
+#ifdef COLLISIONKERNEL_X86
+    case SSE2:
+        return anyHitSSE2(query, xs, ys, count);
+    case AVX2:
+        return anyHitAVX2(query, xs, ys, count);
+    case AVX512:
+        return anyHitAVX512(query, xs, ys, count);
+#endif
+    default:
+        return anyHitScalar(query, xs, ys, count);
+    }
+}
+
+/**
+ * @brief Tests the lanes of a batch with the widest instruction set supported by the processor.
+ * @param batch The pairs of robots, the result of every lane is written to its results.
+ */
+void CollisionKernel::TestBatch(CollisionBatch &batch)
+{
+    static const Level level = Detect();
+
+    TestBatch(level, batch);
+
+#ifndef QT_NO_DEBUG
+    // Debug builds verify the vector versions against the scalar one
+    for (int i = 0; i < batch.count; i++)
+        Q_ASSERT(batch.results[i] == testLaneScalar(batch, i));
+#endif
+}
+
+/**
+ * @brief Tests the lanes of a batch with the given instruction set.
+ * @details The lanes after the last pair up to a multiple of Lanes are filled with robots far away. Levels which are
+ * not compiled in fall back to the scalar version. The processor has to support the level.
+ * @param level The instruction set.
+ * @param batch The pairs of robots, the result of every lane is written to its results.
+ */
+void CollisionKernel::TestBatch(Level level, CollisionBatch &batch)
+{
+    int count = batch.Padded();
+
+    for (int i = batch.count; i < count; i++)
+    {
+        batch.x[i] = Far;
+        batch.y[i] = Far;
+        batch.padding[i] = 0;
+    }
+
+    switch (level)
+    {
+#ifdef COLLISIONKERNEL_X86
+    case SSE2:
+        testBatchSSE2(batch, count);
+        break;
+    case AVX2:
+        testBatchAVX2(batch, count);
+        break;
+    case AVX512:
+        testBatchAVX512(batch, count);
+        break;
+#endif
+    default:
+        testBatchScalar(batch, count);
+        break;
+    }
+}
+
+/**
+ * @brief Removes all pairs from the batch, the storage is kept.
+ */
+void CollisionBatch::Clear()
+{
+    count = 0;
+}
+
+/**
+ * @brief Makes room for a number of pairs, so adding them does not allocate.
+ * @param count Number of the pairs.
+ */
+void CollisionBatch::Reserve(int count)
+{
+    size_t size = (count + CollisionKernel::Lanes - 1) / CollisionKernel::Lanes * CollisionKernel::Lanes;
+    if (x.size() >= size)
+        return;
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        edgeX[edge].resize(size);
+        edgeY[edge].resize(size);
+        directionX[edge].resize(size);
+        directionY[edge].resize(size);
+        inverseLength[edge].resize(size);
+    }
+
+    area.resize(size);
+    x.resize(size);
+    y.resize(size);
+    padding.resize(size);
+    results.resize(size);
+}
+
+/**
+ * @brief Adds a pair of robots to the batch.
+ * @param query The disc and triangle of the tested robot.
+ * @param x The x coordinate of the other robot relative to the center of the disc.
+ * @param y The y coordinate of the other robot relative to the center of the disc.
+ * @param padding Distance by which the other robot can move in the tick, zero if it stays.
+ * @return The lane of the pair, its result is read from it after the batch has been tested.
+ */
+int CollisionBatch::Add(const CollisionQuery &query, float x, float y, float padding)
+{
+    int lane = count++;
+
+    // The storage grows to whole groups of lanes, so the kernel never reads past it
+    if (static_cast<int>(this->x.size()) < Padded())
+        Reserve(qMax<int>(2 * this->x.size(), Padded()));
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        edgeX[edge][lane] = query.edgeX[edge];
+        edgeY[edge][lane] = query.edgeY[edge];
+        directionX[edge][lane] = query.directionX[edge];
+        directionY[edge][lane] = query.directionY[edge];
+        inverseLength[edge][lane] = query.inverseLength[edge];
+    }
+
+    area[lane] = query.hasArea ? 1 : 0;
+    this->x[lane] = x;
+    this->y[lane] = y;
+    this->padding[lane] = padding;
+
+    return lane;
+}
+
+/**
+ * @brief Returns the number of pairs rounded up to whole groups of lanes.
+ * @return The number of lanes tested by the kernel.
+ */
+int CollisionBatch::Padded() const
+{
+    return (count + CollisionKernel::Lanes - 1) / CollisionKernel::Lanes * CollisionKernel::Lanes;
+}
+
+/**
+ * @brief Compares the results of an instruction set with the scalar version on random triangles and positions.
+ * @details Every sample tests one position against a random triangle, alone among unused entries and together with
+ * other random positions, and adds it with a random padding to a batch of pairs. A third of the triangles have no area, and a part of the positions lies on the edges of
+ * the triangles or on the border of the disc, where rounding differences would show. The inputs depend only on the
+ * seed, so a failure can be repeated.
+ * @param level The instruction set, the processor has to support it.
+ * @param samples Number of the tested positions.
+ * @param seed Seed of the random inputs.
+ * @return Number of the tests and lanes in which the results differ.
+ */
+int CollisionKernel::SelfTest(Level level, int samples, quint32 seed)
+{
+    quint64 state = (quint64(seed) + 1) * 0x9E3779B97F4A7C15ull;
+    auto random = [&state](float low, float high) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return low + (high - low) * static_cast<float>(state >> 40) / static_cast<float>(1 << 24);
+    };
+
+    // The batch is tested whenever it is full, its size is not a multiple of Lanes so the padded lanes are covered too
+    const int batchSize = 3 * Lanes + 5;
+    CollisionBatch batch;
+    std::vector<quint8> expected;
+    auto testBatch = [&batch, &expected, level]() {
+        expected.resize(batch.count);
+        for (int i = 0; i < batch.count; i++)
+            expected[i] = testLaneScalar(batch, i);
+
+        TestBatch(level, batch);
+
+        int differ = 0;
+        for (int i = 0; i < batch.count; i++)
+            differ += batch.results[i] != expected[i];
+
+        batch.Clear();
+        return differ;
+    };
+
+    float xs[Lanes];
+    float ys[Lanes];
+    int failures = 0;
+
+    for (int sample = 0; sample < samples; sample++)
+    {
+        float cornerX[3];
+        float cornerY[3];
+        for (int i = 0; i < 3; i++)
+        {
+            cornerX[i] = random(-150, 150);
+            cornerY[i] = random(-150, 150);
+        }
+
+        // Triangles without area, with two equal corners or with all corners on a line
+        int shape = sample % 6;
+        if (shape == 1)
+        {
+            cornerX[1] = cornerX[0];
+            cornerY[1] = cornerY[0];
+        }
+        else if (shape == 2)
+        {
+            cornerX[2] = (cornerX[0] + cornerX[1]) / 2;
+            cornerY[2] = (cornerY[0] + cornerY[1]) / 2;
+        }
+
+        CollisionQuery query = MakeQuery(cornerX, cornerY);
+
+        // Half of the positions near the borders are placed at the padded distance tested by batches
+        float padding = sample % 2 ? 0 : random(0, 6);
+        float border = (sample / 3) % 2 ? padding : 0;
+
+        float x;
+        float y;
+        int place = sample % 3;
+        if (place == 0)
+        {
+            x = random(-200, 200);
+            y = random(-200, 200);
+        }
+        else if (place == 1)
+        {
+            // Near an edge of the triangle, by up to a little more than the radius of a robot
+            int edge = sample % 3;
+            float t = random(0, 1);
+            float angle = random(0, 6.2831853f);
+            float distance = border + random(RobotRadius - 0.01f, RobotRadius + 0.01f);
+            x = query.edgeX[edge] + t * query.directionX[edge] + distance * qCos(angle);
+            y = query.edgeY[edge] + t * query.directionY[edge] + distance * qSin(angle);
+        }
+        else
+        {
+            // Near the border of the disc
+            float angle = random(0, 6.2831853f);
+            float distance = border + random(DiscDistance - 0.01f, DiscDistance + 0.01f);
+            x = distance * qCos(angle);
+            y = distance * qSin(angle);
+        }
+
+        for (int lane = 0; lane < Lanes; lane++)
+        {
+            xs[lane] = Far;
+            ys[lane] = Far;
+        }
+
+        int lane = sample % Lanes;
+        xs[lane] = x;
+        ys[lane] = y;
+        failures += AnyHit(level, query, xs, ys, Lanes) != anyHitScalar(query, xs, ys, Lanes);
+
+        for (int other = 0; other < Lanes; other++)
+        {
+            if (other != lane)
+            {
+                xs[other] = random(-400, 400);
+                ys[other] = random(-400, 400);
+            }
+        }
+        failures += AnyHit(level, query, xs, ys, Lanes) != anyHitScalar(query, xs, ys, Lanes);
+
+        batch.Add(query, x, y, padding);
+        if (batch.count == batchSize)
+            failures += testBatch();
+    }
+
+    if (batch.count > 0)
+        failures += testBatch();
+
+    return failures;
+}
@@ -0,0 +1,82 @@
+/**
+* @file collisionkernel.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef COLLISIONKERNEL_H
+#define COLLISIONKERNEL_H
+
+#include <QtGlobal>
+#include <vector>
+
+/**
+ * @brief Disc and triangle of a robot tested against other robots, relative to the center of the disc.
+ * @details The triangle is given by its three edges, each edge by its start point, its direction and the inverse
+ * of its squared length, which is zero for an edge of zero length.
+ */
+struct CollisionQuery
+{
+    float edgeX[3];
+    float edgeY[3];
+    float directionX[3];
+    float directionY[3];
+    float inverseLength[3];
+    bool hasArea;
+};
+
+/**
+ * @brief Pairs of robots tested by the collision kernel, one tested robot and one other robot per lane.
+ * @details Each lane holds the query of the tested robot, the position of the other robot relative to the center of
+ * the disc and a padding, one array per component, so the lanes of different pairs are evaluated together. The
+ * storage is kept when the batch is cleared.
+ */
+struct CollisionBatch
+{
+    std::vector<float> edgeX[3];
+    std::vector<float> edgeY[3];
+    std::vector<float> directionX[3];
+    std::vector<float> directionY[3];
+    std::vector<float> inverseLength[3];
+    std::vector<float> area;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> padding;
+    std::vector<quint8> results;
+    int count = 0;
+
+    void Clear();
+    void Reserve(int count);
+    int Add(const CollisionQuery &query, float x, float y, float padding);
+    int Padded() const;
+};
+
+class CollisionKernel
+{
+public:
+    enum Level
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    static constexpr int Lanes = 16;
+    static constexpr float Far = 1e9f;
+    static constexpr float DiscDistance = 25.5f;
+    static constexpr float RobotRadius = 12.5f;
+    static constexpr quint8 HitFlag = 1;
+    static constexpr quint8 NearFlag = 2;
+
+    static CollisionQuery MakeQuery(const float cornerX[3], const float cornerY[3]);
+    static Level Detect();
+    static const char* LevelName(Level level);
+    static bool AnyHit(const CollisionQuery &query, const float *xs, const float *ys, int count);
+    static bool AnyHit(Level level, const CollisionQuery &query, const float *xs, const float *ys, int count);
+    static void TestBatch(CollisionBatch &batch);
+    static void TestBatch(Level level, CollisionBatch &batch);
+    static int SelfTest(Level level, int samples, quint32 seed);
+};
+
+#endif // COLLISIONKERNEL_H
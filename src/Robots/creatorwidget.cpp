@@ -33,13 +33,34 @@ CreatorWidget::CreatorWidget(QWidget *parent)
     connect(ui->obstacleRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
     connect(ui->robotRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
     connect(ui->deleteRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
+    connect(ui->rectRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
+    connect(ui->lineRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
+    connect(ui->selectRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
+    connect(ui->stampRadio, SIGNAL(toggled(bool)), this, SLOT(radio_toggled()));
+
+    connect(ui->copyButton, SIGNAL(clicked(bool)), this, SLOT(copyButton_clicked()));
+    connect(ui->pasteButton, SIGNAL(clicked(bool)), this, SLOT(pasteButton_clicked()));
+    connect(ui->undoButton, SIGNAL(clicked(bool)), this, SLOT(undoButton_clicked()));
+    connect(ui->redoButton, SIGNAL(clicked(bool)), this, SLOT(redoButton_clicked()));
+
+    connect(new QShortcut(QKeySequence::Copy, this), SIGNAL(activated()), this, SLOT(copyButton_clicked()));
+    connect(new QShortcut(QKeySequence::Paste, this), SIGNAL(activated()), this, SLOT(pasteButton_clicked()));
+    connect(new QShortcut(QKeySequence::Undo, this), SIGNAL(activated()), this, SLOT(undoButton_clicked()));
+    connect(new QShortcut(QKeySequence::Redo, this), SIGNAL(activated()), this, SLOT(redoButton_clicked()));
 }
 
 /**
  * @brief Destructor for CreatorWidget, cleans up UI resources.
+ * @details A running save is canceled and waited for, the thread is owned by this widget.
  */
 CreatorWidget::~CreatorWidget()
 {
+    if (saver)
+    {
+        saver->requestInterruption();
+        saver->wait();
+    }
+
     delete ui;
 }
 
@@ -54,6 +75,8 @@ void CreatorWidget::setSize()
 
 /**
  * @brief Handles the save button click event; opens a dialog for saving the file and saves the scene.
+ * @details The file is written in the background while a progress dialog is shown, the save can be canceled. The
+ * dialog is window modal from the start, so the scene cannot be edited until the save finishes.
  */
 void CreatorWidget::saveButton_clicked()
 {
@@ -61,9 +84,28 @@ void CreatorWidget::saveButton_clicked()
     if (filePath.isEmpty())
         return;
 
-    scene->SaveScene(filePath.toStdString());
-    QMessageBox::information(this, tr("Success"), tr("File saved."));
-    emit backRequested();
+    QProgressDialog *progress = new QProgressDialog(tr("Saving map..."), tr("Cancel"), 0, 100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    progress->show();
+
+    saver = scene->SaveScene(filePath, this);
+
+    connect(saver, &MapSaver::progressChanged, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, saver, &QThread::requestInterruption);
+    connect(saver, &MapSaver::saved, this, [=](bool success, QString error) {
+        progress->deleteLater();
+
+        if (success)
+        {
+            QMessageBox::information(this, tr("Success"), tr("File saved."));
+            emit backRequested();
+        }
+        else if (!error.isEmpty())
+            QMessageBox::warning(this, tr("Error"), tr("File not saved: %1").arg(error));
+    });
 }
 
 /**
@@ -83,10 +125,51 @@ void CreatorWidget::radio_toggled()
         scene->SetActive(0);
     else if (ui->robotRadio->isChecked())
         scene->SetActive(1);
+    else if (ui->rectRadio->isChecked())
+        scene->SetActive(3);
+    else if (ui->lineRadio->isChecked())
+        scene->SetActive(4);
+    else if (ui->selectRadio->isChecked())
+        scene->SetActive(5);
+    else if (ui->stampRadio->isChecked())
+        scene->SetActive(6);
     else
         scene->SetActive(2);
 }
 
+/**
+ * @brief Copies the objects of the selected region.
+ */
+void CreatorWidget::copyButton_clicked()
+{
+    scene->CopySelection();
+}
+
+/**
+ * @brief Switches to the stamp tool, every click then places the copied region.
+ */
+void CreatorWidget::pasteButton_clicked()
+{
+    if (scene->HasClipboard())
+        ui->stampRadio->setChecked(true);
+}
+
+/**
+ * @brief Undoes the last rectangle fill, line wall or stamp.
+ */
+void CreatorWidget::undoButton_clicked()
+{
+    scene->Undo();
+}
+
+/**
+ * @brief Redoes the last undone rectangle fill, line wall or stamp.
+ */
+void CreatorWidget::redoButton_clicked()
+{
+    scene->Redo();
+}
+
 /**
  * @brief Finishes editing in widthLine and shifts focus to heightLine.
  */
@@ -13,6 +13,9 @@
 #include <QWidget>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QShortcut>
+#include <QProgressDialog>
+#include <QPointer>
 
 namespace Ui {
 class CreatorWidget;
@@ -34,6 +37,10 @@ private slots:
     void saveButton_clicked();
     void cancelButton_clicked();
     void widthLine_finished();
+    void copyButton_clicked();
+    void pasteButton_clicked();
+    void undoButton_clicked();
+    void redoButton_clicked();
 
 Q_SIGNALS:
     void backRequested();
@@ -41,6 +48,7 @@ Q_SIGNALS:
 private:
     Ui::CreatorWidget *ui;
     CustomGraphicsScene *scene;
+    QPointer<MapSaver> saver;
 };
 
 #endif // CREATORWIDGET_H
@@ -9,7 +9,6 @@
 #include "QGraphicsSceneMouseEvent"
 #include "objectpainter.h"
 #include "qgraphicsitem.h"
-#include <fstream>
 
 int CustomGraphicsScene::activeRadio = 0;
 
@@ -19,7 +18,13 @@ int CustomGraphicsScene::activeRadio = 0;
  */
 CustomGraphicsScene::CustomGraphicsScene(QObject *parent) :
     QGraphicsScene(parent)
-{}
+{
+    // Objects painted by dragging the mouse are inserted together once per frame
+    strokeTimer = new QTimer(this);
+    strokeTimer->setSingleShot(true);
+    strokeTimer->setInterval(16);
+    connect(strokeTimer, &QTimer::timeout, this, &CustomGraphicsScene::flushStroke);
+}
 
 /**
  * @brief Handles mouse press events within the scene, adding or deleting objects based on the active tool selected.
@@ -36,6 +41,8 @@ void CustomGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
     if (scenePos.y() < 12.5 || scenePos.y() > height - 12.5)
         return;
 
+    flushStroke();
+
     if (event->button() == Qt::LeftButton)
     {
         switch (this->activeRadio) {
@@ -45,9 +52,17 @@ void CustomGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
         case 1:
             AddControlledRobot(scenePos);
             break;
-        default:
+        case 2:
             DeleteObject(scenePos);
             break;
+        case 6:
+            if (clipboard != nullptr)
+                execute(EditCommand::StampPattern(clipboard, scenePos));
+            break;
+        default:
+            // Rectangle, line and selection are spanned by dragging the mouse
+            startDrag(scenePos);
+            break;
         }
     }
     else
@@ -58,12 +73,20 @@ void CustomGraphicsScene::mousePressEvent(QGraphicsSceneMouseEvent *event)
 
 /**
  * @brief Handles mouse move events to dynamically update objects in the scene during a drag operation.
+ * @details The positions are collected and processed by flushStroke at most once per frame.
  * @param event Information about the QGraphicsSceneMouseEvent.
  */
 void CustomGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
 {
     if (event->buttons() & Qt::LeftButton)
     {
+        if (previewItem != nullptr)
+        {
+            updateDrag(clampToRoom(event->scenePos()));
+            QGraphicsScene::mouseMoveEvent(event);
+            return;
+        }
+
         QPointF scenePos = event->scenePos();
         qreal width = sceneRect().width()-1;
         qreal height = sceneRect().height()-1;
@@ -73,19 +96,54 @@ void CustomGraphicsScene::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
         if (scenePos.y() < 12.5 || scenePos.y() > height - 12.5)
             return;
 
+        if (this->activeRadio == 0 || this->activeRadio == 2)
+        {
+            pendingStroke.push_back(scenePos);
+
+            if (!strokeTimer->isActive())
+                strokeTimer->start();
+        }
+
+        QGraphicsScene::mouseMoveEvent(event);
+    }
+}
+
+/**
+ * @brief Handles mouse release events, finishing the current drag operation.
+ * @param event Information about the QGraphicsSceneMouseEvent.
+ */
+void CustomGraphicsScene::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+{
+    flushStroke();
+
+    if (previewItem != nullptr && event->button() == Qt::LeftButton)
+        finishDrag(clampToRoom(event->scenePos()));
+
+    QGraphicsScene::mouseReleaseEvent(event);
+}
+
+/**
+ * @brief Adds or deletes the objects collected during a drag operation in one batch.
+ */
+void CustomGraphicsScene::flushStroke()
+{
+    strokeTimer->stop();
+
+    for (QPointF scenePos : pendingStroke)
+    {
         switch (this->activeRadio) {
         case 0:
             AddObstacle(scenePos);
             break;
-        case 1:
+        case 2:
+            DeleteObject(scenePos);
             break;
         default:
-            DeleteObject(scenePos);
             break;
         }
-
-        QGraphicsScene::mouseMoveEvent(event);
     }
+
+    pendingStroke.clear();
 }
 
 /**
@@ -102,18 +160,19 @@ void CustomGraphicsScene::CreateRoom(int width, int height)
     this->width = width;
     this->height = height;
 
-    for (auto obstacle : obstacles)
-    {
-        delete obstacle;
-    }
+    pendingStroke.clear();
 
-    for (auto robot : robots)
-    {
-        delete robot;
-    }
+    obstacles.ForEach([](Obstacle *obstacle) { delete obstacle; });
+    robots.ForEach([](Robot *robot) { delete robot; });
 
-    obstacles.clear();
-    robots.clear();
+    obstacles.Clear();
+    robots.Clear();
+    paintedItems.clear();
+    history.clear();
+    historyPosition = 0;
+    previewItem = nullptr;
+    selectionItem = nullptr;
+    selection = QRectF();
 
     clear();
 
@@ -139,66 +198,56 @@ void CustomGraphicsScene::AddObstacle(QPointF scenePos)
 
     Obstacle *obstacle = Obstacle::create(scenePos);
 
-    ObjectPainter::PaintObstacle(this, obstacle);
-    obstacles.push_back(obstacle);
+    paintedItems[obstacle] = ObjectPainter::PaintObstacle(this, obstacle);
+    obstacles.Insert(obstacle, scenePos);
 }
 
 /**
  * @brief Adds a controlled robot to the scene at the specified position, checking for intersections with other robots.
+ * @details If the position is taken by another robot, that robot is turned instead.
  * @param scenePos The position in the scene where the robot is to be placed.
  */
 void CustomGraphicsScene::AddControlledRobot(QPointF scenePos)
 {
-    Robot *robot = Robot::create(scenePos);
-
     if (checkPosition(scenePos) != 0)
     {
-        QPainterPath robotPath;
-        robotPath.addEllipse(robot->boundingRect());
-        for (auto r : robots)
+        Robot *robot = robots.Find(scenePos, [=](Robot *r) {
+            QPointF delta = r->getPosition() - scenePos;
+            return QPointF::dotProduct(delta, delta) < 25 * 25;
+        });
+
+        if (robot != nullptr)
         {
-            QPainterPath objectPath;
-            objectPath.addEllipse(r->boundingRect());
-
-            if (robotPath.intersects(objectPath))
-            {
-                robot = r;
-                robot->turn(30);
-                ObjectPainter::PaintRobot(this, robot);
-                return;
-            }
+            robot->turn(30);
+            removePainted(robot);
+            paintedItems[robot] = ObjectPainter::PaintRobot(this, robot);
         }
         return;
     }
 
-    robot = Robot::create(scenePos);
-    robots.push_back(robot);
-    ObjectPainter::PaintRobot(this, robot);
+    Robot *robot = Robot::create(scenePos);
+    robots.Insert(robot, robot->getPosition());
+    paintedItems[robot] = ObjectPainter::PaintRobot(this, robot);
 }
 
 /**
  * @brief Checks if the given position is free from robots or obstacles.
+ * @details Only the grid cells around the position are searched.
  * @param scenePos The position to check.
  * @return An integer indicating the type of object, if any, at the position.
  */
 int CustomGraphicsScene::checkPosition(QPointF scenePos)
 {
-    QRectF rect = QRectF(scenePos.x()-12.5, scenePos.y()-12.5, 25, 25);
-    for (auto robot : robots)
-    {
-        QPainterPath objectPath;
-        objectPath.addEllipse(robot->boundingRect());
+    // Both robots and obstacles occupy a 25 x 25 square
+    auto overlaps = [=](QPointF pos) {
+        return qAbs(pos.x() - scenePos.x()) < 25 && qAbs(pos.y() - scenePos.y()) < 25;
+    };
 
-        if (rect.intersects(robot->boundingRect()))
-            return 1;
-    }
+    if (robots.Find(scenePos, [=](Robot *robot) { return overlaps(robot->getPosition()); }) != nullptr)
+        return 1;
 
-    rect = QRectF(scenePos.x(), scenePos.y(), 25, 25);
-    for (auto obstacle : obstacles)
-    {
-        if (rect.intersects(obstacle->boundingRect()))
-            return 2;
-    }
+    if (obstacles.Find(scenePos, [=](Obstacle *obstacle) { return overlaps(obstacle->getPosition()); }) != nullptr)
+        return 2;
 
     return 0;
 }
@@ -214,54 +263,327 @@ void CustomGraphicsScene::SetActive(int active)
 
 /**
  * @brief Saves the current scene to a file in CSV format, containing information about all objects within.
+ * @details Only a snapshot of the objects is taken here, the file is written by a MapSaver on a background thread.
+ * The returned thread is already started and deletes itself when it finishes. It is not owned by the scene, the owner
+ * has to wait for it before it is destroyed.
  * @param filePath The path to the file where the scene should be saved.
+ * @param owner The parent of the thread.
+ * @return The thread writing the file.
  */
-void CustomGraphicsScene::SaveScene(std::string filePath)
+MapSaver* CustomGraphicsScene::SaveScene(QString filePath, QObject *owner)
 {
-    std::ofstream file(filePath);
+    flushStroke();
+
+    std::vector<MapRecord> records;
+    records.reserve(obstacles.Size() + robots.Size());
 
-    file << "Type, row, col, angle(robot)" << std::endl;
-    file << "ENV," << width << "," << height << std::endl;
+    obstacles.ForEach([&](Obstacle *obstacle) {
+        records.push_back({false, obstacle->getPosition().x()-12.5, obstacle->getPosition().y()-12.5, 0});
+    });
 
-    for (const auto& obstacle : obstacles)
+    robots.ForEach([&](Robot *robot) {
+        records.push_back({true, robot->getPosition().x(), robot->getPosition().y(), robot->angle()});
+    });
+
+    MapSaver *saver = new MapSaver(filePath, width, height, std::move(records), owner);
+    connect(saver, &QThread::finished, saver, &QObject::deleteLater);
+    saver->start();
+
+    return saver;
+}
+
+/**
+ * @brief Deletes an object from the scene at the specified position, whether it is a robot or an obstacle.
+ * @details Robots take precedence over obstacles, only the grid cells around the position are searched.
+ * @param scenePos The position in the scene where the object to be deleted is located.
+ */
+void CustomGraphicsScene::DeleteObject(QPointF scenePos)
+{
+    // Both robots and obstacles are painted as a 25 x 25 square centered at their position
+    auto contains = [=](QPointF pos) {
+        return qAbs(pos.x() - scenePos.x()) <= 12.5 && qAbs(pos.y() - scenePos.y()) <= 12.5;
+    };
+
+    Robot *robot = robots.Find(scenePos, [=](Robot *r) { return contains(r->getPosition()); });
+    if (robot != nullptr)
     {
-        file << "O," << obstacle->getPosition().x()-12.5 << "," << obstacle->getPosition().y()-12.5 << std::endl;
+        robots.Remove(robot, robot->getPosition());
+        removePainted(robot);
+        delete robot;
+        return;
     }
 
-    for (const auto& robot : robots)
+    Obstacle *obstacle = obstacles.Find(scenePos, [=](Obstacle *o) { return contains(o->getPosition()); });
+    if (obstacle != nullptr)
     {
-        file << "R," << robot->getPosition().x() << "," << robot->getPosition().y() << "," << robot->angle() << std::endl;
+        obstacles.Remove(obstacle, obstacle->getPosition());
+        removePainted(obstacle);
+        delete obstacle;
     }
+}
 
-    file.close();
-    clear();
+/**
+ * @brief Removes the item painted for an object from the scene.
+ * @param object The robot or obstacle whose item is removed.
+ */
+void CustomGraphicsScene::removePainted(QGraphicsItem *object)
+{
+    auto item = paintedItems.find(object);
+    if (item == paintedItems.end())
+        return;
+
+    removeItem(item->second);
+    delete item->second;
+    paintedItems.erase(item);
 }
 
 /**
- * @brief Deletes an object from the scene at the specified position, whether it is a robot or an obstacle.
- * @param scenePos The position in the scene where the object to be deleted is located.
+ * @brief Limits a position to the area where the center of an object can be placed.
+ * @param scenePos The position in the scene.
+ * @return The nearest position inside the room.
  */
-void CustomGraphicsScene::DeleteObject(QPointF scenePos)
+QPointF CustomGraphicsScene::clampToRoom(QPointF scenePos)
+{
+    qreal width = sceneRect().width()-1;
+    qreal height = sceneRect().height()-1;
+
+    return QPointF(qBound(12.5, scenePos.x(), width - 12.5), qBound(12.5, scenePos.y(), height - 12.5));
+}
+
+/**
+ * @brief Starts spanning a rectangle, a line or a selection and shows its preview.
+ * @param scenePos The position where the drag started.
+ */
+void CustomGraphicsScene::startDrag(QPointF scenePos)
+{
+    removeHelperItem(previewItem);
+    dragOrigin = scenePos;
+
+    QPen pen(QColor(42, 130, 218));
+    pen.setStyle(Qt::DashLine);
+
+    if (this->activeRadio == 4)
+        previewItem = addLine(QLineF(scenePos, scenePos), pen);
+    else
+        previewItem = addRect(QRectF(scenePos, scenePos), pen);
+
+    updateDrag(scenePos);
+}
+
+/**
+ * @brief Updates the preview of the spanned rectangle, line or selection.
+ * @param scenePos The current position of the mouse.
+ */
+void CustomGraphicsScene::updateDrag(QPointF scenePos)
+{
+    if (QGraphicsLineItem *line = qgraphicsitem_cast<QGraphicsLineItem*>(previewItem))
+        line->setLine(QLineF(dragOrigin, scenePos));
+    else if (QGraphicsRectItem *rect = qgraphicsitem_cast<QGraphicsRectItem*>(previewItem))
+    {
+        QRectF spanned = QRectF(dragOrigin, scenePos).normalized();
+
+        // Filled rectangles are spanned by the centers of the corner obstacles
+        if (this->activeRadio == 3)
+            spanned.adjust(-12.5, -12.5, 12.5, 12.5);
+
+        rect->setRect(spanned);
+    }
+}
+
+/**
+ * @brief Finishes the drag, filling the rectangle, placing the wall or keeping the selection.
+ * @param scenePos The position where the drag ended.
+ */
+void CustomGraphicsScene::finishDrag(QPointF scenePos)
+{
+    switch (this->activeRadio) {
+    case 3:
+        execute(EditCommand::FillRect(QRectF(dragOrigin, scenePos)));
+        break;
+    case 4:
+        execute(EditCommand::LineWall(dragOrigin, scenePos));
+        break;
+    case 5:
+        removeHelperItem(selectionItem);
+        selection = QRectF(dragOrigin, scenePos).normalized();
+        selectionItem = previewItem;
+        previewItem = nullptr;
+        return;
+    default:
+        break;
+    }
+
+    removeHelperItem(previewItem);
+}
+
+/**
+ * @brief Removes a preview or selection item from the scene.
+ * @param item Reference to the pointer to the item, it is set to nullptr.
+ */
+void CustomGraphicsScene::removeHelperItem(QGraphicsItem *&item)
 {
-    ObjectPainter::RemoveObject(this, scenePos);
+    if (item == nullptr)
+        return;
+
+    removeItem(item);
+    delete item;
+    item = nullptr;
+}
 
-    for (auto r = robots.rbegin(); r != robots.rend(); ++r)
+/**
+ * @brief Places one object generated by an edit command, if its position is free.
+ * @param entry The object with an absolute position.
+ * @return True if the object was placed.
+ */
+bool CustomGraphicsScene::insertObject(const PatternEntry &entry)
+{
+    QPointF scenePos = entry.position;
+
+    if (clampToRoom(scenePos) != scenePos || checkPosition(scenePos) != 0)
+        return false;
+
+    if (entry.robot)
     {
-        if ((*r)->boundingRect().contains(scenePos))
-        {
-            delete *r;
-            robots.erase(std::next(r).base());
-            return;
-        }
+        Robot *robot = Robot::create(scenePos);
+        robot->turn(entry.angle);
+        robots.Insert(robot, robot->getPosition());
+        paintedItems[robot] = ObjectPainter::PaintRobot(this, robot);
+    }
+    else
+    {
+        Obstacle *obstacle = Obstacle::create(scenePos);
+        obstacles.Insert(obstacle, scenePos);
+        paintedItems[obstacle] = ObjectPainter::PaintObstacle(this, obstacle);
     }
 
-    for (auto o = obstacles.rbegin(); o != obstacles.rend(); ++o)
+    return true;
+}
+
+/**
+ * @brief Removes one object previously placed by an edit command.
+ * @param entry The object with an absolute position.
+ */
+void CustomGraphicsScene::removeObject(const PatternEntry &entry)
+{
+    QPointF scenePos = entry.position;
+
+    if (entry.robot)
     {
-        if ((*o)->boundingRect().contains(scenePos))
-        {
-            delete *o;
-            obstacles.erase(std::next(o).base());
+        // Robots hold their position in fixed point
+        QPointF robotPos(FixedPoint::Round(scenePos.x()), FixedPoint::Round(scenePos.y()));
+        Robot *robot = robots.Find(robotPos, [=](Robot *r) { return r->getPosition() == robotPos; });
+        if (robot == nullptr)
             return;
-        }
+
+        robots.Remove(robot, robotPos);
+        removePainted(robot);
+        delete robot;
     }
+    else
+    {
+        Obstacle *obstacle = obstacles.Find(scenePos, [=](Obstacle *o) { return o->getPosition() == scenePos; });
+        if (obstacle == nullptr)
+            return;
+
+        obstacles.Remove(obstacle, scenePos);
+        removePainted(obstacle);
+        delete obstacle;
+    }
+}
+
+/**
+ * @brief Applies a new edit command and appends it to the undo log, discarding the undone commands.
+ * @details All objects of the command are added within one call, so the scene is updated only once.
+ * @param command The command to apply.
+ */
+void CustomGraphicsScene::execute(EditCommand command)
+{
+    const size_t historyLimit = 100;
+
+    Pattern objects = command.Expand();
+    std::vector<bool> &placed = command.Placed();
+    placed.assign(objects.size(), false);
+
+    for (size_t i = 0; i < objects.size(); i++)
+        placed[i] = insertObject(objects[i]);
+
+    history.erase(history.begin() + historyPosition, history.end());
+    history.push_back(std::move(command));
+
+    if (history.size() > historyLimit)
+        history.erase(history.begin());
+
+    historyPosition = history.size();
+}
+
+/**
+ * @brief Undoes the last applied edit command, removing the objects it has placed.
+ */
+void CustomGraphicsScene::Undo()
+{
+    if (historyPosition == 0)
+        return;
+
+    EditCommand &command = history[--historyPosition];
+    Pattern objects = command.Expand();
+    std::vector<bool> &placed = command.Placed();
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (placed[i])
+            removeObject(objects[i]);
+    }
+}
+
+/**
+ * @brief Applies the last undone edit command again.
+ */
+void CustomGraphicsScene::Redo()
+{
+    if (historyPosition == history.size())
+        return;
+
+    EditCommand &command = history[historyPosition++];
+    Pattern objects = command.Expand();
+    std::vector<bool> &placed = command.Placed();
+
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (placed[i])
+            placed[i] = insertObject(objects[i]);
+    }
+}
+
+/**
+ * @brief Copies the objects inside the selected region, they can then be stamped by the stamp tool.
+ */
+void CustomGraphicsScene::CopySelection()
+{
+    if (selectionItem == nullptr)
+        return;
+
+    std::shared_ptr<Pattern> pattern = std::make_shared<Pattern>();
+    QPointF center = selection.center();
+
+    robots.ForEachIn(selection, [&](Robot *robot) {
+        if (selection.contains(robot->getPosition()))
+            pattern->push_back({true, robot->getPosition() - center, robot->angle()});
+    });
+
+    obstacles.ForEachIn(selection, [&](Obstacle *obstacle) {
+        if (selection.contains(obstacle->getPosition()))
+            pattern->push_back({false, obstacle->getPosition() - center, 0});
+    });
+
+    clipboard = pattern;
+    removeHelperItem(selectionItem);
+}
+
+/**
+ * @brief Checks whether a region has been copied.
+ * @return True if there is a region to stamp.
+ */
+bool CustomGraphicsScene::HasClipboard()
+{
+    return clipboard != nullptr;
 }
@@ -7,9 +7,14 @@
 #ifndef CUSTOMGRAPHICSSCENE_H
 #define CUSTOMGRAPHICSSCENE_H
 
+#include "editcommand.h"
+#include "gridindex.h"
+#include "mapsaver.h"
 #include "obstacle.h"
 #include "robot.h"
 #include <QGraphicsScene>
+#include <QTimer>
+#include <unordered_map>
 
 class CustomGraphicsScene : public QGraphicsScene
 {
@@ -21,19 +26,45 @@ public:
     explicit CustomGraphicsScene(QObject *parent = nullptr); // Konstruktor
     void CreateRoom(int width, int height);
     static void SetActive(int active);
-    void SaveScene(std::string mapName);
+    MapSaver* SaveScene(QString filePath, QObject *owner);
+    void Undo();
+    void Redo();
+    void CopySelection();
+    bool HasClipboard();
 
 protected:
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+private slots:
+    void flushStroke();
 private:
     static int activeRadio;
-    std::vector<Obstacle*> obstacles;
-    std::vector<Robot*> robots;
+    GridIndex<Obstacle*> obstacles;
+    GridIndex<Robot*> robots;
+    std::unordered_map<QGraphicsItem*, QGraphicsItem*> paintedItems;
+    std::vector<QPointF> pendingStroke;
+    QTimer *strokeTimer;
+    QPointF dragOrigin;
+    QGraphicsItem *previewItem = nullptr;
+    QGraphicsItem *selectionItem = nullptr;
+    QRectF selection;
+    std::shared_ptr<const Pattern> clipboard;
+    std::vector<EditCommand> history;
+    size_t historyPosition = 0;
     int checkPosition(QPointF scenePos);
     void AddObstacle(QPointF);
     void AddControlledRobot(QPointF scenePos);
     void DeleteObject(QPointF);
+    void removePainted(QGraphicsItem *object);
+    QPointF clampToRoom(QPointF scenePos);
+    void startDrag(QPointF scenePos);
+    void updateDrag(QPointF scenePos);
+    void finishDrag(QPointF scenePos);
+    void removeHelperItem(QGraphicsItem *&item);
+    bool insertObject(const PatternEntry &entry);
+    void removeObject(const PatternEntry &entry);
+    void execute(EditCommand command);
 };
 
 #endif // CUSTOMGRAPHICSSCENE_H
@@ -0,0 +1,247 @@
+/**
+* @file distancefield.cpp
+* @brief Implementation of the DistanceField class, the clearance of every position from the static geometry.
+* @details The distance to the nearest obstacle is precomputed when the obstacle is added and stored per cell in
+* chunks of 64 x 64 cells. Only the chunks near obstacles are stored, the distance is clamped to 64 px, so positions
+* in missing chunks are at least that far from every obstacle. The distance to the walls of the room is computed
+* directly. Stored values are lower bounds valid for every point of the cell, so all queries are conservative.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "distancefield.h"
+#include <QtMath>
+#include <algorithm>
+
+/**
+ * @brief Constructor for the DistanceField class.
+ * @param size Size of the room, its walls are part of the static geometry.
+ * @param resolution Size of one cell in scene units.
+ */
+DistanceField::DistanceField(QPointF size, double resolution)
+{
+    this->size = size;
+    this->resolution = resolution > 0 ? resolution : 4;
+}
+
+/**
+ * @brief Lowers the distances of the cells around a new obstacle.
+ * @param rect Rectangle of the obstacle in scene coordinates.
+ */
+void DistanceField::AddObstacle(QRectF rect)
+{
+    rect = rect.normalized();
+    double reach = Reach();
+    lower(rect, cell(rect.top() - reach), cell(rect.bottom() + reach), cell(rect.left() - reach), cell(rect.right() + reach));
+}
+
+/**
+ * @brief Raises the distances of the cells around a removed obstacle to what the remaining obstacles give.
+ * @details Only the cells within the reach of the removed obstacle are computed again, from the obstacles within the
+ * reach of these cells. The result is the same as if the removed obstacle had never been added.
+ * @param rect Rectangle of the removed obstacle in scene coordinates.
+ * @param nearby Rectangles of the remaining obstacles, at least those closer than twice the reach to the removed one.
+ */
+void DistanceField::RemoveObstacle(QRectF rect, const std::vector<QRectF> &nearby)
+{
+    rect = rect.normalized();
+    double reach = Reach();
+    qint64 firstRow = cell(rect.top() - reach);
+    qint64 lastRow = cell(rect.bottom() + reach);
+    qint64 firstColumn = cell(rect.left() - reach);
+    qint64 lastColumn = cell(rect.right() + reach);
+
+    for (qint64 row = firstRow; row <= lastRow; row++)
+    {
+        qint64 chunkY = chunkOf(row);
+
+        for (qint64 column = firstColumn; column <= lastColumn; column++)
+        {
+            qint64 chunkX = chunkOf(column);
+            auto chunk = chunks.find(chunkKey(chunkX, chunkY));
+            if (chunk != chunks.end())
+                chunk->second[(row - chunkY * ChunkCells) * ChunkCells + (column - chunkX * ChunkCells)] = MaxDistance;
+        }
+    }
+
+    for (QRectF other : nearby)
+    {
+        other = other.normalized();
+        lower(other, qMax(firstRow, cell(other.top() - reach)), qMin(lastRow, cell(other.bottom() + reach)),
+              qMax(firstColumn, cell(other.left() - reach)), qMin(lastColumn, cell(other.right() + reach)));
+    }
+}
+
+/**
+ * @brief Returns how far from an obstacle the distances of the cells are lowered.
+ * @return The largest stored distance plus half of the cell diagonal.
+ */
+double DistanceField::Reach() const
+{
+    return MaxDistance + resolution * M_SQRT1_2;
+}
+
+/**
+ * @brief Lowers the distances of the cells of a block to the distance from an obstacle.
+ * @param rect Rectangle of the obstacle in scene coordinates.
+ * @param firstRow First row of the block.
+ * @param lastRow Last row of the block, inclusive.
+ * @param firstColumn First column of the block.
+ * @param lastColumn Last column of the block, inclusive.
+ */
+void DistanceField::lower(QRectF rect, qint64 firstRow, qint64 lastRow, qint64 firstColumn, qint64 lastColumn)
+{
+    // Distance from the center of a cell to its corner, subtracted so the value holds for the whole cell
+    double halfDiagonal = resolution * M_SQRT1_2;
+
+    for (qint64 row = firstRow; row <= lastRow; row++)
+    {
+        double y = (row + 0.5) * resolution;
+        double dy = qMax(0.0, qMax(rect.top() - y, y - rect.bottom()));
+        qint64 chunkY = chunkOf(row);
+
+        for (qint64 column = firstColumn; column <= lastColumn; column++)
+        {
+            double x = (column + 0.5) * resolution;
+            double dx = qMax(0.0, qMax(rect.left() - x, x - rect.right()));
+            double distance = qSqrt(dx * dx + dy * dy) - halfDiagonal;
+            if (distance >= MaxDistance)
+                continue;
+
+            qint64 chunkX = chunkOf(column);
+            std::vector<quint8> &chunk = chunks[chunkKey(chunkX, chunkY)];
+            if (chunk.empty())
+                chunk.resize(ChunkCells * ChunkCells, MaxDistance);
+
+            quint8 &value = chunk[(row - chunkY * ChunkCells) * ChunkCells + (column - chunkX * ChunkCells)];
+            value = qMin<int>(value, qMax(0, qFloor(distance)));
+        }
+    }
+}
+
+/**
+ * @brief Returns a lower bound of the distance from a position to the nearest obstacle or wall.
+ * @param pos Position in scene coordinates.
+ * @return Clearance in scene units, zero outside of the room, at most 64 px far from the walls.
+ */
+double DistanceField::Clearance(QPointF pos) const
+{
+    double walls = qMin(qMin(pos.x(), size.x() - pos.x()), qMin(pos.y(), size.y() - pos.y()));
+    if (walls <= 0)
+        return 0;
+
+    qint64 row = cell(pos.y());
+    qint64 column = cell(pos.x());
+    qint64 chunkX = chunkOf(column);
+    qint64 chunkY = chunkOf(row);
+
+    auto chunk = chunks.find(chunkKey(chunkX, chunkY));
+    if (chunk == chunks.end())
+        return qMin<double>(walls, MaxDistance);
+
+    int value = chunk->second[(row - chunkY * ChunkCells) * ChunkCells + (column - chunkX * ChunkCells)];
+    return qMin<double>(walls, value);
+}
+
+/**
+ * @brief Measures how far a disc can travel along a heading before it touches the static geometry.
+ * @details The disc advances by its clearance until it is closer than 1 px to an obstacle or a wall,
+ * so open space is crossed in a few lookups. The stored distances are rounded down by up to the precision of the
+ * field, which is added back so that a disc touching nothing is not stuck at its starting position.
+ * @param pos Starting position of the center of the disc.
+ * @param heading Direction of travel in degrees, counterclockwise with zero pointing right as the robot heading.
+ * @param radius Radius of the disc.
+ * @param limit Distance after which the search stops.
+ * @return Free distance, at most the limit.
+ */
+double DistanceField::FreeDistance(QPointF pos, int heading, double radius, double limit) const
+{
+    double radians = qDegreesToRadians(static_cast<double>(heading));
+    QPointF direction(qCos(radians), -qSin(radians));
+    double travelled = 0;
+
+    while (travelled < limit)
+    {
+        double step = Clearance(pos + direction * travelled) + precision() - radius;
+        if (step < 1)
+            break;
+
+        travelled += step;
+    }
+
+    return qMin(travelled, limit);
+}
+
+/**
+ * @brief Finds a heading in which a robot is not blocked by the static geometry.
+ * @details The headings are sampled every 10 degrees, beginning with the starting heading. A heading is free if the
+ * disc of the robot can travel the needed distance and the end of the path is clear to the given width. The stored
+ * distances end at 64 px, so a wider clearance is only required up to that, as every point farther from all obstacles.
+ * @param pos Position of the center of the robot.
+ * @param radius Radius of the disc of the robot.
+ * @param needed Distance the disc has to be able to travel.
+ * @param width Clearance needed at the end of the path, such as half of the base of the triangle.
+ * @param start The first sampled heading in degrees, a random start spreads the chosen headings.
+ * @param exclude Heading which is not returned, such as the heading the robot is already blocked in.
+ * @return The first free heading or -1 if no heading is free.
+ */
+int DistanceField::FreeHeading(QPointF pos, double radius, double needed, double width, int start, int exclude) const
+{
+    start = (start % 360 + 360) % 360;
+    width = qMin<double>(width, MaxDistance);
+
+    for (int i = 0; i < HeadingSamples; i++)
+    {
+        int heading = (start + i * 360 / HeadingSamples) % 360;
+        if (heading == exclude || FreeDistance(pos, heading, radius, needed) < needed)
+            continue;
+
+        double radians = qDegreesToRadians(static_cast<double>(heading));
+        QPointF end = pos + QPointF(qCos(radians), -qSin(radians)) * needed;
+
+        if (Clearance(end) + precision() >= width)
+            return heading;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Returns the largest amount by which a stored distance can be lower than the real one.
+ * @return Half of the cell diagonal plus the rounding to whole pixels.
+ */
+double DistanceField::precision() const
+{
+    return resolution * M_SQRT1_2 + 1;
+}
+
+/**
+ * @brief Converts a scene coordinate to the index of the cell containing it.
+ * @param coordinate Coordinate in scene units.
+ * @return Index of the cell.
+ */
+qint64 DistanceField::cell(double coordinate) const
+{
+    return qFloor(coordinate / resolution);
+}
+
+/**
+ * @brief Returns the chunk containing a cell, also for negative cells.
+ * @param cell Row or column of the cell.
+ * @return Row or column of the chunk.
+ */
+qint64 DistanceField::chunkOf(qint64 cell)
+{
+    return cell >= 0 ? cell / ChunkCells : -((-cell + ChunkCells - 1) / ChunkCells);
+}
+
+/**
+ * @brief Creates the key of a chunk from its coordinates.
+ * @param chunkX Column of the chunk.
+ * @param chunkY Row of the chunk.
+ * @return Key of the chunk.
+ */
+quint64 DistanceField::chunkKey(qint64 chunkX, qint64 chunkY)
+{
+    return (static_cast<quint64>(static_cast<quint32>(chunkY)) << 32) | static_cast<quint32>(chunkX);
+}
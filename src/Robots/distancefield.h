@@ -0,0 +1,42 @@
+/**
+* @file distancefield.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include <QPointF>
+#include <QRectF>
+#include <unordered_map>
+#include <vector>
+
+class DistanceField
+{
+private:
+    static constexpr int ChunkCells = 64;
+    static constexpr int MaxDistance = 64;
+    static constexpr int HeadingSamples = 36;
+
+    QPointF size;
+    double resolution;
+    std::unordered_map<quint64, std::vector<quint8>> chunks;
+
+    qint64 cell(double coordinate) const;
+    double precision() const;
+    void lower(QRectF rect, qint64 firstRow, qint64 lastRow, qint64 firstColumn, qint64 lastColumn);
+    static qint64 chunkOf(qint64 cell);
+    static quint64 chunkKey(qint64 chunkX, qint64 chunkY);
+
+public:
+    explicit DistanceField(QPointF size, double resolution = 4);
+    void AddObstacle(QRectF rect);
+    void RemoveObstacle(QRectF rect, const std::vector<QRectF> &nearby);
+    double Reach() const;
+    double Clearance(QPointF pos) const;
+    double FreeDistance(QPointF pos, int heading, double radius, double limit) const;
+    int FreeHeading(QPointF pos, double radius, double needed, double width, int start, int exclude) const;
+};
+
+#endif // DISTANCEFIELD_H
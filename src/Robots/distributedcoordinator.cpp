@@ -0,0 +1,463 @@
+/**
+* @file distributedcoordinator.cpp
+* @brief Implementation of the DistributedCoordinator class, which runs the simulation in several worker processes.
+* @details The world is split into vertical strips, one per worker process, which are started from the same
+* executable and connected over a UNIX domain socket. A strip is at least as wide as the band in which robots of two
+* strips can affect each other, even with the largest triangle base, so the bands of a strip do not overlap. All
+* workers step their robots from the state at the start of the tick, as the groups of Environment::RobotGroup. Within
+* the tick the coordinator forwards the sleeping robots and then the blocked robots within the bands of every worker
+* to its neighbours. The robots the workers send from their bands after the tick are forwarded to the neighbouring
+* workers, the robots which have left their strip are given to their new owner. The workers rebuild their neighbour
+* lists in the same ticks, whenever the lists of any worker have become invalid. The coordinator parses the map once,
+* each worker receives only the obstacles and robots of its strip and of the bands around it. The coordinator keeps
+* the whole environment, to which the states gathered from the workers are applied for painting.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "distributedcoordinator.h"
+#include "trianglecache.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <cstring>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/**
+ * @brief Constructor for the DistributedCoordinator class, the workers are started by Start.
+ * @param environment The environment loaded from the map, it receives the states of the robots.
+ * @param workers Requested number of worker processes.
+ */
+DistributedCoordinator::DistributedCoordinator(Environment *environment, int workers)
+{
+    this->environment = environment;
+    requested = qMax(1, workers);
+    stripWidth = 0;
+    sentEdits = 0;
+    rebuild = true;
+}
+
+/**
+ * @brief Destructor for the DistributedCoordinator class, stops the workers.
+ */
+DistributedCoordinator::~DistributedCoordinator()
+{
+    stop();
+}
+
+/**
+ * @brief Splits the world, starts the worker processes and sends them their strips.
+ * @details There are fewer workers than requested if the world is too narrow for the strips. The connections are
+ * awaited in short polls, between which the started workers are checked, so a worker which exits before it connects
+ * fails the start at once. The start fails as well if the workers have not connected within ConnectTimeout. The socket
+ * is created in a new directory only the user can access, which is removed when the workers have connected.
+ * @return False if a worker could not be started or connected.
+ */
+bool DistributedCoordinator::Start()
+{
+    double worldWidth = environment->GetSize().x();
+    int count = qBound(1, static_cast<int>(worldWidth / bandWidth()), requested);
+    stripWidth = worldWidth / count;
+
+    QTemporaryDir directory(QDir::temp().filePath("robots-XXXXXX"));
+    if (!directory.isValid())
+        return false;
+
+    std::string socketPath = directory.filePath("socket").toStdString();
+    int server = Channel::Listen(socketPath);
+    if (server < 0)
+        return false;
+
+    // Workers are started from the running executable
+    char executable[] = "/proc/self/exe";
+    char option[] = "--worker";
+    std::vector<char> path(socketPath.begin(), socketPath.end());
+    path.push_back('\0');
+
+    for (int i = 0; i < count; i++)
+    {
+        char *arguments[] = { executable, option, path.data(), nullptr };
+        pid_t process;
+
+        if (posix_spawn(&process, executable, nullptr, nullptr, arguments, environ) != 0)
+            break;
+
+        processes.push_back(process);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool exited = false;
+
+    while (!exited && channels.size() < processes.size() && timer.elapsed() < ConnectTimeout)
+    {
+        int socket = Channel::Accept(server, PollInterval);
+        if (socket >= 0)
+            channels.push_back(new Channel(socket));
+        else
+            exited = workerExited();
+    }
+
+    ::close(server);
+    ::unlink(socketPath.c_str());
+
+    if (channels.size() != static_cast<size_t>(count))
+    {
+        stop();
+        return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!sendRegion(i))
+        {
+            stop();
+            return false;
+        }
+    }
+
+    // The workers receive the current obstacles, only later edits are repeated
+    sentEdits = environment->GetObstacleEdits().size();
+    return true;
+}
+
+/**
+ * @brief Performs one tick of the simulation in the worker processes.
+ * @return False if a worker has failed.
+ */
+bool DistributedCoordinator::Step()
+{
+    if (!sendObstacleEdits())
+        return false;
+
+    int count = channels.size();
+    std::vector<qint32> flag(1, rebuild);
+    rebuild = false;
+
+    for (auto channel : channels)
+    {
+        if (!channel->Send(Channel::Step, flag))
+            return false;
+    }
+
+    if (!exchange(Channel::Sleepers) || !exchange(Channel::Blocked))
+        return false;
+
+    std::vector<std::vector<Environment::RobotState>> left(count);
+    std::vector<std::vector<Environment::RobotState>> right(count);
+    std::vector<std::vector<Environment::RobotState>> adopted(count);
+    std::vector<Environment::RobotState> migrants;
+
+    // All messages of the tick are read before any is forwarded, a worker may still be writing while others wait
+    for (int i = 0; i < count; i++)
+    {
+        if (!channels[i]->Receive(Channel::GhostsLeft, left[i]) ||
+            !channels[i]->Receive(Channel::GhostsRight, right[i]) ||
+            !channels[i]->Receive(Channel::Migrants, migrants) ||
+            !channels[i]->Receive(Channel::ListsDirty, flag) || flag.size() != 1)
+            return false;
+
+        rebuild = rebuild || flag[0] != 0;
+
+        for (auto &state : migrants)
+            adopted[regionAt(FixedPoint::ToDouble(state.x))].push_back(state);
+    }
+
+    // Every worker has received the blocked robots of the tick, so the ghosts are applied after the tick
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0 && !left[i].empty() && !channels[i - 1]->Send(Channel::Ghosts, left[i]))
+            return false;
+        if (i < count - 1 && !right[i].empty() && !channels[i + 1]->Send(Channel::Ghosts, right[i]))
+            return false;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!adopted[i].empty() && !channels[i]->Send(Channel::Adopt, adopted[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sends the state of robots changed in the environment of the coordinator to all workers.
+ * @details Used when the user starts, stops, controls or moves a robot or changes its triangle. The workers rebuild
+ * their neighbour lists before the next tick, a moved robot or a changed triangle may have made them invalid.
+ * @param numbers Numbers of the changed robots.
+ * @return False if a worker has failed.
+ */
+bool DistributedCoordinator::Update(const std::vector<int> &numbers)
+{
+    if (numbers.empty())
+        return true;
+
+    std::vector<Environment::RobotState> states;
+    for (int number : numbers)
+        states.push_back(environment->GetRobotState(number));
+
+    for (auto channel : channels)
+    {
+        if (!channel->Send(Channel::Update, states))
+            return false;
+    }
+
+    rebuild = true;
+    return true;
+}
+
+/**
+ * @brief Collects the states of all robots from the workers.
+ * @param states Set to the states, each robot once.
+ * @return False if a worker has failed.
+ */
+bool DistributedCoordinator::Snapshot(std::vector<Environment::RobotState> &states)
+{
+    states.clear();
+
+    for (auto channel : channels)
+    {
+        if (!channel->Send(Channel::SnapshotRequest, nullptr, 0))
+            return false;
+    }
+
+    for (auto channel : channels)
+    {
+        std::vector<Environment::RobotState> part;
+        if (!channel->Receive(Channel::Snapshot, part))
+            return false;
+
+        states.insert(states.end(), part.begin(), part.end());
+    }
+
+    return true;
+}
+
+/**
+ * @brief Applies the states of the robots in the workers to the environment of the coordinator.
+ * @return Numbers of the robots which have moved or turned, empty if a worker has failed.
+ */
+const std::vector<int>& DistributedCoordinator::Gather()
+{
+    std::vector<Environment::RobotState> states;
+    changed.clear();
+
+    if (!Snapshot(states))
+        return changed;
+
+    for (auto &state : states)
+    {
+        Robot *robot = environment->GetRobots()[state.number - 1];
+        FixedPoint::Vector position = robot->getFixedPosition();
+
+        if (position.x != state.x || position.y != state.y || robot->angle() != state.direction)
+        {
+            environment->SetRobotState(state);
+            changed.push_back(state.number);
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Returns the number of running worker processes.
+ * @return Number of workers.
+ */
+int DistributedCoordinator::GetWorkerCount()
+{
+    return channels.size();
+}
+
+/**
+ * @brief Computes the width of the band in which robots of neighbouring strips can affect each other.
+ * @details Computed for the largest triangle base, so changing a base does not change the strips.
+ * @return The width in scene units.
+ */
+double DistributedCoordinator::bandWidth()
+{
+    Robot probe(QPointF(0, 0));
+    probe.setBase(TriangleCache::MaxBase);
+
+    return probe.sensedArea().width() / 2 + 2 * Environment::NeighbourSkin + 2 * probe.getMoveDistance();
+}
+
+/**
+ * @brief Sends a worker its strip with the obstacles and the robots within the strip and the bands around it.
+ * @details The outer strips extend to infinity, so robots outside the world are owned by a worker as well.
+ * @param index Index of the worker.
+ * @return False if the worker has failed.
+ */
+bool DistributedCoordinator::sendRegion(int index)
+{
+    int count = channels.size();
+
+    Channel::Region region;
+    region.index = index;
+    region.count = count;
+    region.seed = environment->GetSeed();
+    region.width = environment->GetSize().x();
+    region.height = environment->GetSize().y();
+    region.left = index * stripWidth;
+    region.right = (index + 1) * stripWidth;
+    region.band = bandWidth();
+
+    bool first = index == 0;
+    bool last = index == count - 1;
+    double left = region.left - region.band;
+    double right = region.right + region.band;
+
+    std::vector<Environment::ObstacleEdit> obstacles;
+    for (auto obstacle : environment->GetObstacles())
+    {
+        QRectF rect = obstacle->boundingRect();
+        if ((first || rect.right() >= left) && (last || rect.left() < right))
+            obstacles.push_back({ rect.x(), rect.y(), 1 });
+    }
+
+    std::vector<Environment::RobotState> states;
+    for (int number = 1; number <= static_cast<int>(environment->GetRobots().size()); number++)
+    {
+        double x = environment->GetRobots()[number - 1]->getPosition().x();
+        if ((first || x >= left) && (last || x < right))
+            states.push_back(environment->GetRobotState(number));
+    }
+
+    region.obstacles = obstacles.size();
+    region.robots = states.size();
+
+    size_t obstacleSize = obstacles.size() * sizeof(Environment::ObstacleEdit);
+    size_t stateSize = states.size() * sizeof(Environment::RobotState);
+    std::vector<char> data(sizeof(region) + obstacleSize + stateSize);
+    std::memcpy(data.data(), &region, sizeof(region));
+    if (obstacleSize > 0)
+        std::memcpy(data.data() + sizeof(region), obstacles.data(), obstacleSize);
+    if (stateSize > 0)
+        std::memcpy(data.data() + sizeof(region) + obstacleSize, states.data(), stateSize);
+
+    return channels[index]->Send(Channel::Init, data.data(), data.size());
+}
+
+/**
+ * @brief Sends the obstacles edited in the environment of the coordinator since the last tick to all workers.
+ * @details Every worker repeats the edits within its strip and bands and ignores the others.
+ * @return False if a worker has failed.
+ */
+bool DistributedCoordinator::sendObstacleEdits()
+{
+    const std::vector<Environment::ObstacleEdit> &edits = environment->GetObstacleEdits();
+    if (sentEdits == edits.size())
+        return true;
+
+    const Environment::ObstacleEdit *first = edits.data() + sentEdits;
+    size_t size = (edits.size() - sentEdits) * sizeof(Environment::ObstacleEdit);
+    for (auto channel : channels)
+    {
+        if (!channel->Send(Channel::Obstacles, first, size))
+            return false;
+    }
+
+    sentEdits = edits.size();
+    return true;
+}
+
+/**
+ * @brief Forwards a message with robot numbers from every worker to its neighbouring workers.
+ * @details Every worker waits for the numbers of both neighbours in one message, which is sent even if it is empty.
+ * @param type Type of the message, the workers send and receive the same type.
+ * @return False if a worker has failed.
+ */
+bool DistributedCoordinator::exchange(Channel::Type type)
+{
+    int count = channels.size();
+    std::vector<std::vector<qint32>> parts(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!channels[i]->Receive(type, parts[i]))
+            return false;
+    }
+
+    std::vector<qint32> numbers;
+    for (int i = 0; i < count; i++)
+    {
+        numbers.clear();
+        if (i > 0)
+            numbers.insert(numbers.end(), parts[i - 1].begin(), parts[i - 1].end());
+        if (i < count - 1)
+            numbers.insert(numbers.end(), parts[i + 1].begin(), parts[i + 1].end());
+
+        if (!channels[i]->Send(type, numbers))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Finds the strip containing a position, the outer strips extend to infinity.
+ * @param x The x coordinate of the position.
+ * @return Index of the strip.
+ */
+int DistributedCoordinator::regionAt(double x)
+{
+    return qBound(0, qFloor(x / stripWidth), static_cast<int>(channels.size()) - 1);
+}
+
+/**
+ * @brief Checks whether a started worker has exited and reaps the exited workers.
+ * @return True if a worker has exited.
+ */
+bool DistributedCoordinator::workerExited()
+{
+    bool exited = false;
+
+    for (size_t i = 0; i < processes.size();)
+    {
+        int status;
+        if (::waitpid(processes[i], &status, WNOHANG) != 0)
+        {
+            processes.erase(processes.begin() + i);
+            exited = true;
+        }
+        else
+            i++;
+    }
+
+    return exited;
+}
+
+/**
+ * @brief Asks the workers to quit and waits for them, workers which do not quit are killed.
+ * @details All workers are asked first and then awaited together, at most for QuitTimeout.
+ */
+void DistributedCoordinator::stop()
+{
+    for (auto channel : channels)
+    {
+        channel->Send(Channel::Quit, nullptr, 0);
+        delete channel;
+    }
+    channels.clear();
+
+    for (int waited = 0; !processes.empty() && waited < QuitTimeout; waited += PollInterval)
+    {
+        workerExited();
+        if (!processes.empty())
+            ::usleep(PollInterval * 1000);
+    }
+
+    for (pid_t process : processes)
+    {
+        int status;
+        ::kill(process, SIGTERM);
+        ::waitpid(process, &status, 0);
+    }
+    processes.clear();
+}
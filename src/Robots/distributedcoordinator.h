@@ -0,0 +1,51 @@
+/**
+* @file distributedcoordinator.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef DISTRIBUTEDCOORDINATOR_H
+#define DISTRIBUTEDCOORDINATOR_H
+
+#include "channel.h"
+#include "environment.h"
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+class DistributedCoordinator
+{
+private:
+    Environment *environment;
+    int requested;
+    double stripWidth;
+    std::vector<Channel*> channels;
+    std::vector<pid_t> processes;
+    std::vector<int> changed;
+    size_t sentEdits;
+    bool rebuild;
+
+    double bandWidth();
+    int regionAt(double x);
+    bool sendRegion(int index);
+    bool sendObstacleEdits();
+    bool exchange(Channel::Type type);
+    bool workerExited();
+    void stop();
+
+public:
+    static constexpr int ConnectTimeout = 5000;
+    static constexpr int QuitTimeout = 100;
+    static constexpr int PollInterval = 10;
+
+    DistributedCoordinator(Environment *environment, int workers);
+    ~DistributedCoordinator();
+    bool Start();
+    bool Step();
+    bool Update(const std::vector<int> &numbers);
+    bool Snapshot(std::vector<Environment::RobotState> &states);
+    const std::vector<int>& Gather();
+    int GetWorkerCount();
+};
+
+#endif // DISTRIBUTEDCOORDINATOR_H
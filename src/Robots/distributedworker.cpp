@@ -0,0 +1,481 @@
+/**
+* @file distributedworker.cpp
+* @brief Implementation of the DistributedWorker class, a process simulating one strip of the world.
+* @details The worker holds only the obstacles and robots of its strip and of the bands around it, received from the
+* coordinator, and steps only the robots whose center lies in its strip. The robots of the neighbouring strips within
+* the band of the common edge are kept up to date as ghosts from the messages of the coordinator. The own active
+* robots form one group of the tick, see Environment::RobotGroup, and the active ghosts another group which is only
+* prepared, so the ghosts are read-only neighbours whose sleeping and blocked state comes from their owners. Every
+* decision reads the state at the start of the tick, as in Environment::StepActiveRobots. After every step the worker
+* sends its own robots within the bands of its edges and the robots which have left its strip, which then migrate to
+* the owner of the strip they have entered. A robot which has left a band is sent once more, so no stale copy stays
+* in the band, the ghost is removed when the neighbour lists are rebuilt in the whole world. The robots are numbered
+* locally, the messages carry the numbers of the whole world.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "distributedworker.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Constructor for the DistributedWorker class.
+ * @param socket File descriptor of the connection to the coordinator.
+ */
+DistributedWorker::DistributedWorker(int socket)
+    : channel(socket)
+{
+    environment = nullptr;
+    region = Channel::Region();
+}
+
+/**
+ * @brief Destructor for the DistributedWorker class.
+ */
+DistributedWorker::~DistributedWorker()
+{
+    delete environment;
+}
+
+/**
+ * @brief Connects to the coordinator and serves it until it quits.
+ * @param socketPath Path of the socket of the coordinator.
+ * @return Exit code of the process.
+ */
+int DistributedWorker::Main(const std::string &socketPath)
+{
+    int socket = Channel::Connect(socketPath);
+    if (socket < 0)
+        return 1;
+
+    DistributedWorker worker(socket);
+    return worker.Run();
+}
+
+/**
+ * @brief Handles the messages of the coordinator until it quits or closes the connection.
+ * @return Zero after the Quit message, one on failure.
+ */
+int DistributedWorker::Run()
+{
+    Channel::Type type;
+    std::vector<char> data;
+
+    while (channel.Receive(type, data))
+    {
+        bool ok = true;
+
+        switch (type)
+        {
+        case Channel::Init:
+            ok = load(data);
+            break;
+        case Channel::Step:
+        {
+            std::vector<qint32> rebuild = Channel::Numbers(data);
+            ok = environment != nullptr && rebuild.size() == 1 && step(rebuild[0] != 0);
+            break;
+        }
+        case Channel::Ghosts:
+            for (auto &state : Channel::States(data))
+                place(state);
+            break;
+        case Channel::Adopt:
+            adopt(Channel::States(data));
+            break;
+        case Channel::Update:
+        {
+            // Updates are sent to every worker, each one decides whether it owns the robot now
+            std::vector<Environment::RobotState> states = Channel::States(data);
+            for (auto &state : states)
+            {
+                auto known = indexes.find(state.number);
+                if (known != indexes.end())
+                    owned.erase(std::remove(owned.begin(), owned.end(), known->second), owned.end());
+            }
+            adopt(states);
+            break;
+        }
+        case Channel::SnapshotRequest:
+            ok = environment != nullptr && sendSnapshot();
+            break;
+        case Channel::Obstacles:
+            ok = environment != nullptr;
+            if (ok)
+            {
+                // Only the edits within the strip and its bands are repeated
+                for (auto &edit : Channel::ObstacleEdits(data))
+                {
+                    QRectF rect = Obstacle(QPointF(edit.x, edit.y)).boundingRect();
+                    if (covers(rect.left(), rect.right()))
+                        environment->SetObstacle(rect.topLeft(), edit.present != 0);
+                }
+            }
+            break;
+        case Channel::Quit:
+            return 0;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (!ok)
+            return 1;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Builds the environment of the strip and takes the robots in the strip of the worker.
+ * @param data The region of the worker followed by the obstacles and the robots within the strip and its bands.
+ * @return False if the message is incomplete.
+ */
+bool DistributedWorker::load(const std::vector<char> &data)
+{
+    if (data.size() < sizeof(Channel::Region))
+        return false;
+
+    std::memcpy(&region, data.data(), sizeof(Channel::Region));
+
+    size_t obstacleSize = region.obstacles * sizeof(Environment::ObstacleEdit);
+    size_t stateSize = region.robots * sizeof(Environment::RobotState);
+    if (region.obstacles < 0 || region.robots < 0 || data.size() != sizeof(Channel::Region) + obstacleSize + stateSize)
+        return false;
+
+    std::vector<Environment::ObstacleEdit> obstacles(region.obstacles);
+    std::vector<Environment::RobotState> states(region.robots);
+    if (obstacleSize > 0)
+        std::memcpy(obstacles.data(), data.data() + sizeof(Channel::Region), obstacleSize);
+    if (stateSize > 0)
+        std::memcpy(states.data(), data.data() + sizeof(Channel::Region) + obstacleSize, stateSize);
+
+    delete environment;
+    environment = new Environment(QPointF(region.width, region.height));
+    environment->SetSeed(region.seed);
+
+    owned.clear();
+    numbers.clear();
+    indexes.clear();
+    sentLeft.clear();
+    sentRight.clear();
+    departed.clear();
+
+    for (auto &obstacle : obstacles)
+        environment->CreateObstacle(QPointF(obstacle.x, obstacle.y));
+
+    adopt(states);
+    return true;
+}
+
+/**
+ * @brief Checks whether a position lies in the strip of the worker, the outer strips extend to infinity.
+ * @param x The x coordinate of the position.
+ * @return True if the worker owns a robot at the position.
+ */
+bool DistributedWorker::owns(double x)
+{
+    bool first = region.index == 0;
+    bool last = region.index == region.count - 1;
+
+    return (first || x >= region.left) && (last || x < region.right);
+}
+
+/**
+ * @brief Checks whether a span of x coordinates overlaps the strip of the worker or the bands around it.
+ * @param left The smallest x coordinate.
+ * @param right The largest x coordinate.
+ * @return True if the worker holds the objects within the span.
+ */
+bool DistributedWorker::covers(double left, double right)
+{
+    bool first = region.index == 0;
+    bool last = region.index == region.count - 1;
+
+    return (first || right >= region.left - region.band) && (last || left < region.right + region.band);
+}
+
+/**
+ * @brief Checks whether a position lies in the band of the left edge, which the left neighbour holds as well.
+ * @param x The x coordinate of the position.
+ * @return True if the robot at the position is sent to the left neighbour.
+ */
+bool DistributedWorker::inLeftBand(double x)
+{
+    return region.index > 0 && x < region.left + region.band;
+}
+
+/**
+ * @brief Checks whether a position lies in the band of the right edge, which the right neighbour holds as well.
+ * @param x The x coordinate of the position.
+ * @return True if the robot at the position is sent to the right neighbour.
+ */
+bool DistributedWorker::inRightBand(double x)
+{
+    return region.index < region.count - 1 && x >= region.right - region.band;
+}
+
+/**
+ * @brief Checks whether an own robot lies in the band of an edge, which a neighbour holds as well.
+ * @param index Local index of the robot.
+ * @return True if a neighbour needs the sleeping and blocked state of the robot.
+ */
+bool DistributedWorker::inBand(int index)
+{
+    double x = environment->GetRobots()[index]->getPosition().x();
+    return inLeftBand(x) || inRightBand(x);
+}
+
+/**
+ * @brief Applies the state of a robot, the robot is added if it is not known yet.
+ * @details A robot which has left the strip and its bands departs, it is kept at its last position until the
+ * neighbour lists are rebuilt, see step. An unchanged state is not applied, so it does not wake the robots around.
+ * A new robot has an empty neighbour list until the next rebuild, it enters at the outer edge of a band, out of reach
+ * of the own robots, and a migrant has been a ghost before it is adopted.
+ * @param state The state, the robot is given by its number in the whole world.
+ * @return Local index of the robot, -1 if the worker does not hold it.
+ */
+int DistributedWorker::place(const Environment::RobotState &state)
+{
+    double x = FixedPoint::ToDouble(state.x);
+    auto known = indexes.find(state.number);
+
+    if (!covers(x, x))
+    {
+        if (known != indexes.end())
+            departed[known->second] = true;
+        return -1;
+    }
+
+    int index;
+    if (known != indexes.end())
+        index = known->second;
+    else
+    {
+        environment->CreateRobot(QPointF(x, FixedPoint::ToDouble(state.y)), 0);
+        index = numbers.size();
+        environment->SetRobotIdentity(index + 1, state.number - 1);
+        numbers.push_back(state.number);
+        indexes[state.number] = index;
+        sentLeft.push_back(false);
+        sentRight.push_back(false);
+        departed.push_back(false);
+    }
+
+    departed[index] = false;
+
+    Environment::RobotState local = state;
+    local.number = index + 1;
+
+    Environment::RobotState current = environment->GetRobotState(index + 1);
+    if (current.x != local.x || current.y != local.y || current.direction != local.direction ||
+        current.base != local.base || current.turns != local.turns || current.enabled != local.enabled)
+        environment->SetRobotState(local);
+
+    return index;
+}
+
+/**
+ * @brief Removes a robot, the local indexes of the robots after it move down by one.
+ * @param index Local index of the robot.
+ */
+void DistributedWorker::remove(int index)
+{
+    environment->RemoveRobot(index + 1);
+
+    indexes.erase(numbers[index]);
+    numbers.erase(numbers.begin() + index);
+    sentLeft.erase(sentLeft.begin() + index);
+    sentRight.erase(sentRight.begin() + index);
+    departed.erase(departed.begin() + index);
+
+    owned.erase(std::remove(owned.begin(), owned.end(), index), owned.end());
+    for (int &other : owned)
+        other -= other > index;
+    for (auto &entry : indexes)
+        entry.second -= entry.second > index;
+}
+
+/**
+ * @brief Takes over the given robots which lie in the strip of the worker.
+ * @details The neighbours hold the robots within the bands as well, so such a robot is sent once more after it has
+ * left a band.
+ * @param states The states of the robots.
+ */
+void DistributedWorker::adopt(const std::vector<Environment::RobotState> &states)
+{
+    for (auto &state : states)
+    {
+        int index = place(state);
+        double x = FixedPoint::ToDouble(state.x);
+
+        if (index >= 0 && owns(x))
+        {
+            owned.push_back(index);
+            sentLeft[index] = inLeftBand(x);
+            sentRight[index] = inRightBand(x);
+        }
+    }
+}
+
+/**
+ * @brief Returns the state of a robot numbered as in the whole world.
+ * @param index Local index of the robot.
+ * @return The state.
+ */
+Environment::RobotState DistributedWorker::stateOf(int index)
+{
+    Environment::RobotState state = environment->GetRobotState(index + 1);
+    state.number = numbers[index];
+    return state;
+}
+
+/**
+ * @brief Applies the sleeping state of the ghosts sent by their owners at the start of a tick.
+ * @details The owners know every move which could have woken their robots in the previous tick, the moves of other
+ * strips only reach a worker after the tick.
+ * @param sleepers Sorted numbers of the sleeping robots within the bands of the neighbours.
+ */
+void DistributedWorker::applySleepers(const std::vector<qint32> &sleepers)
+{
+    for (size_t index = 0; index < numbers.size(); index++)
+    {
+        if (ownership[index] || departed[index])
+            continue;
+
+        bool asleep = std::binary_search(sleepers.begin(), sleepers.end(), numbers[index]);
+        if (asleep && !environment->IsSleeping(index + 1))
+            environment->SleepRobot(index + 1);
+        else if (!asleep && environment->IsSleeping(index + 1))
+            environment->WakeRobot(index + 1);
+    }
+}
+
+/**
+ * @brief Steps the own robots and sends the robots within the bands and the robots which have left the strip.
+ * @details The neighbours exchange their sleeping robots within the bands before the tests and their blocked robots
+ * within the bands after the tests, through the coordinator, so the own robots decide as in the whole world. Whether
+ * the neighbour lists have become invalid is sent after the moves, the coordinator decides for all workers together.
+ * @param rebuild True if the neighbour lists are rebuilt in the whole world before this tick.
+ * @return False if the connection has been closed.
+ */
+bool DistributedWorker::step(bool rebuild)
+{
+    // Removing a robot invalidates the neighbour lists, so departed ghosts are only removed before a rebuild
+    if (rebuild)
+    {
+        for (int index = numbers.size() - 1; index >= 0; index--)
+        {
+            if (departed[index])
+                remove(index);
+        }
+    }
+
+    environment->SetNeighboursDirty(rebuild);
+
+    ownership.assign(numbers.size(), false);
+    for (int index : owned)
+        ownership[index] = true;
+
+    std::vector<qint32> sleepers;
+    for (int index : owned)
+    {
+        if (inBand(index) && environment->IsSleeping(index + 1))
+            sleepers.push_back(numbers[index]);
+    }
+
+    if (!channel.Send(Channel::Sleepers, sleepers) || !channel.Receive(Channel::Sleepers, sleepers))
+        return false;
+
+    std::sort(sleepers.begin(), sleepers.end());
+    applySleepers(sleepers);
+    environment->BeginTick();
+
+    ownGroup.robots.clear();
+    ghostGroup.robots.clear();
+    for (int index : environment->GetActiveRobots())
+    {
+        if (ownership[index])
+            ownGroup.robots.push_back(index);
+        else if (!departed[index])
+            ghostGroup.robots.push_back(index);
+    }
+
+    // The ghosts are only prepared, their owners test them
+    environment->PrepareGroup(ownGroup);
+    environment->PrepareGroup(ghostGroup);
+    environment->TestGroup(ownGroup);
+
+    std::vector<qint32> blocked;
+    for (int index : ownGroup.robots)
+    {
+        if (inBand(index) && environment->IsBlocked(index + 1))
+            blocked.push_back(numbers[index]);
+    }
+
+    if (!channel.Send(Channel::Blocked, blocked) || !channel.Receive(Channel::Blocked, blocked))
+        return false;
+
+    for (qint32 number : blocked)
+    {
+        auto known = indexes.find(number);
+        if (known != indexes.end() && !ownership[known->second])
+            environment->BlockRobot(known->second + 1);
+    }
+
+    environment->DecideGroup(ownGroup);
+    environment->ApplySleeps(ownGroup);
+    environment->ApplyMoves(ownGroup);
+
+    std::vector<qint32> dirty(1, environment->AreNeighboursDirty());
+    std::vector<Environment::RobotState> left;
+    std::vector<Environment::RobotState> right;
+    std::vector<Environment::RobotState> migrants;
+    std::vector<int> kept;
+
+    for (int index : owned)
+    {
+        double x = environment->GetRobots()[index]->getPosition().x();
+        bool inLeft = inLeftBand(x);
+        bool inRight = inRightBand(x);
+        Environment::RobotState state = stateOf(index);
+
+        if (inLeft || sentLeft[index])
+            left.push_back(state);
+        if (inRight || sentRight[index])
+            right.push_back(state);
+
+        sentLeft[index] = inLeft;
+        sentRight[index] = inRight;
+
+        if (owns(x))
+            kept.push_back(index);
+        else
+        {
+            migrants.push_back(state);
+            sentLeft[index] = false;
+            sentRight[index] = false;
+        }
+    }
+
+    owned.swap(kept);
+
+    return channel.Send(Channel::GhostsLeft, left) && channel.Send(Channel::GhostsRight, right) &&
+           channel.Send(Channel::Migrants, migrants) && channel.Send(Channel::ListsDirty, dirty);
+}
+
+/**
+ * @brief Sends the states of the own robots.
+ * @return False if the connection has been closed.
+ */
+bool DistributedWorker::sendSnapshot()
+{
+    std::vector<Environment::RobotState> states;
+    states.reserve(owned.size());
+
+    for (int index : owned)
+        states.push_back(stateOf(index));
+
+    return channel.Send(Channel::Snapshot, states);
+}
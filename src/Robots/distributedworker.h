@@ -0,0 +1,54 @@
+/**
+* @file distributedworker.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef DISTRIBUTEDWORKER_H
+#define DISTRIBUTEDWORKER_H
+
+#include "channel.h"
+#include "environment.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class DistributedWorker
+{
+private:
+    Channel channel;
+    Environment *environment;
+    Channel::Region region;
+    std::vector<int> owned;
+    std::vector<qint32> numbers;
+    std::unordered_map<qint32, int> indexes;
+    std::vector<bool> sentLeft;
+    std::vector<bool> sentRight;
+    std::vector<bool> departed;
+    std::vector<bool> ownership;
+    Environment::RobotGroup ownGroup;
+    Environment::RobotGroup ghostGroup;
+
+    bool load(const std::vector<char> &data);
+    bool owns(double x);
+    bool covers(double left, double right);
+    bool inLeftBand(double x);
+    bool inRightBand(double x);
+    bool inBand(int index);
+    int place(const Environment::RobotState &state);
+    void remove(int index);
+    void adopt(const std::vector<Environment::RobotState> &states);
+    Environment::RobotState stateOf(int index);
+    void applySleepers(const std::vector<qint32> &sleepers);
+    bool step(bool rebuild);
+    bool sendSnapshot();
+
+public:
+    explicit DistributedWorker(int socket);
+    ~DistributedWorker();
+    int Run();
+
+    static int Main(const std::string &socketPath);
+};
+
+#endif // DISTRIBUTEDWORKER_H
@@ -0,0 +1,113 @@
+/**
+* @file editcommand.cpp
+* @brief Implementation of the EditCommand class, one entry of the undo/redo log of the map editor.
+* @details A command stores only the region it was applied to and one bit per generated object telling whether the
+* object was actually placed, the objects themselves are generated again by Expand when the command is undone or redone.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "editcommand.h"
+#include <QtMath>
+
+/**
+ * @brief Private constructor for the EditCommand class, use the static factory methods.
+ * @param type Type of the command.
+ * @param from First corner of the rectangle, start of the line or center of the stamp.
+ * @param to Second corner of the rectangle or end of the line.
+ */
+EditCommand::EditCommand(Type type, QPointF from, QPointF to)
+{
+    this->type = type;
+    this->from = from;
+    this->to = to;
+}
+
+/**
+ * @brief Creates a command filling a rectangle with obstacles.
+ * @param rect Rectangle spanned by the centers of the corner obstacles.
+ * @return The created command.
+ */
+EditCommand EditCommand::FillRect(QRectF rect)
+{
+    rect = rect.normalized();
+    return EditCommand(Fill, rect.topLeft(), rect.bottomRight());
+}
+
+/**
+ * @brief Creates a command placing a straight wall of obstacles.
+ * @param from Center of the first obstacle.
+ * @param to Center of the last obstacle, it is rounded to a whole number of obstacles.
+ * @return The created command.
+ */
+EditCommand EditCommand::LineWall(QPointF from, QPointF to)
+{
+    return EditCommand(Line, from, to);
+}
+
+/**
+ * @brief Creates a command placing a copied region.
+ * @param pattern The copied objects, shared by all commands stamping the same region.
+ * @param center Position of the center of the copied region.
+ * @return The created command.
+ */
+EditCommand EditCommand::StampPattern(std::shared_ptr<const Pattern> pattern, QPointF center)
+{
+    EditCommand command(Stamp, center, center);
+    command.pattern = std::move(pattern);
+    return command;
+}
+
+/**
+ * @brief Generates the objects placed by the command.
+ * @details Neighbouring obstacles are exactly one obstacle size apart, so they touch but do not overlap.
+ * @return Objects with absolute positions, always in the same order.
+ */
+Pattern EditCommand::Expand() const
+{
+    Pattern objects;
+    const double size = 25;
+
+    switch (type) {
+    case Fill:
+    {
+        int columns = qFloor((to.x() - from.x()) / size);
+        int rows = qFloor((to.y() - from.y()) / size);
+        objects.reserve(static_cast<size_t>(columns + 1) * (rows + 1));
+
+        for (int row = 0; row <= rows; row++)
+            for (int column = 0; column <= columns; column++)
+                objects.push_back({false, from + QPointF(column * size, row * size), 0});
+        break;
+    }
+    case Line:
+    {
+        QPointF delta = to - from;
+        double length = qMax(qAbs(delta.x()), qAbs(delta.y()));
+        int steps = qRound(length / size);
+        objects.reserve(steps + 1);
+
+        // Step by one obstacle size along the dominant axis
+        QPointF step = length > 0 ? delta * (size / length) : QPointF();
+        for (int i = 0; i <= steps; i++)
+            objects.push_back({false, from + step * i, 0});
+        break;
+    }
+    case Stamp:
+        objects.reserve(pattern->size());
+        for (const PatternEntry &entry : *pattern)
+            objects.push_back({entry.robot, from + entry.position, entry.angle});
+        break;
+    }
+
+    return objects;
+}
+
+/**
+ * @brief Returns the flags telling which of the generated objects were placed.
+ * @return Reference to the flags, in the order of Expand.
+ */
+std::vector<bool>& EditCommand::Placed()
+{
+    return placed;
+}
@@ -0,0 +1,55 @@
+/**
+* @file editcommand.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef EDITCOMMAND_H
+#define EDITCOMMAND_H
+
+#include <QPointF>
+#include <QRectF>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief One object placed by an edit command.
+ * @details In a copied region the position is relative to the center of the region, objects generated by
+ * EditCommand::Expand have absolute positions.
+ */
+struct PatternEntry
+{
+    bool robot;
+    QPointF position;
+    int angle;
+};
+
+typedef std::vector<PatternEntry> Pattern;
+
+class EditCommand
+{
+public:
+    enum Type
+    {
+        Fill,
+        Line,
+        Stamp
+    };
+
+    static EditCommand FillRect(QRectF rect);
+    static EditCommand LineWall(QPointF from, QPointF to);
+    static EditCommand StampPattern(std::shared_ptr<const Pattern> pattern, QPointF center);
+
+    Pattern Expand() const;
+    std::vector<bool>& Placed();
+
+private:
+    Type type;
+    QPointF from;
+    QPointF to;
+    std::shared_ptr<const Pattern> pattern;
+    std::vector<bool> placed;
+    EditCommand(Type type, QPointF from, QPointF to);
+};
+
+#endif // EDITCOMMAND_H
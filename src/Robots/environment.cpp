@@ -6,48 +6,1377 @@
 */
 
 #include "environment.h"
+#include "collisionkernel.h"
 #include "qdebug.h"
 #include "qlogging.h"
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
+#include <numeric>
 #include <string>
 #include <sstream>
 
 /**
  * @brief Constructor for the Environment class, initializes with a specified size.
  * @param size QPointF representing the size of the environment.
+ * @param resolution Size of one cell of the obstacle occupancy grid in scene units.
  */
-Environment::Environment(QPointF size)
+Environment::Environment(QPointF size, double resolution)
+    : occupancy(resolution)
+    , distanceField(size)
 {
     this->size = size;
     controlledRobot = nullptr;
+    controlledNumber = 0;
+    robotIndexDirty = true;
+    neighboursDirty = true;
+    listedRobots = 0;
+    locality = 0;
+    sortedLocality = 0;
+    sleepingCount = 0;
+    collisionChecks = 0;
+    tick = 0;
+    largestReach = 0;
+
+    // Reloading a map after seeding the random number generator again repeats the simulation
+    seed = rand();
+}
+
+/**
+ * @brief Destructor for the Environment class, deallocates obstacles and robots.
+ */
+Environment::~Environment()
+{
+    for (auto obstacle : obstacles)
+    {
+        delete obstacle;
+    }
+
+    for (auto robot : robots)
+    {
+        delete robot;
+    }
+}
+
+/**
+ * @brief Creates an obstacle at a specified position.
+ * @details Only the cells of the occupancy grid and the distance field within the reach of the obstacle are updated.
+ * Sleeping robots watching the obstacle are woken up, the geometry which blocked them has changed.
+ * @param pos QPointF where the obstacle is to be created.
+ * @return False if there already is an obstacle at the position, no second one is created.
+ */
+bool Environment::CreateObstacle(QPointF pos)
+{
+    if (findObstacle(pos) != nullptr)
+        return false;
+
+    Obstacle *obstacle = Obstacle::create(pos);
+    addObstacle(obstacle);
+
+    if (sleepingCount > 0)
+        wakeWatchers(obstacle->boundingRect());
+
+    return true;
+}
+
+/**
+ * @brief Removes an obstacle from the environment, only the parts of the chunks, the occupancy grid and the distance
+ * field around it are updated.
+ * @details The cells of the obstacle are freed in the occupancy grid and the obstacles overlapping it are filled
+ * again. The distance field is computed again around it from the obstacles found in the chunks. Sleeping robots
+ * watching the obstacle are woken up, they may be free now.
+ * @param pos Position of the obstacle, the top left corner as stored in the map.
+ * @return False if there is no obstacle at the position.
+ */
+bool Environment::RemoveObstacle(QPointF pos)
+{
+    Obstacle *obstacle = findObstacle(pos);
+    if (obstacle == nullptr)
+        return false;
+
+    QRectF rect = obstacle->boundingRect();
+
+    for (int chunkY = qFloor(rect.top() / ChunkSize); chunkY <= qFloor(rect.bottom() / ChunkSize); chunkY++)
+    {
+        for (int chunkX = qFloor(rect.left() / ChunkSize); chunkX <= qFloor(rect.right() / ChunkSize); chunkX++)
+        {
+            std::vector<Obstacle*> &list = chunks[chunkKey(chunkX, chunkY)].obstacles;
+            list.erase(std::remove(list.begin(), list.end(), obstacle), list.end());
+        }
+    }
+
+    // The last obstacle takes the place of the removed one
+    int index = obstacle->getIndex();
+    obstacles[index] = obstacles.back();
+    obstacles[index]->setIndex(index);
+    obstacles.pop_back();
+
+    // The obstacles which can change the distance field around the removed one, every obstacle is taken once from
+    // the chunk containing its top left corner
+    double reach = 2 * distanceField.Reach();
+    QRectF area = rect.adjusted(-reach, -reach, reach, reach);
+    QRectF search = area.adjusted(-rect.width(), -rect.height(), 0, 0);
+    std::vector<QRectF> nearby;
+
+    for (int chunkY = qFloor(search.top() / ChunkSize); chunkY <= qFloor(search.bottom() / ChunkSize); chunkY++)
+    {
+        for (int chunkX = qFloor(search.left() / ChunkSize); chunkX <= qFloor(search.right() / ChunkSize); chunkX++)
+        {
+            auto chunk = chunks.find(chunkKey(chunkX, chunkY));
+            if (chunk == chunks.end())
+                continue;
+
+            for (auto other : chunk->second.obstacles)
+            {
+                if (ChunkKey(other->getPosition()) == chunk->first && other->boundingRect().intersects(area))
+                    nearby.push_back(other->boundingRect());
+            }
+        }
+    }
+
+    occupancy.Erase(rect);
+    for (const QRectF &other : nearby)
+    {
+        if (other.intersects(rect))
+            occupancy.Fill(other);
+    }
+
+    distanceField.RemoveObstacle(rect, nearby);
+    delete obstacle;
+
+    if (sleepingCount > 0)
+        wakeWatchers(rect);
+
+    return true;
+}
+
+/**
+ * @brief Adds or removes an obstacle while the simulation runs, for example to open or close a door.
+ * @details The cost depends only on the area around the obstacle, see CreateObstacle and RemoveObstacle. Performed
+ * edits are recorded, so they can be repeated on another copy of the map, see GetObstacleEdits.
+ * @param pos Position of the obstacle, the top left corner as stored in the map.
+ * @param present True to add the obstacle, false to remove it.
+ * @return False if the obstacle already is, or is not, at the position.
+ */
+bool Environment::SetObstacle(QPointF pos, bool present)
+{
+    bool found = findObstacle(pos) != nullptr;
+    if (found == present)
+        return false;
+
+    if (present)
+        CreateObstacle(pos);
+    else
+        RemoveObstacle(pos);
+
+    obstacleEdits.push_back({ pos.x(), pos.y(), present });
+    return true;
+}
+
+/**
+ * @brief Returns the obstacles added or removed by SetObstacle since the map was loaded, in the order of the edits.
+ * @return Reference to the edits.
+ */
+const std::vector<Environment::ObstacleEdit>& Environment::GetObstacleEdits()
+{
+    return obstacleEdits;
+}
+
+/**
+ * @brief Creates a robot at a specified position, it gets the next free number.
+ * @details Sleeping robots watching the position are woken up.
+ * @param pos QPointF where the center of the robot is to be placed.
+ * @param angle Heading of the robot in degrees, rounded down to a multiple of 45 degrees as in a map file.
+ * @return Returns true if the robot is created successfully.
+ */
+bool Environment::CreateRobot(QPointF pos, int angle)
+{
+    Robot *robot = Robot::create(pos);
+    robot->turn(angle / 45);
+    addRobot(robot);
+
+    if (sleepingCount > 0)
+        wakeWatchers(robotArea(pos));
+
+    return true;
+}
+
+/**
+ * @brief Removes a robot from the environment, the robots with higher numbers move down by one.
+ * @details The slot of the robot in the stored positions is taken by the robot in the last slot and the neighbour
+ * lists are rebuilt before the next tick. A removed controlled robot is released. Sleeping robots watching the
+ * robot are woken up.
+ * @param number Number of the robot.
+ */
+void Environment::RemoveRobot(int number)
+{
+    if (number < 1 || number > static_cast<int>(robots.size()))
+        return;
+
+    int index = number - 1;
+    Robot *robot = robots[index];
+    QPointF pos = robot->getPosition();
+
+    if (controlledNumber == number)
+        controlledNumber = 0;
+    else if (controlledNumber > number)
+        controlledNumber--;
+
+    // Waking the robot stops watching its area, it is then taken out of the active robots
+    wake(index);
+    if (activeSlot[index] >= 0)
+    {
+        int last = active.back();
+        active[activeSlot[index]] = last;
+        activeSlot[last] = activeSlot[index];
+        active.pop_back();
+        activeSlot[index] = -1;
+    }
+
+    removeFromChunk(robot, ChunkKey(pos));
+
+    int slot = slotOf[index];
+    int lastSlot = robots.size() - 1;
+    indexAt[slot] = indexAt[lastSlot];
+    slotOf[indexAt[slot]] = slot;
+    positions[slot] = positions[lastSlot];
+    indexAt.pop_back();
+    positions.pop_back();
+
+    robots.erase(robots.begin() + index);
+    slotOf.erase(slotOf.begin() + index);
+    activeSlot.erase(activeSlot.begin() + index);
+    sleeping.erase(sleeping.begin() + index);
+    watched.erase(watched.begin() + index);
+    turns.erase(turns.begin() + index);
+    if (!identities.empty())
+        identities.erase(identities.begin() + index);
+    delete robot;
+
+    // Indexes of the robots after the removed one move down by one
+    for (int &other : indexAt)
+        other -= other > index;
+    for (int &other : active)
+        other -= other > index;
+    for (auto &cell : watchers)
+    {
+        for (int &other : cell.second)
+            other -= other > index;
+    }
+
+    for (size_t i = index; i < robots.size(); i++)
+        robots[i]->setNumber(i + 1);
+
+    controlledRobot = controlledNumber != 0 ? robots[controlledNumber - 1] : nullptr;
+    robotIndexDirty = true;
+    neighboursDirty = true;
+
+    if (sleepingCount > 0)
+        wakeWatchers(robotArea(pos));
+}
+
+/**
+ * @brief Adds an obstacle to the environment, to every chunk it overlaps, to the occupancy grid and to the distance field.
+ * @param obstacle Pointer to the obstacle, the environment takes ownership of it.
+ */
+void Environment::addObstacle(Obstacle *obstacle)
+{
+    obstacle->setIndex(obstacles.size());
+    obstacles.push_back(obstacle);
+
+    QRectF rect = obstacle->boundingRect();
+    occupancy.Fill(rect);
+    distanceField.AddObstacle(rect);
+
+    for (int chunkY = qFloor(rect.top() / ChunkSize); chunkY <= qFloor(rect.bottom() / ChunkSize); chunkY++)
+    {
+        for (int chunkX = qFloor(rect.left() / ChunkSize); chunkX <= qFloor(rect.right() / ChunkSize); chunkX++)
+            chunks[chunkKey(chunkX, chunkY)].obstacles.push_back(obstacle);
+    }
+}
+
+/**
+ * @brief Finds an obstacle by its position in the chunk containing its top left corner.
+ * @param pos Position of the obstacle, the top left corner as stored in the map.
+ * @return Pointer to the obstacle, nullptr if there is no obstacle at the position.
+ */
+Obstacle* Environment::findObstacle(QPointF pos)
+{
+    auto owner = chunks.find(ChunkKey(pos));
+    if (owner == chunks.end())
+        return nullptr;
+
+    for (auto obstacle : owner->second.obstacles)
+    {
+        if (obstacle->getPosition() == pos)
+            return obstacle;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Adds a robot to the environment and to the chunk containing its center.
+ * @details The robot gets an empty neighbour list and is in no other list until the lists are rebuilt.
+ * @param robot Pointer to the robot, the environment takes ownership of it.
+ */
+void Environment::addRobot(Robot *robot)
+{
+    robots.push_back(robot);
+    robot->setNumber(robots.size());
+    chunkRobots(ChunkKey(robot->getPosition())).push_back(robot);
+    robotIndexDirty = true;
+    neighboursDirty = true;
+
+    activeSlot.push_back(-1);
+    sleeping.push_back(false);
+    watched.push_back(QRect());
+    turns.push_back(0);
+    if (!identities.empty())
+        identities.push_back(robots.size() - 1);
+    positions.push_back(robot->getFixedPosition());
+    slotOf.push_back(robots.size() - 1);
+    indexAt.push_back(robots.size() - 1);
+    neighbours.resize(robots.size());
+    neighbours.back().clear();
+    neighboursBuiltAt.resize(robots.size());
+    neighbourRanges.resize(robots.size());
+    neighbourRanges.back() = 0;
+    listedBy.resize(robots.size());
+    listedBy.back().clear();
+    updateActivity(robots.size() - 1);
+}
+
+/**
+ * @brief Removes a robot from a chunk.
+ * @details The chunk is kept when it becomes empty, so robots moving back and forth between chunks do not allocate.
+ * @param robot Pointer to the robot.
+ * @param key Key of the chunk.
+ */
+void Environment::removeFromChunk(Robot *robot, quint64 key)
+{
+    auto chunk = chunks.find(key);
+    if (chunk == chunks.end())
+        return;
+
+    std::vector<Robot*> &members = chunk->second.robots;
+    auto it = std::find(members.begin(), members.end(), robot);
+    if (it != members.end())
+    {
+        *it = members.back();
+        members.pop_back();
+    }
+}
+
+/**
+ * @brief Returns the robots of a chunk, the chunk is created if it does not exist yet.
+ * @details The storage for as many robots as fit into the chunk is reserved when the first robot enters it.
+ * @param key Key of the chunk.
+ * @return Reference to the robots of the chunk.
+ */
+std::vector<Robot*>& Environment::chunkRobots(quint64 key)
+{
+    std::vector<Robot*> &members = chunks[key].robots;
+    if (members.capacity() == 0)
+        members.reserve(packingBound(ChunkSize, ChunkSize));
+
+    return members;
+}
+
+/**
+ * @brief Computes how many robots can have their centers in a rectangle, used to reserve the storage of lists once.
+ * @details Moving robots are kept CollisionKernel::DiscDistance apart, so the discs with that diameter around their
+ * centers do not overlap and lie within the rectangle grown by half of the distance on every side.
+ * @param width Width of the rectangle.
+ * @param height Height of the rectangle.
+ * @return The largest number of robots.
+ */
+int Environment::packingBound(double width, double height)
+{
+    double distance = CollisionKernel::DiscDistance;
+    return qCeil((width + distance) * (height + distance) / (M_PI * distance * distance / 4));
+}
+
+/**
+ * @brief Moves a robot one step forward and updates the chunk it belongs to.
+ * @details Sleeping robots watching the cells the robot leaves or enters are woken up.
+ * @param robot Pointer to the robot of this environment.
+ */
+void Environment::MoveRobot(Robot *robot)
+{
+    QPointF from = robot->getPosition();
+    robot->move();
+    CompleteMove(robot, from);
+}
+
+/**
+ * @brief Updates the chunks, the sleeping robots and the neighbour lists after a robot has moved.
+ * @details Sleeping robots watching the cells the robot leaves or enters are woken up.
+ * @param robot Pointer to the moved robot of this environment.
+ * @param from Position of the robot before the move.
+ */
+void Environment::CompleteMove(Robot *robot, QPointF from)
+{
+    quint64 previous = ChunkKey(from);
+    quint64 current = ChunkKey(robot->getPosition());
+
+    storePosition(robot->getNumber() - 1);
+
+    if (sleepingCount > 0)
+    {
+        wakeWatchers(robotArea(from));
+        wakeWatchers(robotArea(robot->getPosition()));
+    }
+
+    if (previous != current)
+    {
+        removeFromChunk(robot, previous);
+        chunkRobots(current).push_back(robot);
+    }
+
+    robotIndexDirty = true;
+
+    // The lists stay valid until a robot moves by half of the skin, other robots have moved by less than that as well.
+    // The lists are rebuilt one step early, so robots stepped in parallel within a tick never exceed the limit.
+    // Robots added since the last build have no list to measure from.
+    if (!neighboursDirty && static_cast<size_t>(robot->getNumber()) <= listedRobots)
+    {
+        QPointF displacement = robot->getPosition() - neighboursBuiltAt[robot->getNumber() - 1];
+        double limit = NeighbourSkin / 2 - robot->getMoveDistance();
+        if (displacement.x() * displacement.x() + displacement.y() * displacement.y() > limit * limit)
+            neighboursDirty = true;
+    }
+}
+
+/**
+ * @brief Performs one simulation step of all active robots, testing every pair of neighbouring robots once.
+ * @details All active robots form one group, which passes through BeginTick, PrepareGroup, TestGroup, DecideGroup,
+ * ApplySleeps and ApplyMoves. Every robot decides from the positions at the start of the tick, so the result does
+ * not depend on the order of the robots. Robots woken up during the tick were not tested and are stepped in the next
+ * tick.
+ * @return Numbers of the stepped robots, valid until the next call.
+ */
+const std::vector<int>& Environment::StepActiveRobots()
+{
+    BeginTick();
+
+    stepGroup.robots.assign(active.begin(), active.end());
+    PrepareGroup(stepGroup);
+    TestGroup(stepGroup);
+    DecideGroup(stepGroup);
+    ApplySleeps(stepGroup);
+    ApplyMoves(stepGroup);
+
+    stepped.assign(stepGroup.robots.begin(), stepGroup.robots.end());
+    for (int &index : stepped)
+        index++;
+
+    return stepped;
+}
+
+/**
+ * @brief Starts a tick in which groups of robots are stepped, the neighbour lists are brought up to date first.
+ */
+void Environment::BeginTick()
+{
+    UpdateNeighbours();
+
+    tick++;
+    testedAt.resize(robots.size());
+    groupOf.resize(robots.size());
+    groupPosition.resize(robots.size());
+    blocked.resize(robots.size());
+    nextPositions.resize(robots.size());
+    geometries.resize(robots.size());
+}
+
+/**
+ * @brief Marks the robots of a group as tested in this tick and computes their next positions and triangles.
+ * @details Called for all groups of the tick one after another, before any group is tested.
+ * @param group Active robots, each in at most one group of the tick.
+ */
+void Environment::PrepareGroup(RobotGroup &group)
+{
+    group.results.resize(group.robots.size());
+
+    for (size_t i = 0; i < group.robots.size(); i++)
+    {
+        int index = group.robots[i];
+        testedAt[index] = tick;
+        groupOf[index] = &group;
+        groupPosition[index] = i;
+        blocked[index] = false;
+        nextPositions[index] = robots[index]->nextPosition();
+        geometries[index] = robots[index]->geometry();
+    }
+}
+
+/**
+ * @brief Tests the robots of a group against their neighbours and against walls and obstacles.
+ * @details Every pair of neighbouring robots of the group is tested once, from the robot with the longer list, which
+ * contains the other robot. A pair with a robot outside of the group is tested from the robot of the group, also when
+ * only the list of the other robot contains it, so both robots of the pair are tested whichever group they are in. Each
+ * robot of a pair is tested at its next position against the current position of the other one, padded by the step
+ * of the other robot if it is active, and both tests of all pairs are evaluated in one call of the kernel. A robot
+ * hit by a neighbour or blocked by walls and obstacles is blocked. A pair which only comes within the padding would
+ * collide if both robots moved, it is recorded as a conflict and resolved by DecideGroup. Only the robots of the group
+ * are written, so groups can be tested on different threads.
+ * @param group A prepared group.
+ */
+void Environment::TestGroup(RobotGroup &group)
+{
+    group.batch.Clear();
+    group.pairs.clear();
+    group.conflicts.clear();
+
+    // The storage grows with the neighbour lists, not with the pairs found in each tick
+    size_t bound = 0;
+    for (int index : group.robots)
+        bound += 2 * (neighbours[slotOf[index]].size() + listedBy[slotOf[index]].size());
+
+    if (group.pairs.capacity() < bound)
+    {
+        group.pairs.reserve(2 * bound);
+        group.conflicts.reserve(2 * bound);
+        group.batch.Reserve(2 * bound);
+    }
+
+    for (int first : group.robots)
+    {
+        int firstSlot = slotOf[first];
+
+        for (int otherSlot : neighbours[firstSlot])
+        {
+            int second = indexAt[otherSlot];
+
+            // A pair within the group is tested from the robot with the longer list, which contains the other robot
+            if (inGroup(second, group) && (neighbourRanges[otherSlot] > neighbourRanges[firstSlot] ||
+                (neighbourRanges[otherSlot] == neighbourRanges[firstSlot] && otherSlot < firstSlot)))
+                continue;
+
+            group.pairs.push_back(std::make_pair(first, second));
+            addLane(group, first, second);
+            if (activeSlot[second] >= 0)
+                addLane(group, second, first);
+        }
+
+        // A robot outside of the group listing this one with its longer range is paired here as well, the group of
+        // that robot tests the pair from its own list
+        for (int otherSlot : listedBy[firstSlot])
+        {
+            int second = indexAt[otherSlot];
+            if (inGroup(second, group))
+                continue;
+
+            group.pairs.push_back(std::make_pair(first, second));
+            addLane(group, first, second);
+            if (activeSlot[second] >= 0)
+                addLane(group, second, first);
+        }
+    }
+
+    CollisionKernel::TestBatch(group.batch);
+    group.collisionChecks = group.batch.count;
+
+    int lane = 0;
+    for (const std::pair<int, int> &pair : group.pairs)
+    {
+        int first = pair.first;
+        int second = pair.second;
+        quint8 result = group.batch.results[lane++];
+
+        if (result & CollisionKernel::HitFlag)
+            blocked[first] = true;
+
+        if (activeSlot[second] < 0)
+            continue;
+
+        quint8 reverse = group.batch.results[lane++];
+        bool ownSecond = inGroup(second, group);
+
+        if ((reverse & CollisionKernel::HitFlag) && ownSecond)
+            blocked[second] = true;
+
+        // A robot hit by the other one stays, otherwise a pair within the padding collides if both robots move
+        if (!((result | reverse) & CollisionKernel::HitFlag) && ((result | reverse) & CollisionKernel::NearFlag))
+        {
+            group.conflicts.push_back({first, second, ownSecond || knowsOf(second, first)});
+            if (ownSecond)
+                group.conflicts.push_back({second, first, true});
+        }
+    }
+
+    for (int index : group.robots)
+    {
+        if (!blocked[index])
+        {
+            group.collisionChecks++;
+            blocked[index] = !robots[index]->canMoveStatic(*this);
+        }
+    }
+}
+
+/**
+ * @brief Decides the step of every robot of a group after all groups of the tick have been tested.
+ * @details A blocked robot turns away, see turnAway, or waits while a neighbour can still move. A robot in conflict
+ * with a neighbour which can move waits if the neighbour has a lower number or does not know about the conflict, so
+ * of two robots which could collide at most one moves. Every other robot moves. A turn only changes the robot itself,
+ * so groups can be decided on different threads.
+ * @param group A tested group.
+ */
+void Environment::DecideGroup(RobotGroup &group)
+{
+    for (size_t i = 0; i < group.robots.size(); i++)
+    {
+        int index = group.robots[i];
+        group.results[i] = blocked[index] ? turnAway(index, !neighbourCanMove(index)) : Moved;
+    }
+
+    for (const RobotGroup::Conflict &conflict : group.conflicts)
+    {
+        if (!blocked[conflict.robot] && !isBlocked(conflict.other) && (!conflict.mutual || conflict.other < conflict.robot))
+            group.results[groupPosition[conflict.robot]] = Waited;
+    }
+}
+
+/**
+ * @brief Puts the robots of a decided group which cannot move in any heading to sleep.
+ * @details Called for all groups before ApplyMoves, so the moves of the tick wake the robots up again.
+ * @param group A decided group.
+ */
+void Environment::ApplySleeps(RobotGroup &group)
+{
+    for (size_t i = 0; i < group.robots.size(); i++)
+    {
+        if (group.results[i] == Blocked)
+            sleep(group.robots[i]);
+    }
+}
+
+/**
+ * @brief Moves the robots of a decided group which are free to move and counts the tests of the group.
+ * @param group A decided group.
+ */
+void Environment::ApplyMoves(RobotGroup &group)
+{
+    for (size_t i = 0; i < group.robots.size(); i++)
+    {
+        if (group.results[i] == Moved)
+            MoveRobot(robots[group.robots[i]]);
+    }
+
+    collisionChecks += group.collisionChecks;
+}
+
+/**
+ * @brief Returns the largest reach of all robots, up to date after the neighbour lists have been updated.
+ * @details Every change of a triangle base makes the neighbour lists rebuilt before the next tick.
+ * @return The reach in scene units.
+ */
+double Environment::GetLargestReach()
+{
+    return largestReach;
+}
+
+/**
+ * @brief Checks whether a robot is tested in this tick as a part of a group.
+ * @param index Index of the robot.
+ * @param group The group.
+ * @return True if the robot belongs to the group.
+ */
+bool Environment::inGroup(int index, const RobotGroup &group)
+{
+    return testedAt[index] == tick && groupOf[index] == &group;
+}
+
+/**
+ * @brief Checks whether a robot was blocked in the tests of this tick, robots not tested in this tick are not blocked.
+ * @param index Index of the robot.
+ * @return True if the robot is blocked.
+ */
+bool Environment::isBlocked(int index)
+{
+    return testedAt[index] == tick && blocked[index];
+}
+
+/**
+ * @brief Checks whether a robot was blocked in the tests of this tick, for example to send it to another process.
+ * @param number Number of the robot.
+ * @return True if the robot is blocked.
+ */
+bool Environment::IsBlocked(int number)
+{
+    return isBlocked(number - 1);
+}
+
+/**
+ * @brief Marks a robot prepared in this tick as blocked, the robot has been tested by another process.
+ * @details Called after PrepareGroup and before DecideGroup, the group of the robot is not tested.
+ * @param number Number of the robot.
+ */
+void Environment::BlockRobot(int number)
+{
+    if (testedAt[number - 1] == tick)
+        blocked[number - 1] = true;
+}
+
+/**
+ * @brief Checks whether an active neighbour of a robot was not blocked in the tests of this tick.
+ * @param index Index of the robot.
+ * @return True if a neighbour of the robot can move in this tick.
+ */
+bool Environment::neighbourCanMove(int index)
+{
+    for (int slot : neighbours[slotOf[index]])
+    {
+        int other = indexAt[slot];
+        if (activeSlot[other] >= 0 && !isBlocked(other))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Checks whether a robot tested in this tick has tested its pair with another robot as well.
+ * @param index Index of the robot.
+ * @param other Index of the other robot.
+ * @return True if either robot has the other one in its neighbour list.
+ */
+bool Environment::knowsOf(int index, int other)
+{
+    const std::vector<int> &list = neighbours[slotOf[index]];
+    const std::vector<int> &listing = listedBy[slotOf[index]];
+    return testedAt[index] == tick && (std::binary_search(list.begin(), list.end(), slotOf[other]) ||
+                                       std::binary_search(listing.begin(), listing.end(), slotOf[other]));
+}
+
+/**
+ * @brief Adds the test of a robot at its next position against the current position of another robot to a group.
+ * @details The padding covers the step of the other robot if it is active, rounded to fixed point.
+ * @param group The group testing the pair.
+ * @param tested Index of the robot tested at its next position.
+ * @param other Index of the other robot.
+ */
+void Environment::addLane(RobotGroup &group, int tested, int other)
+{
+    FixedPoint::Vector position = positions[slotOf[other]];
+    FixedPoint::Vector next;
+    CollisionQuery query;
+
+    if (testedAt[tested] == tick)
+    {
+        next = nextPositions[tested];
+        query = geometries[tested].query;
+    }
+    else
+    {
+        next = robots[tested]->nextPosition();
+        query = robots[tested]->geometry().query;
+    }
+
+    float padding = activeSlot[other] >= 0 ? robots[other]->getMoveDistance() + 2.0f / FixedPoint::One : 0;
+    group.batch.Add(query, FixedPoint::ToDouble(position.x - next.x), FixedPoint::ToDouble(position.y - next.y), padding);
+}
+
+/**
+ * @brief Turns a blocked robot to a heading free of walls and obstacles.
+ * @details The search for the heading starts at a random heading. The distance field only samples the headings, so if
+ * none of them is free every whole degree is tested exactly, walls, obstacles and other robots alike. Only a robot
+ * which cannot move in any heading is reported as blocked, it would fail the same way until something in its area
+ * changes. While a neighbour can still move in the tick, the exact search is skipped and the robot waits, the move
+ * would wake it up again in the same tick.
+ * @param index Index of the robot.
+ * @param settled False if a neighbour of the robot can move in the tick.
+ * @return Turned if the robot turned, Blocked if it cannot move in any heading, Waited if it skipped the exact search.
+ */
+Environment::StepResult Environment::turnAway(int index, bool settled)
+{
+    Robot *robot = robots[index];
+    int start = randomHeading(index);
+    int heading = robot->freeHeading(*this, start);
+
+    if (heading < 0 && !settled)
+        return Waited;
+
+    if (heading < 0)
+        heading = robot->movableHeading(*this, start);
+
+    if (heading < 0)
+        return Blocked;
+
+    robot->turn(heading - robot->angle());
+    return Turned;
+}
+
+/**
+ * @brief Puts a blocked robot to sleep until anything in the area in which it could be blocked changes.
+ * @param number Number of the robot.
+ */
+void Environment::SleepRobot(int number)
+{
+    sleep(number - 1);
+}
+
+/**
+ * @brief Wakes a sleeping robot up, used when a recorded state of the robots is restored.
+ * @param number Number of the robot.
+ */
+void Environment::WakeRobot(int number)
+{
+    wake(number - 1);
+}
+
+/**
+ * @brief Checks whether a robot sleeps until an object moves into its area.
+ * @param number Number of the robot.
+ * @return True if the robot is sleeping.
+ */
+bool Environment::IsSleeping(int number)
+{
+    return sleeping[number - 1];
+}
+
+/**
+ * @brief Returns a random heading from which a robot starts the search for a free heading.
+ * @details The heading is a hash of the seed of the environment, the identity of the robot and the number of its
+ * previous searches, so it does not depend on the order in which the robots are stepped or on the thread stepping
+ * them. The identity is the index of the robot unless it has been set by SetRobotIdentity.
+ * @param index Index of the robot.
+ * @return Heading in degrees from 0 to 359.
+ */
+int Environment::randomHeading(int index)
+{
+    quint64 identity = identities.empty() ? index : identities[index];
+    quint64 value = (identity << 32 | turns[index]++) + (quint64(seed) + 1) * 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    value = value ^ (value >> 31);
+
+    return static_cast<int>(value % 360);
+}
+
+/**
+ * @brief Retrieves the robots which have to be simulated in the next tick.
+ * @details Stopped, sleeping and controlled robots are not included. The order of the robots changes as they
+ * fall asleep and wake up.
+ * @return Reference to the vector of robot indexes, robot numbers are one higher.
+ */
+const std::vector<int>& Environment::GetActiveRobots()
+{
+    return active;
 }
 
 /**
- * @brief Destructor for the Environment class, deallocates obstacles and robots.
+ * @brief Retrieves the robots which could block a robot in its next step.
+ * @details The lists contain all robots closer than the step plus the reach of the robot plus the radius of the other
+ * robot, extended by a skin of 30 px. They are rebuilt only after a robot has moved by more than half of the skin
+ * since the last build or a triangle has changed.
+ * @param number Number of the robot.
+ * @return Reference to the neighbour list of the robot, slots of the robots in the stored positions.
  */
-Environment::~Environment()
+const std::vector<int>& Environment::GetNeighbours(int number)
 {
-    for (auto obstacle : obstacles)
+    UpdateNeighbours();
+
+    return neighbours[slotOf[number - 1]];
+}
+
+/**
+ * @brief Retrieves the positions of all robots in the order of the curve through the world.
+ * @details Robots close to each other are stored close to each other, so the positions of the neighbours of a robot
+ * share few cache lines. The order changes when the lists of neighbours are rebuilt, robot numbers do not change.
+ * @return Reference to the positions in fixed point, indexed by the slots of the neighbour lists.
+ */
+const std::vector<FixedPoint::Vector>& Environment::GetStoredPositions()
+{
+    return positions;
+}
+
+/**
+ * @brief Rebuilds the neighbour lists if they are no longer valid.
+ * @details Called before robots are stepped in parallel, the lists are then only read.
+ */
+void Environment::UpdateNeighbours()
+{
+    if (neighboursDirty)
+        rebuildNeighbours();
+}
+
+/**
+ * @brief Rebuilds the neighbour lists of all robots, the stored positions are reordered if their locality has degraded.
+ * @details The locality is the mean distance between the slots of a robot and of its neighbours. The positions are
+ * reordered along the Z-order curve when the locality is more than twice as bad as right after the last reordering.
+ */
+void Environment::rebuildNeighbours()
+{
+    buildNeighbours();
+
+    if (locality > 2 * sortedLocality + ReorderSlack)
     {
-        delete obstacle;
+        reorder();
+        buildNeighbours();
+        sortedLocality = locality;
     }
 
-    for (auto robot : robots)
+    neighboursDirty = false;
+}
+
+/**
+ * @brief Builds the neighbour lists of all robots from the robots stored in the surrounding chunks.
+ * @details A robot with a shorter range may not list a robot which lists it, such robots are kept in listedBy, so the
+ * pair is known from both sides.
+ */
+void Environment::buildNeighbours()
+{
+    neighbours.resize(robots.size());
+    neighboursBuiltAt.resize(robots.size());
+    neighbourRanges.resize(robots.size());
+
+    double distance = 0;
+    size_t pairs = 0;
+    largestReach = 0;
+
+    for (size_t slot = 0; slot < robots.size(); slot++)
     {
-        delete robot;
+        int index = indexAt[slot];
+        Robot *robot = robots[index];
+        QPointF pos = robot->getPosition();
+        largestReach = qMax(largestReach, robot->reach());
+        QRectF area = robot->sensedArea().adjusted(-NeighbourSkin, -NeighbourSkin, NeighbourSkin, NeighbourSkin);
+        double range = area.width() / 2;
+
+        // The list never grows beyond the robots fitting into the range, its storage is reserved for them at once
+        std::vector<int> &list = neighbours[slot];
+        list.clear();
+        list.reserve(packingBound(2 * range, 2 * range));
+        neighboursBuiltAt[index] = pos;
+        neighbourRanges[slot] = range;
+
+        ForEachChunk(area, [&](Chunk &chunk) {
+            for (auto other : chunk.robots)
+            {
+                QPointF delta = other->getPosition() - pos;
+                if (other != robot && delta.x() * delta.x() + delta.y() * delta.y() < range * range)
+                {
+                    int otherSlot = slotOf[other->getNumber() - 1];
+                    list.push_back(otherSlot);
+                    distance += std::abs(otherSlot - static_cast<int>(slot));
+                }
+            }
+
+            return true;
+        });
+
+        // The kernel reads the positions in the order of the list
+        std::sort(list.begin(), list.end());
+        pairs += list.size();
+    }
+
+    listedBy.resize(robots.size());
+    for (auto &listing : listedBy)
+        listing.clear();
+
+    for (size_t slot = 0; slot < robots.size(); slot++)
+    {
+        for (int otherSlot : neighbours[slot])
+        {
+            const std::vector<int> &list = neighbours[otherSlot];
+            if (!std::binary_search(list.begin(), list.end(), static_cast<int>(slot)))
+                listedBy[otherSlot].push_back(slot);
+        }
     }
+
+    locality = pairs > 0 ? distance / pairs : 0;
+    listedRobots = robots.size();
 }
 
 /**
- * @brief Creates an obstacle at a specified position.
- * @param pos QPointF where the obstacle is to be created.
- * @return Returns true if the obstacle is created successfully.
+ * @brief Sorts the stored positions along the Z-order curve of the world.
  */
-bool Environment::CreateObstacle(QPointF pos)
+void Environment::reorder()
 {
-    Obstacle *obstacle = Obstacle::create(pos);
-    obstacles.push_back(obstacle);
-    return true;
+    std::vector<std::pair<quint64, int>> &order = reorderBuffer;
+    order.resize(robots.size());
+    for (size_t i = 0; i < robots.size(); i++)
+        order[i] = std::make_pair(mortonCode(robots[i]->getFixedPosition()), static_cast<int>(i));
+
+    std::sort(order.begin(), order.end());
+
+    for (size_t slot = 0; slot < order.size(); slot++)
+    {
+        int index = order[slot].second;
+        indexAt[slot] = index;
+        slotOf[index] = slot;
+        positions[slot] = robots[index]->getFixedPosition();
+    }
+}
+
+/**
+ * @brief Computes the position of a point on the Z-order curve.
+ * @details The bits of the coordinates of the cell of 16 px containing the point are interleaved.
+ * @param position The point in fixed point.
+ * @return The position on the curve.
+ */
+quint64 Environment::mortonCode(FixedPoint::Vector position)
+{
+    auto spread = [](quint64 value) {
+        value &= 0xFFFFFFFFull;
+        value = (value | (value << 16)) & 0x0000FFFF0000FFFFull;
+        value = (value | (value << 8)) & 0x00FF00FF00FF00FFull;
+        value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        value = (value | (value << 2)) & 0x3333333333333333ull;
+        value = (value | (value << 1)) & 0x5555555555555555ull;
+        return value;
+    };
+
+    quint64 cellX = static_cast<quint32>(qMax(0, position.x >> (FixedPoint::Shift + 4)));
+    quint64 cellY = static_cast<quint32>(qMax(0, position.y >> (FixedPoint::Shift + 4)));
+
+    return spread(cellX) | spread(cellY) << 1;
+}
+
+/**
+ * @brief Copies the position of a robot to its slot of the stored positions.
+ * @param index Index of the robot.
+ */
+void Environment::storePosition(int index)
+{
+    positions[slotOf[index]] = robots[index]->getFixedPosition();
+}
+
+/**
+ * @brief Returns the number of collision tests performed so far.
+ * @details A robot tested against the walls and obstacles and a robot tested against another robot are one test
+ * each, a robot tested against its neighbour list counts as one test per neighbour.
+ * @return The total number of tests, it only grows.
+ */
+quint64 Environment::GetCollisionChecks()
+{
+    return collisionChecks;
+}
+
+/**
+ * @brief Checks whether the neighbour lists are rebuilt before the next tick.
+ * @return True if a robot has moved too far since the last build or the robots have changed.
+ */
+bool Environment::AreNeighboursDirty()
+{
+    return neighboursDirty;
+}
+
+/**
+ * @brief Decides whether the neighbour lists are rebuilt before the next tick.
+ * @details Used by a process holding only a part of the world, which rebuilds its lists in the same ticks as the
+ * whole world, so every list contains the same robots. Robots added without a rebuild have an empty list and are not
+ * checked for their displacement until the next one, robots may only be removed right before a rebuild.
+ * @param dirty True to rebuild the lists.
+ */
+void Environment::SetNeighboursDirty(bool dirty)
+{
+    neighboursDirty = dirty;
+}
+
+/**
+ * @brief Returns the number of robots sleeping until an object moves into their area.
+ * @return Number of the sleeping robots.
+ */
+int Environment::GetSleepingCount()
+{
+    return sleepingCount;
+}
+
+/**
+ * @brief Checks whether a robot is simulated, that is it is started, awake and not controlled by the user.
+ * @param number Number of the robot.
+ * @return True if the robot is active.
+ */
+bool Environment::IsActive(int number)
+{
+    return activeSlot[number - 1] >= 0;
+}
+
+/**
+ * @brief Starts or stops a robot.
+ * @param number Number of the robot.
+ * @param enabled New enabled state of the robot.
+ */
+void Environment::SetRobotEnabled(int number, bool enabled)
+{
+    Robot *robot = robots[number - 1];
+
+    if (robot->isEnabled() != enabled)
+        robot->switchEnabled();
+
+    wake(number - 1);
+}
+
+/**
+ * @brief Sets the triangle base of a robot, a sleeping robot is woken up because its triangle has changed.
+ * @param number Number of the robot.
+ * @param base New triangle base.
+ */
+void Environment::SetRobotBase(int number, int base)
+{
+    robots[number - 1]->setBase(base);
+    neighboursDirty = true;
+    wake(number - 1);
+}
+
+/**
+ * @brief Captures the state of a robot, for example to send it to another process.
+ * @param number Number of the robot.
+ * @return The state of the robot.
+ */
+Environment::RobotState Environment::GetRobotState(int number)
+{
+    Robot *robot = robots[number - 1];
+    FixedPoint::Vector position = robot->getFixedPosition();
+
+    RobotState state;
+    state.number = number;
+    state.x = position.x;
+    state.y = position.y;
+    state.direction = robot->angle();
+    state.base = robot->getBase();
+    state.turns = turns[number - 1];
+    state.enabled = robot->isEnabled() && number != controlledNumber;
+    return state;
+}
+
+/**
+ * @brief Replaces the state of a robot, the robot is moved to its new position and woken up.
+ * @details The state of the controlled robot is applied as well, it stays controlled. Only a robot whose position
+ * has changed wakes the robots around it, as a robot turning in a tick does not.
+ * @param state The new state, the robot is given by its number.
+ */
+void Environment::SetRobotState(const RobotState &state)
+{
+    if (state.number < 1 || state.number > static_cast<int>(robots.size()))
+        return;
+
+    Robot *robot = robots[state.number - 1];
+    QPointF from = robot->getPosition();
+    FixedPoint::Vector position = robot->getFixedPosition();
+
+    robot->setState(state.x, state.y, state.direction);
+    turns[state.number - 1] = state.turns;
+
+    if (robot->getBase() != state.base)
+    {
+        robot->setBase(state.base);
+        neighboursDirty = true;
+    }
+
+    if (state.number != controlledNumber && robot->isEnabled() != static_cast<bool>(state.enabled))
+        robot->switchEnabled();
+
+    if (position.x != state.x || position.y != state.y)
+        CompleteMove(robot, from);
+
+    wake(state.number - 1);
+}
+
+/**
+ * @brief Returns the seed of the random headings of the robots.
+ * @return The seed.
+ */
+quint32 Environment::GetSeed()
+{
+    return seed;
+}
+
+/**
+ * @brief Sets the seed of the random headings of the robots, so other processes choose the same headings.
+ * @param seed The seed.
+ */
+void Environment::SetSeed(quint32 seed)
+{
+    this->seed = seed;
+}
+
+/**
+ * @brief Sets the identity of a robot from which its random headings are computed, see randomHeading.
+ * @details Used by a process holding only a part of the world, so its robots choose the same headings as in the
+ * whole world. Once identities are set, they are kept when robots are removed, only the numbers change.
+ * @param number Number of the robot.
+ * @param identity The identity, the index of the robot in the whole world.
+ */
+void Environment::SetRobotIdentity(int number, qint32 identity)
+{
+    if (identities.empty())
+    {
+        identities.resize(robots.size());
+        std::iota(identities.begin(), identities.end(), 0);
+    }
+
+    identities[number - 1] = identity;
+}
+
+/**
+ * @brief Adds a robot to the active robots or removes it, according to its state.
+ * @param index Index of the robot.
+ */
+void Environment::updateActivity(int index)
+{
+    bool isActive = robots[index]->isEnabled() && index + 1 != controlledNumber && !sleeping[index];
+
+    if (isActive && activeSlot[index] < 0)
+    {
+        activeSlot[index] = active.size();
+        active.push_back(index);
+    }
+    else if (!isActive && activeSlot[index] >= 0)
+    {
+        // The last active robot takes the place of the removed one
+        int last = active.back();
+        active[activeSlot[index]] = last;
+        activeSlot[last] = activeSlot[index];
+        active.pop_back();
+        activeSlot[index] = -1;
+    }
+}
+
+/**
+ * @brief Puts a robot to sleep until anything which made it blocked changes.
+ * @details The robot has failed the exact test in every heading, against the robots and the static geometry within its
+ * sensed area. The cells covering the area are watched as the record of this state. The robot is woken up when a
+ * robot moves, is added or is removed in the cells, when an obstacle is added or removed in them, and when its own
+ * position, heading, triangle or enabled state is changed.
+ * @param index Index of the robot.
+ */
+void Environment::sleep(int index)
+{
+    if (sleeping[index])
+        return;
+
+    QRectF area = robots[index]->sensedArea();
+    int firstX = qFloor(area.left() / WatchCellSize);
+    int firstY = qFloor(area.top() / WatchCellSize);
+    int lastX = qFloor(area.right() / WatchCellSize);
+    int lastY = qFloor(area.bottom() / WatchCellSize);
+
+    for (int cellY = firstY; cellY <= lastY; cellY++)
+    {
+        for (int cellX = firstX; cellX <= lastX; cellX++)
+            watchers[chunkKey(cellX, cellY)].push_back(index);
+    }
+
+    watched[index] = QRect(QPoint(firstX, firstY), QPoint(lastX, lastY));
+    sleeping[index] = true;
+    sleepingCount++;
+    updateActivity(index);
+}
+
+/**
+ * @brief Wakes a robot up and stops watching its area, then updates whether the robot is active.
+ * @param index Index of the robot.
+ */
+void Environment::wake(int index)
+{
+    if (sleeping[index])
+    {
+        QRect cells = watched[index];
+
+        for (int cellY = cells.top(); cellY <= cells.bottom(); cellY++)
+        {
+            for (int cellX = cells.left(); cellX <= cells.right(); cellX++)
+            {
+                auto cell = watchers.find(chunkKey(cellX, cellY));
+                if (cell == watchers.end())
+                    continue;
+
+                // Empty cells are kept, so watching the cell again does not allocate
+                std::vector<int> &members = cell->second;
+                members.erase(std::remove(members.begin(), members.end(), index), members.end());
+            }
+        }
+
+        watched[index] = QRect();
+        sleeping[index] = false;
+        sleepingCount--;
+    }
+
+    updateActivity(index);
+}
+
+/**
+ * @brief Wakes up all robots watching the cells overlapping an area.
+ * @param area The area in scene coordinates, such as the disc of a robot or an obstacle.
+ */
+void Environment::wakeWatchers(QRectF area)
+{
+    for (int cellY = qFloor(area.top() / WatchCellSize); cellY <= qFloor(area.bottom() / WatchCellSize); cellY++)
+    {
+        for (int cellX = qFloor(area.left() / WatchCellSize); cellX <= qFloor(area.right() / WatchCellSize); cellX++)
+        {
+            // Waking a robot removes it from the cell
+            auto cell = watchers.find(chunkKey(cellX, cellY));
+            if (cell == watchers.end())
+                continue;
+
+            while (!cell->second.empty())
+                wake(cell->second.back());
+        }
+    }
+}
+
+/**
+ * @brief Returns the square covered by the disc of a robot.
+ * @param pos Position of the center of the robot.
+ * @return The bounding square of the disc.
+ */
+QRectF Environment::robotArea(QPointF pos)
+{
+    return QRectF(pos.x() - 12.5, pos.y() - 12.5, 25, 25);
+}
+
+/**
+ * @brief Retrieves all stored chunks of the environment.
+ * @return Reference to the map of chunks indexed by their keys.
+ */
+std::unordered_map<quint64, Chunk>& Environment::GetChunks()
+{
+    return chunks;
+}
+
+/**
+ * @brief Retrieves the occupancy grid of the obstacles, used for collision tests against static geometry.
+ * @return Reference to the occupancy grid.
+ */
+const OccupancyGrid& Environment::GetOccupancy()
+{
+    return occupancy;
+}
+
+/**
+ * @brief Retrieves the distance field of the obstacles and walls, used for clearance queries.
+ * @return Reference to the distance field.
+ */
+const DistanceField& Environment::GetDistanceField()
+{
+    return distanceField;
+}
+
+/**
+ * @brief Creates the key of the chunk containing a position.
+ * @param pos Position in scene coordinates.
+ * @return Key of the chunk.
+ */
+quint64 Environment::ChunkKey(QPointF pos)
+{
+    return chunkKey(qFloor(pos.x() / ChunkSize), qFloor(pos.y() / ChunkSize));
+}
+
+/**
+ * @brief Creates the key of a chunk from its coordinates.
+ * @param chunkX Column of the chunk.
+ * @param chunkY Row of the chunk.
+ * @return Key of the chunk.
+ */
+quint64 Environment::chunkKey(int chunkX, int chunkY)
+{
+    return (static_cast<quint64>(static_cast<quint32>(chunkY)) << 32) | static_cast<quint32>(chunkX);
 }
 
 /**
@@ -100,6 +1429,8 @@ Environment* Environment::LoadEnvironment(std::ifstream& file)
 
 /**
  * @brief Loads objects (obstacles or robots) into the environment from a file stream.
+ * @details Every object is inserted only into the chunks it occupies. A robot may be followed by the base of its
+ * triangle, the default base is used otherwise.
  * @param file Reference to an ifstream from which the objects are loaded.
  * @return Returns true if all objects are loaded successfully.
  */
@@ -128,14 +1459,15 @@ bool Environment::LoadObjects(std::ifstream& file)
 
         if (tokens[0] == "O" && tokens.size() == 3)
         {
-            Obstacle *obstacle = Obstacle::create(QPointF(x, y));
-            obstacles.push_back(obstacle);
+            addObstacle(Obstacle::create(QPointF(x, y)));
         }
-        else if (tokens[0] == "R" && tokens.size() == 4)
+        else if (tokens[0] == "R" && (tokens.size() == 4 || tokens.size() == 5))
         {
             Robot *robot = Robot::create(QPointF(x, y));
             robot->turn(std::stoi(tokens[3]) / 45);
-            robots.push_back(robot);
+            if (tokens.size() == 5)
+                robot->setBase(qBound(0, std::stoi(tokens[4]), TriangleCache::MaxBase));
+            addRobot(robot);
         }
         else
             return false;
@@ -198,16 +1530,35 @@ Robot& Environment::GetControlledRobot()
     return *controlledRobot;
 }
 
+/**
+ * @brief Retrieves the number of the controlled robot.
+ * @return Number of the controlled robot, zero if no robot is controlled.
+ */
+int Environment::GetControlledNumber()
+{
+    return controlledNumber;
+}
+
 /**
  * @brief Sets the controlled robot in the environment based on the specified index.
  * @param number Index of the robot to be controlled. If zero, controlled robot is set to nullptr.
  */
 void Environment::SetControlledRobot(int number)
 {
+    int previous = controlledNumber;
+
     if (number == 0)
         controlledRobot = nullptr;
     else
         controlledRobot = robots[number-1];
+
+    controlledNumber = number;
+
+    // The released robot is simulated again, the controlled one is left to the user
+    if (previous != 0)
+        wake(previous - 1);
+    if (number != 0)
+        wake(number - 1);
 }
 
 /**
@@ -219,3 +1570,67 @@ Robot& Environment::GetRobotByNumber(int number)
 {
     return *robots[number-1];
 }
+
+/**
+ * @brief Finds the robots intersecting a rectangle using the spatial index of robot positions.
+ * @param rect Rectangle in scene coordinates.
+ * @return Numbers of the found robots in ascending order.
+ */
+std::vector<int> Environment::GetRobotsIn(QRectF rect)
+{
+    std::vector<int> numbers = getRobotIndex().Query(rect);
+
+    for (int &number : numbers)
+        number++;
+
+    return numbers;
+}
+
+/**
+ * @brief Finds the robot at a position using the spatial index of robot positions.
+ * @param pos Position in scene coordinates.
+ * @return Number of the robot at the position, zero if there is none.
+ */
+int Environment::GetRobotAt(QPointF pos)
+{
+    return getRobotIndex().At(pos) + 1;
+}
+
+/**
+ * @brief Finds the obstacle covering a position, only the chunk containing the position is searched.
+ * @param pos Position in scene coordinates.
+ * @return Pointer to the obstacle, nullptr if there is none.
+ */
+Obstacle* Environment::GetObstacleAt(QPointF pos)
+{
+    Obstacle *found = nullptr;
+    ForEachChunk(QRectF(pos, pos), [&](Chunk &chunk) {
+        for (auto obstacle : chunk.obstacles)
+        {
+            if (obstacle->boundingRect().contains(pos))
+            {
+                found = obstacle;
+                return false;
+            }
+        }
+
+        return true;
+    });
+
+    return found;
+}
+
+/**
+ * @brief Returns the spatial index of robot positions, rebuilding it if the robots have moved.
+ * @return Reference to the up-to-date index.
+ */
+RobotIndex& Environment::getRobotIndex()
+{
+    if (robotIndexDirty)
+    {
+        robotIndex.Rebuild(robots);
+        robotIndexDirty = false;
+    }
+
+    return robotIndex;
+}
@@ -7,9 +7,17 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
+#include "chunk.h"
+#include "collisionkernel.h"
+#include "distancefield.h"
 #include "obstacle.h"
+#include "occupancygrid.h"
 #include "robot.h"
+#include "robotindex.h"
+#include <QRect>
+#include <QtMath>
 #include <fstream>
+#include <unordered_map>
 #include <vector>
 
 class Environment
@@ -17,15 +25,133 @@ class Environment
 private:
     QPointF size;
     Robot *controlledRobot;
+    int controlledNumber;
     std::vector<Robot*> robots;
     std::vector<Obstacle*> obstacles;
+    OccupancyGrid occupancy;
+    DistanceField distanceField;
+    std::unordered_map<quint64, Chunk> chunks;
+    RobotIndex robotIndex;
+    bool robotIndexDirty;
     bool checkPosition(QPointF pos);
+    RobotIndex& getRobotIndex();
+    void addObstacle(Obstacle *obstacle);
+    Obstacle* findObstacle(QPointF pos);
+    void addRobot(Robot *robot);
+    void removeFromChunk(Robot *robot, quint64 key);
+    std::vector<Robot*>& chunkRobots(quint64 key);
+    static int packingBound(double width, double height);
+    std::vector<int> active;
+    std::vector<int> activeSlot;
+    std::vector<bool> sleeping;
+    std::vector<QRect> watched;
+    std::unordered_map<quint64, std::vector<int>> watchers;
+    void updateActivity(int index);
+    void sleep(int index);
+    void wake(int index);
+    void wakeWatchers(QRectF area);
+    static QRectF robotArea(QPointF pos);
+    int sleepingCount;
+    quint64 collisionChecks;
+    std::vector<std::vector<int>> neighbours;
+    std::vector<QPointF> neighboursBuiltAt;
+    size_t listedRobots;
+    bool neighboursDirty;
+    void rebuildNeighbours();
+    void buildNeighbours();
+    std::vector<FixedPoint::Vector> positions;
+    std::vector<int> slotOf;
+    std::vector<int> indexAt;
+    std::vector<double> neighbourRanges;
+    std::vector<std::vector<int>> listedBy;
+    double locality;
+    double largestReach;
+    double sortedLocality;
+    void reorder();
+    std::vector<std::pair<quint64, int>> reorderBuffer;
+    void storePosition(int index);
+    static quint64 mortonCode(FixedPoint::Vector position);
+    quint32 seed;
+    std::vector<quint32> turns;
+    std::vector<qint32> identities;
+    int randomHeading(int index);
 
 public:
-    Environment(QPointF size);
+    enum StepResult
+    {
+        Moved,
+        Turned,
+        Blocked,
+        Waited
+    };
+
+    /**
+     * @brief Robots tested and decided together in one tick.
+     * @details The groups of a tick are prepared one after another, then tested, then decided, each pass may run the
+     * groups on different threads, and finally applied one after another: the sleeps of all groups before the moves
+     * of all groups. Each pass only writes the robots of its own group.
+     */
+    struct RobotGroup
+    {
+        /**
+         * @brief A neighbouring robot which could be hit if both robots moved.
+         * @details Mutual if the other robot knows about the conflict too, then only the robot with the higher number
+         * waits, otherwise the robot waits whenever the other one can move.
+         */
+        struct Conflict
+        {
+            int robot;
+            int other;
+            bool mutual;
+        };
+
+        std::vector<int> robots;
+        std::vector<StepResult> results;
+        CollisionBatch batch;
+        std::vector<std::pair<int, int>> pairs;
+        std::vector<Conflict> conflicts;
+        quint64 collisionChecks = 0;
+    };
+
+    /**
+     * @brief Everything another process needs to continue the simulation of a robot.
+     * @details Positions are in fixed point, enabled is false for a stopped robot and for the controlled robot.
+     */
+    struct RobotState
+    {
+        qint32 number;
+        qint32 x;
+        qint32 y;
+        qint32 direction;
+        qint32 base;
+        quint32 turns;
+        qint32 enabled;
+    };
+
+    /**
+     * @brief An obstacle added or removed while the simulation runs, another process repeats it on its own copy of
+     * the map.
+     */
+    struct ObstacleEdit
+    {
+        double x;
+        double y;
+        qint32 present;
+    };
+
+    static constexpr int ChunkSize = 256;
+    static constexpr int WatchCellSize = 32;
+    static constexpr double NeighbourSkin = 30;
+    static constexpr double ReorderSlack = 16;
+
+    Environment(QPointF size, double resolution = 1);
     bool CreateObstacle(QPointF pos);
-    
-    
+    bool RemoveObstacle(QPointF pos);
+    bool CreateRobot(QPointF pos, int angle);
+    void RemoveRobot(int number);
+    bool SetObstacle(QPointF pos, bool present);
+    const std::vector<ObstacleEdit>& GetObstacleEdits();
+
     static Environment* LoadEnvironment(std::ifstream& file);
     bool LoadObjects(std::ifstream& file);
     std::vector<Robot*>& GetRobots();
@@ -34,12 +160,99 @@ public:
     int GetCols();
     bool ContainsPosition(QPointF pos);
     Robot& GetControlledRobot();
+    int GetControlledNumber();
     Robot& GetRobotByNumber(int number);
+    std::vector<int> GetRobotsIn(QRectF rect);
+    int GetRobotAt(QPointF pos);
+    Obstacle* GetObstacleAt(QPointF pos);
 
     void SetControlledRobot(int number);
     QPointF GetSize();
+    void MoveRobot(Robot *robot);
+    const std::vector<int>& StepActiveRobots();
+    void BeginTick();
+    void PrepareGroup(RobotGroup &group);
+    void TestGroup(RobotGroup &group);
+    void DecideGroup(RobotGroup &group);
+    void ApplySleeps(RobotGroup &group);
+    void ApplyMoves(RobotGroup &group);
+    bool IsBlocked(int number);
+    void BlockRobot(int number);
+    double GetLargestReach();
+    void CompleteMove(Robot *robot, QPointF from);
+    void SleepRobot(int number);
+    void WakeRobot(int number);
+    bool IsSleeping(int number);
+    const std::vector<int>& GetActiveRobots();
+    const std::vector<int>& GetNeighbours(int number);
+    const std::vector<FixedPoint::Vector>& GetStoredPositions();
+    void UpdateNeighbours();
+    bool AreNeighboursDirty();
+    void SetNeighboursDirty(bool dirty);
+    bool IsActive(int number);
+    int GetSleepingCount();
+    quint64 GetCollisionChecks();
+    void SetRobotEnabled(int number, bool enabled);
+    void SetRobotBase(int number, int base);
+    RobotState GetRobotState(int number);
+    void SetRobotState(const RobotState &state);
+    quint32 GetSeed();
+    void SetSeed(quint32 seed);
+    void SetRobotIdentity(int number, qint32 identity);
+    std::unordered_map<quint64, Chunk>& GetChunks();
+    const OccupancyGrid& GetOccupancy();
+    const DistanceField& GetDistanceField();
+    static quint64 ChunkKey(QPointF pos);
+
+    /**
+     * @brief Calls a function for every stored chunk overlapping an area.
+     * @details Chunks without objects are skipped. The function returns false to stop the iteration.
+     * @param area The area in scene coordinates.
+     * @param function Function called with a reference to each chunk.
+     * @return False if the iteration was stopped by the function.
+     */
+    template <typename Function>
+    bool ForEachChunk(QRectF area, Function function)
+    {
+        area = area.normalized();
+        int firstX = qMax(0, qFloor(area.left() / ChunkSize));
+        int lastX = qMax(0, qFloor(area.right() / ChunkSize));
+        int firstY = qMax(0, qFloor(area.top() / ChunkSize));
+        int lastY = qMax(0, qFloor(area.bottom() / ChunkSize));
+
+        for (int chunkY = firstY; chunkY <= lastY; chunkY++)
+        {
+            for (int chunkX = firstX; chunkX <= lastX; chunkX++)
+            {
+                auto chunk = chunks.find(chunkKey(chunkX, chunkY));
+                if (chunk != chunks.end() && !function(chunk->second))
+                    return false;
+            }
+        }
+
+        return true;
+    }
 
     ~Environment();
+
+private:
+    StepResult turnAway(int index, bool settled);
+    std::vector<int> stepped;
+    RobotGroup stepGroup;
+    quint64 tick;
+    std::vector<quint64> testedAt;
+    std::vector<const RobotGroup*> groupOf;
+    std::vector<int> groupPosition;
+    std::vector<quint8> blocked;
+    std::vector<FixedPoint::Vector> nextPositions;
+    std::vector<TriangleGeometry> geometries;
+    std::vector<ObstacleEdit> obstacleEdits;
+    bool inGroup(int index, const RobotGroup &group);
+    bool isBlocked(int index);
+    bool neighbourCanMove(int index);
+    bool knowsOf(int index, int other);
+    void addLane(RobotGroup &group, int tested, int other);
+    static quint64 chunkKey(int chunkX, int chunkY);
 };
 
 #endif // ENVIRONMENT_H
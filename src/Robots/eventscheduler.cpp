@@ -0,0 +1,158 @@
+/**
+* @file eventscheduler.cpp
+* @brief Implementation of the EventScheduler class, an event-driven alternative to checking every robot every tick.
+* @details Every robot is given the tick at which it could first possibly touch a wall, an obstacle or another robot,
+* computed from its clearance and from the distance to the nearest robot approaching at the highest possible speed.
+* The robots are kept in a priority queue by this tick. Until it comes due, a robot is known to be free and only
+* steps forward, the collision test and the choice of a new heading are performed for the due robots only. The
+* scheduler saves the tests, not the steps: a robot which is not due is still moved through the environment in every
+* tick. Advancing it lazily in closed form would leave the chunks, the neighbour lists, the watched cells and the
+* robot index stale for the robots which are tested, so the work per tick stays proportional to the active robots.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "eventscheduler.h"
+#include "trianglecache.h"
+
+/**
+ * @brief Constructor for the EventScheduler class, all robots are due in the first tick.
+ * @param environment The simulated environment.
+ */
+EventScheduler::EventScheduler(Environment *environment)
+{
+    this->environment = environment;
+    tick = 0;
+    WakeAll();
+}
+
+/**
+ * @brief Performs one tick of the simulation.
+ * @details Only the active robots of the environment are visited. The due robots form one group of robots, which is
+ * tested and decided as in Environment::StepActiveRobots. Robots which are not due would not be blocked and would not
+ * wait in the tick, so they move one step forward without any test, after the due robots which fall asleep have been
+ * put to sleep. The tick gives the same result as Environment::StepActiveRobots. The due robots which are still
+ * active are scheduled from the positions after all moves.
+ * @return Numbers of the moved, turned or waiting robots, valid until the next call.
+ */
+const std::vector<int>& EventScheduler::Step()
+{
+    environment->BeginTick();
+
+    const std::vector<int> &active = environment->GetActiveRobots();
+
+    tick++;
+    changed.clear();
+    free.clear();
+    group.robots.clear();
+
+    for (size_t i = 0; i < active.size(); i++)
+    {
+        int index = active[i];
+
+        // Robots which have woken up or have been started are tested in this tick
+        if (due[index] == NotScheduled)
+            schedule(index, tick);
+        else if (due[index] > tick)
+            free.push_back(index);
+    }
+
+    while (!queue.empty() && queue.top().first <= tick)
+    {
+        Event event = queue.top();
+        queue.pop();
+
+        // Events replaced by a later call of schedule are skipped
+        int index = event.second;
+        if (event.first != due[index])
+            continue;
+
+        // Stopped, sleeping and controlled robots wait until they are active again
+        due[index] = NotScheduled;
+        if (environment->IsActive(index + 1))
+            group.robots.push_back(index);
+    }
+
+    environment->PrepareGroup(group);
+    environment->TestGroup(group);
+    environment->DecideGroup(group);
+    environment->ApplySleeps(group);
+
+    for (int index : free)
+    {
+        environment->MoveRobot(environment->GetRobots()[index]);
+        changed.push_back(index + 1);
+    }
+
+    environment->ApplyMoves(group);
+
+    // A robot which has fallen asleep is scheduled when it wakes up
+    for (int index : group.robots)
+    {
+        changed.push_back(index + 1);
+        if (environment->IsActive(index + 1))
+            schedule(index, tick + 1 + environment->GetRobots()[index]->safeTicks(*environment, MaxSkip));
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Makes a robot due in the next tick, for example after it has been started or its triangle has changed.
+ * @param number Number of the robot.
+ */
+void EventScheduler::Wake(int number)
+{
+    if (number < 1 || number > static_cast<int>(due.size()))
+        return;
+
+    // The pending event no longer matches and is skipped
+    due[number - 1] = NotScheduled;
+}
+
+/**
+ * @brief Makes the robots around an added obstacle due in the next tick.
+ * @details A robot is scheduled for the clearance it had when it was tested, so it could step into the obstacle
+ * before it comes due. Only robots which can reach the obstacle before their test are woken, with the largest
+ * triangle base, only the chunks around the obstacle are searched.
+ * @param rect The area of the added obstacle.
+ */
+void EventScheduler::WakeNear(QRectF rect)
+{
+    Robot probe(QPointF(0, 0));
+    probe.setBase(TriangleCache::MaxBase);
+
+    double margin = probe.reach() + environment->GetOccupancy().Resolution() + (MaxSkip + 1) * probe.getMoveDistance();
+    QRectF area = rect.adjusted(-margin, -margin, margin, margin);
+
+    environment->ForEachChunk(area, [&](Chunk &chunk) {
+        for (auto robot : chunk.robots)
+        {
+            if (area.contains(robot->getPosition()))
+                Wake(robot->getNumber());
+        }
+
+        return true;
+    });
+}
+
+/**
+ * @brief Makes all robots due in the next tick.
+ * @details Used when a robot moves faster than the simulation, such as the robot controlled by the user.
+ */
+void EventScheduler::WakeAll()
+{
+    queue = decltype(queue)();
+    due.assign(environment->GetRobots().size(), NotScheduled);
+}
+
+/**
+ * @brief Schedules the next test of a robot, replacing the previous one.
+ * @param index Index of the robot.
+ * @param when The tick of the test.
+ */
+void EventScheduler::schedule(int index, quint64 when)
+{
+    due[index] = when;
+    queue.push(Event(when, index));
+}
@@ -0,0 +1,42 @@
+/**
+* @file eventscheduler.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include "environment.h"
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+class EventScheduler
+{
+private:
+    typedef std::pair<quint64, int> Event;
+    static constexpr quint64 NotScheduled = std::numeric_limits<quint64>::max();
+
+    Environment *environment;
+    quint64 tick;
+    std::vector<quint64> due;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    std::vector<int> changed;
+    std::vector<int> free;
+    Environment::RobotGroup group;
+    void schedule(int index, quint64 when);
+
+public:
+    static constexpr int MaxSkip = 32;
+
+    explicit EventScheduler(Environment *environment);
+    const std::vector<int>& Step();
+    void Wake(int number);
+    void WakeNear(QRectF rect);
+    void WakeAll();
+};
+
+#endif // EVENTSCHEDULER_H
@@ -0,0 +1,108 @@
+/**
+* @file fixedpoint.cpp
+* @brief Implementation of the FixedPoint class, integer arithmetic used for the positions and headings of robots.
+* @details The cosine table is written out as constants, so the results do not depend on the floating point
+* implementation of the platform.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "fixedpoint.h"
+#include <QtMath>
+
+/**
+ * @brief Cosine of every whole degree from 0 to 359, scaled by 2^14 and rounded.
+ */
+const qint16 FixedPoint::cosTable[360] = {
+     16384,  16382,  16374,  16362,  16344,  16322,  16294,  16262,  16225,  16182,  16135,  16083,
+     16026,  15964,  15897,  15826,  15749,  15668,  15582,  15491,  15396,  15296,  15191,  15082,
+     14968,  14849,  14726,  14598,  14466,  14330,  14189,  14044,  13894,  13741,  13583,  13421,
+     13255,  13085,  12911,  12733,  12551,  12365,  12176,  11982,  11786,  11585,  11381,  11174,
+     10963,  10749,  10531,  10311,  10087,   9860,   9630,   9397,   9162,   8923,   8682,   8438,
+      8192,   7943,   7692,   7438,   7182,   6924,   6664,   6402,   6138,   5872,   5604,   5334,
+      5063,   4790,   4516,   4240,   3964,   3686,   3406,   3126,   2845,   2563,   2280,   1997,
+      1713,   1428,   1143,    857,    572,    286,      0,   -286,   -572,   -857,  -1143,  -1428,
+     -1713,  -1997,  -2280,  -2563,  -2845,  -3126,  -3406,  -3686,  -3964,  -4240,  -4516,  -4790,
+     -5063,  -5334,  -5604,  -5872,  -6138,  -6402,  -6664,  -6924,  -7182,  -7438,  -7692,  -7943,
+     -8192,  -8438,  -8682,  -8923,  -9162,  -9397,  -9630,  -9860, -10087, -10311, -10531, -10749,
+    -10963, -11174, -11381, -11585, -11786, -11982, -12176, -12365, -12551, -12733, -12911, -13085,
+    -13255, -13421, -13583, -13741, -13894, -14044, -14189, -14330, -14466, -14598, -14726, -14849,
+    -14968, -15082, -15191, -15296, -15396, -15491, -15582, -15668, -15749, -15826, -15897, -15964,
+    -16026, -16083, -16135, -16182, -16225, -16262, -16294, -16322, -16344, -16362, -16374, -16382,
+    -16384, -16382, -16374, -16362, -16344, -16322, -16294, -16262, -16225, -16182, -16135, -16083,
+    -16026, -15964, -15897, -15826, -15749, -15668, -15582, -15491, -15396, -15296, -15191, -15082,
+    -14968, -14849, -14726, -14598, -14466, -14330, -14189, -14044, -13894, -13741, -13583, -13421,
+    -13255, -13085, -12911, -12733, -12551, -12365, -12176, -11982, -11786, -11585, -11381, -11174,
+    -10963, -10749, -10531, -10311, -10087,  -9860,  -9630,  -9397,  -9162,  -8923,  -8682,  -8438,
+     -8192,  -7943,  -7692,  -7438,  -7182,  -6924,  -6664,  -6402,  -6138,  -5872,  -5604,  -5334,
+     -5063,  -4790,  -4516,  -4240,  -3964,  -3686,  -3406,  -3126,  -2845,  -2563,  -2280,  -1997,
+     -1713,  -1428,  -1143,   -857,   -572,   -286,      0,    286,    572,    857,   1143,   1428,
+      1713,   1997,   2280,   2563,   2845,   3126,   3406,   3686,   3964,   4240,   4516,   4790,
+      5063,   5334,   5604,   5872,   6138,   6402,   6664,   6924,   7182,   7438,   7692,   7943,
+      8192,   8438,   8682,   8923,   9162,   9397,   9630,   9860,  10087,  10311,  10531,  10749,
+     10963,  11174,  11381,  11585,  11786,  11982,  12176,  12365,  12551,  12733,  12911,  13085,
+     13255,  13421,  13583,  13741,  13894,  14044,  14189,  14330,  14466,  14598,  14726,  14849,
+     14968,  15082,  15191,  15296,  15396,  15491,  15582,  15668,  15749,  15826,  15897,  15964,
+     16026,  16083,  16135,  16182,  16225,  16262,  16294,  16322,  16344,  16362,  16374,  16382
+};
+
+/**
+ * @brief Converts a coordinate in scene units to fixed point, rounding to the nearest representable value.
+ * @param value The coordinate in scene units.
+ * @return The coordinate in fixed point.
+ */
+qint32 FixedPoint::FromDouble(double value)
+{
+    return static_cast<qint32>(qRound64(value * One));
+}
+
+/**
+ * @brief Converts a fixed point coordinate to scene units, the conversion is exact.
+ * @param value The coordinate in fixed point.
+ * @return The coordinate in scene units.
+ */
+double FixedPoint::ToDouble(qint32 value)
+{
+    return static_cast<double>(value) / One;
+}
+
+/**
+ * @brief Rounds a coordinate in scene units to the nearest value representable in fixed point.
+ * @param value The coordinate in scene units.
+ * @return The rounded coordinate in scene units.
+ */
+double FixedPoint::Round(double value)
+{
+    return ToDouble(FromDouble(value));
+}
+
+/**
+ * @brief Normalizes an angle to the range 0 - 359 degrees.
+ * @param degrees The angle in degrees, it may be negative.
+ * @return The normalized angle.
+ */
+int FixedPoint::Normalize(int degrees)
+{
+    return (degrees % 360 + 360) % 360;
+}
+
+/**
+ * @brief Returns the offset of a point at the given distance in the given direction.
+ * @details The direction is counterclockwise with zero pointing right, the y axis of the scene points down.
+ * The components are rounded to the nearest fixed point value.
+ * @param length The distance in fixed point.
+ * @param degrees The direction in degrees.
+ * @return The offset in fixed point.
+ */
+FixedPoint::Vector FixedPoint::Polar(qint32 length, int degrees)
+{
+    degrees = Normalize(degrees);
+    qint64 cos = cosTable[degrees];
+    qint64 sin = cosTable[Normalize(degrees - 90)];
+    qint64 half = qint64(1) << (TrigShift - 1);
+
+    Vector vector;
+    vector.x = static_cast<qint32>((length * cos + half) >> TrigShift);
+    vector.y = static_cast<qint32>(-((length * sin + half) >> TrigShift));
+    return vector;
+}
@@ -0,0 +1,38 @@
+/**
+* @file fixedpoint.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <QtGlobal>
+
+class FixedPoint
+{
+private:
+    static const qint16 cosTable[360];
+
+public:
+    /**
+     * @brief Offset in fixed point coordinates.
+     */
+    struct Vector
+    {
+        qint32 x;
+        qint32 y;
+    };
+
+    static constexpr int Shift = 8;
+    static constexpr qint32 One = 1 << Shift;
+    static constexpr int TrigShift = 14;
+
+    static qint32 FromDouble(double value);
+    static double ToDouble(qint32 value);
+    static double Round(double value);
+    static int Normalize(int degrees);
+    static Vector Polar(qint32 length, int degrees);
+};
+
+#endif // FIXEDPOINT_H
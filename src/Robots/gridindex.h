@@ -0,0 +1,188 @@
+/**
+* @file gridindex.h
+* @brief Template of a sparse uniform grid used to look up objects by their position.
+* @details Only the cells containing an object are stored, so inserting, removing and looking up an object near
+* a position costs O(1) regardless of the number of objects and of the size of the map.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef GRIDINDEX_H
+#define GRIDINDEX_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QtMath>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+template <typename T>
+class GridIndex
+{
+private:
+    double cellSize;
+    size_t count;
+    std::unordered_map<quint64, std::vector<T>> cells;
+
+    /**
+     * @brief Creates the key of a cell from its coordinates.
+     * @param cellX Column of the cell.
+     * @param cellY Row of the cell.
+     * @return Key of the cell.
+     */
+    static quint64 cellKey(qint64 cellX, qint64 cellY)
+    {
+        return (static_cast<quint64>(static_cast<quint32>(cellY)) << 32) | static_cast<quint32>(cellX);
+    }
+
+public:
+    /**
+     * @brief Constructor for the GridIndex class.
+     * @param cellSize Size of one cell, it must not be smaller than the objects stored in the grid.
+     */
+    explicit GridIndex(double cellSize = 25)
+    {
+        this->cellSize = cellSize;
+        count = 0;
+    }
+
+    /**
+     * @brief Inserts an object into the cell containing its position.
+     * @param item The object to insert.
+     * @param pos Position of the object.
+     */
+    void Insert(T item, QPointF pos)
+    {
+        cells[cellKey(qFloor(pos.x() / cellSize), qFloor(pos.y() / cellSize))].push_back(item);
+        count++;
+    }
+
+    /**
+     * @brief Removes an object from the cell containing its position.
+     * @param item The object to remove.
+     * @param pos Position the object was inserted with.
+     * @return True if the object was found and removed.
+     */
+    bool Remove(T item, QPointF pos)
+    {
+        auto cell = cells.find(cellKey(qFloor(pos.x() / cellSize), qFloor(pos.y() / cellSize)));
+        if (cell == cells.end())
+            return false;
+
+        auto it = std::find(cell->second.begin(), cell->second.end(), item);
+        if (it == cell->second.end())
+            return false;
+
+        *it = cell->second.back();
+        cell->second.pop_back();
+        if (cell->second.empty())
+            cells.erase(cell);
+
+        count--;
+        return true;
+    }
+
+    /**
+     * @brief Removes all objects from the grid.
+     */
+    void Clear()
+    {
+        cells.clear();
+        count = 0;
+    }
+
+    /**
+     * @brief Returns the number of objects in the grid.
+     * @return Number of objects.
+     */
+    size_t Size() const
+    {
+        return count;
+    }
+
+    /**
+     * @brief Finds an object near a position.
+     * @details Searches the cell of the position and its eight neighbours, which contain every object
+     * overlapping the position as long as the objects are not larger than one cell.
+     * @param pos The searched position.
+     * @param predicate Function deciding whether an object matches.
+     * @return The first matching object or a default constructed value if there is none.
+     */
+    template <typename Predicate>
+    T Find(QPointF pos, Predicate predicate) const
+    {
+        qint64 cellX = qFloor(pos.x() / cellSize);
+        qint64 cellY = qFloor(pos.y() / cellSize);
+
+        for (qint64 y = cellY - 1; y <= cellY + 1; y++)
+        {
+            for (qint64 x = cellX - 1; x <= cellX + 1; x++)
+            {
+                auto cell = cells.find(cellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                for (const T &item : cell->second)
+                {
+                    if (predicate(item))
+                        return item;
+                }
+            }
+        }
+
+        return T();
+    }
+
+    /**
+     * @brief Calls a function for every object stored in the cells covering a rectangle.
+     * @details The function may also be called for objects slightly outside the rectangle, the caller filters them.
+     * If the rectangle covers more cells than are occupied, the occupied cells are visited instead.
+     * @param rect The searched rectangle.
+     * @param function Function called with each object.
+     */
+    template <typename Function>
+    void ForEachIn(QRectF rect, Function function) const
+    {
+        rect = rect.normalized();
+        qint64 firstX = qFloor(rect.left() / cellSize);
+        qint64 lastX = qFloor(rect.right() / cellSize);
+        qint64 firstY = qFloor(rect.top() / cellSize);
+        qint64 lastY = qFloor(rect.bottom() / cellSize);
+
+        if (static_cast<double>(lastX - firstX + 1) * (lastY - firstY + 1) > cells.size())
+        {
+            ForEach(function);
+            return;
+        }
+
+        for (qint64 y = firstY; y <= lastY; y++)
+        {
+            for (qint64 x = firstX; x <= lastX; x++)
+            {
+                auto cell = cells.find(cellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                for (const T &item : cell->second)
+                    function(item);
+            }
+        }
+    }
+
+    /**
+     * @brief Calls a function for every object in the grid.
+     * @param function Function called with each object.
+     */
+    template <typename Function>
+    void ForEach(Function function) const
+    {
+        for (const auto &cell : cells)
+        {
+            for (const T &item : cell.second)
+                function(item);
+        }
+    }
+};
+
+#endif // GRIDINDEX_H
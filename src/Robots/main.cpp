@@ -5,12 +5,412 @@
 * @author Rostyslav Kachan
 */
 
+#include "allocationcounter.h"
+#include "collisionkernel.h"
+#include "environment.h"
+#include "eventscheduler.h"
 #include "mainwindow.h"
+#include "mappainter.h"
+#include "regionscheduler.h"
+#include "statetrace.h"
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QStyleFactory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#ifdef ROBOTS_MULTIPROCESS
+#include "distributedcoordinator.h"
+#include "distributedworker.h"
+#endif
+
+/**
+ * @brief Performs one tick of the benchmark, the items of the moved robots are updated as with a display frame.
+ * @param environment The simulated environment.
+ * @param scene The scene painting the environment, nullptr if the ticks are not painted.
+ */
+static void benchmarkTick(Environment *environment, MapPainter *scene)
+{
+    const std::vector<int> &changed = environment->StepActiveRobots();
+
+    if (scene != nullptr)
+    {
+        for (int number : changed)
+            scene->UpdateRobot(*environment, number);
+    }
+}
+
+/**
+ * @brief Runs a map without the user interface and prints the heap allocations of the simulated ticks.
+ * @details The warm-up ticks fill the triangle cache and the storage of the chunks, the neighbour lists and the watched
+ * cells of the environment, they are not measured. Robots entering chunks or falling asleep in places not visited
+ * before still allocate them, so such maps need a longer warm-up. When rendering, every tick also updates the scene
+ * items of the moved robots, see MapPainter::UpdateRobot. No view is shown, so the painting of the scene and the
+ * events Qt posts to process it later are not measured. A measured tick which allocates fails the run, and so does a
+ * build without AllocationCounter.
+ * @param mapPath Path of the map.
+ * @param warmup Number of ticks before the measurement.
+ * @param ticks Number of measured ticks.
+ * @param render True to paint the map into a scene and update it after every tick.
+ * @return Exit code of the process.
+ */
+static int runBenchmark(const char *mapPath, int warmup, int ticks, bool render)
+{
+    std::ifstream file(mapPath);
+    Environment *environment = Environment::LoadEnvironment(file);
+    if (environment == nullptr || !environment->LoadObjects(file))
+    {
+        std::fprintf(stderr, "Cannot load %s\n", mapPath);
+        delete environment;
+        return 1;
+    }
+
+    MapPainter *scene = nullptr;
+    if (render)
+    {
+        scene = new MapPainter();
+        scene->PaintMap(*environment);
+    }
+
+    for (int tick = 0; tick < warmup; tick++)
+        benchmarkTick(environment, scene);
+
+    TickStatistics statistics;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        statistics.BeginTick();
+        benchmarkTick(environment, scene);
+        statistics.EndTick();
+
+        if (statistics.GetLast().allocations > 0)
+            std::printf("tick %d: %llu allocations, %llu bytes\n", warmup + tick, static_cast<unsigned long long>(statistics.GetLast().allocations),
+                        static_cast<unsigned long long>(statistics.GetLast().bytes));
+    }
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    AllocationCounter::Counts total = statistics.GetTotal();
+
+    std::printf("%d robots, %d ticks in %.3f s, %.1f ticks/s\n", static_cast<int>(environment->GetRobots().size()), ticks, seconds,
+                seconds > 0 ? ticks / seconds : 0.0);
+
+    delete scene;
+    delete environment;
+
+    if (!AllocationCounter::IsEnabled())
+    {
+        std::fprintf(stderr, "Allocations are not counted, configure with -DROBOTS_COUNT_ALLOCATIONS=ON\n");
+        return 1;
+    }
+
+    std::printf("%.2f allocations and %.1f bytes per tick, %llu of %d ticks allocated\n", ticks > 0 ? double(total.allocations) / ticks : 0.0,
+                ticks > 0 ? double(total.bytes) / ticks : 0.0, static_cast<unsigned long long>(statistics.GetAllocatingTicks()), ticks);
+
+    return statistics.GetAllocatingTicks() == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Compares every instruction set of the collision kernel supported by the processor with the scalar version.
+ * @param samples Number of random positions tested for every level.
+ * @return Exit code of the process, 1 if any level differs from the scalar version.
+ */
+static int runKernelTest(int samples)
+{
+    CollisionKernel::Level supported = CollisionKernel::Detect();
+    int failed = 0;
+
+    for (int level = CollisionKernel::SSE2; level <= supported; level++)
+    {
+        int failures = CollisionKernel::SelfTest(static_cast<CollisionKernel::Level>(level), samples, level);
+        std::printf("%s: %d samples, %d differ from the scalar version\n", CollisionKernel::LevelName(static_cast<CollisionKernel::Level>(level)),
+                    samples, failures);
+        failed += failures;
+    }
+
+    if (supported == CollisionKernel::Scalar)
+        std::printf("only the scalar version is supported\n");
+
+    return failed == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs a map without the user interface and writes the hash of the state after every tick to a trace file, or
+ * compares the state after every tick with a trace file written before.
+ * @details A checked run uses the seed stored in the trace and as many ticks as it holds, and stops at the first tick
+ * which differs from it. Every mode decides all robots from the state at the start of the tick, so every mode with
+ * any number of threads or worker processes is checked against the same trace, recorded in the step mode. In the
+ * processes mode the states of the robots are gathered from the workers after every tick.
+ * @param mapPath Path of the map.
+ * @param tracePath Path of the trace file.
+ * @param check True to compare with the trace, false to write it.
+ * @param mode Stepping mode, "step" for the default one, "event", "regions" or "processes".
+ * @param threads Number of worker threads of the multi-core mode or of worker processes of the multi-process mode.
+ * @param ticks Number of recorded ticks.
+ * @param seed Seed of the random headings of a recorded run, negative to keep the one of the map.
+ * @return Exit code of the process, 1 if the run differs from the trace.
+ */
+static int runTrace(const char *mapPath, const char *tracePath, bool check, const char *mode, int threads, int ticks, qint64 seed)
+{
+    bool processes = std::strcmp(mode, "processes") == 0;
+#ifndef ROBOTS_MULTIPROCESS
+    if (processes)
+    {
+        std::fprintf(stderr, "The processes mode is not supported on this system\n");
+        return 1;
+    }
+#endif
+
+    if (std::strcmp(mode, "step") != 0 && std::strcmp(mode, "event") != 0 && std::strcmp(mode, "regions") != 0 && !processes)
+    {
+        std::fprintf(stderr, "Unknown mode %s, use step, event, regions or processes\n", mode);
+        return 1;
+    }
+
+    std::ifstream file(mapPath);
+    Environment *environment = Environment::LoadEnvironment(file);
+    if (environment == nullptr || !environment->LoadObjects(file))
+    {
+        std::fprintf(stderr, "Cannot load %s\n", mapPath);
+        delete environment;
+        return 1;
+    }
+
+    TraceWriter writer;
+    TraceChecker checker;
+    bool diverged = false;
+    if (check)
+    {
+        if (!checker.Open(tracePath))
+        {
+            std::fprintf(stderr, "Cannot read the trace %s\n", tracePath);
+            delete environment;
+            return 1;
+        }
+
+        environment->SetSeed(checker.GetSeed());
+    }
+    else if (seed >= 0)
+        environment->SetSeed(seed);
+
+    EventScheduler *scheduler = std::strcmp(mode, "event") == 0 ? new EventScheduler(environment) : nullptr;
+    RegionScheduler *regionScheduler = std::strcmp(mode, "regions") == 0 ? new RegionScheduler(environment, threads) : nullptr;
+
+#ifdef ROBOTS_MULTIPROCESS
+    DistributedCoordinator *coordinator = processes ? new DistributedCoordinator(environment, threads) : nullptr;
+    if (coordinator != nullptr && !coordinator->Start())
+    {
+        std::fprintf(stderr, "Cannot start the worker processes\n");
+        delete coordinator;
+        delete regionScheduler;
+        delete scheduler;
+        delete environment;
+        return 1;
+    }
+#endif
+
+    bool failed = false;
+    bool ok = check ? checker.Check(*environment, diverged) : writer.Open(tracePath, *environment);
+    for (int tick = 0; ok && !diverged && (check || tick < ticks); tick++)
+    {
+        if (scheduler != nullptr)
+            scheduler->Step();
+        else if (regionScheduler != nullptr)
+            regionScheduler->Step();
+#ifdef ROBOTS_MULTIPROCESS
+        else if (coordinator != nullptr)
+        {
+            if (!coordinator->Step())
+            {
+                failed = true;
+                break;
+            }
+
+            coordinator->Gather();
+        }
+#endif
+        else
+            environment->StepActiveRobots();
+
+        ok = check ? checker.Check(*environment, diverged) : writer.Record(*environment);
+    }
+
+    int robots = environment->GetRobots().size();
+#ifdef ROBOTS_MULTIPROCESS
+    if (coordinator != nullptr)
+        std::printf("%d worker processes\n", coordinator->GetWorkerCount());
+    delete coordinator;
+#endif
+    delete scheduler;
+    delete regionScheduler;
+    delete environment;
+
+    if (failed)
+    {
+        std::fprintf(stderr, "A worker process has failed\n");
+        return 1;
+    }
+
+    if (!check)
+    {
+        if (!writer.Close() || !ok)
+        {
+            std::fprintf(stderr, "Cannot write the trace %s\n", tracePath);
+            return 1;
+        }
+
+        std::printf("%d robots, %llu ticks written to %s\n", robots, static_cast<unsigned long long>(writer.GetTicks() - 1), tracePath);
+        return 0;
+    }
+
+    if (diverged)
+    {
+        if (checker.GetDivergentRobot() == 0)
+            std::printf("tick %llu: the map has %d robots, the trace %d\n", static_cast<unsigned long long>(checker.GetDivergentTick()), robots,
+                        checker.GetRobotCount());
+        else
+            std::printf("tick %llu: robot %d diverged, %d robots differ from the trace\n",
+                        static_cast<unsigned long long>(checker.GetDivergentTick()), checker.GetDivergentRobot(), checker.GetDivergentCount());
+        return 1;
+    }
+
+    if (checker.GetTicks() == 0)
+    {
+        std::fprintf(stderr, "The trace %s is empty\n", tracePath);
+        return 1;
+    }
+
+    std::printf("%d robots, %llu ticks match the trace\n", robots, static_cast<unsigned long long>(checker.GetTicks() - 1));
+    return 0;
+}
+
+#ifdef ROBOTS_MULTIPROCESS
+/**
+ * @brief Runs a map without the user interface in several worker processes and prints the throughput.
+ * @param mapPath Path of the map.
+ * @param workers Requested number of worker processes.
+ * @param ticks Number of simulated ticks.
+ * @return Exit code of the process.
+ */
+static int runDistributed(const char *mapPath, int workers, int ticks)
+{
+    std::ifstream file(mapPath);
+    Environment *environment = Environment::LoadEnvironment(file);
+    if (environment == nullptr || !environment->LoadObjects(file))
+    {
+        std::fprintf(stderr, "Cannot load %s\n", mapPath);
+        delete environment;
+        return 1;
+    }
+
+    DistributedCoordinator coordinator(environment, workers);
+    if (!coordinator.Start())
+    {
+        std::fprintf(stderr, "Cannot start the worker processes\n");
+        delete environment;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int tick = 0;
+    while (tick < ticks && coordinator.Step())
+        tick++;
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    coordinator.Gather();
+
+    std::printf("%d robots, %d workers, %d ticks in %.3f s, %.1f ticks/s\n", static_cast<int>(environment->GetRobots().size()),
+                coordinator.GetWorkerCount(), tick, seconds, seconds > 0 ? tick / seconds : 0.0);
+
+    delete environment;
+    return tick == ticks ? 0 : 1;
+}
+#endif // ROBOTS_MULTIPROCESS
 
 int main(int argc, char *argv[])
 {
+    // Robots --bench [--warmup <count>] [--ticks <count>] [--render] <map>
+    if (argc >= 3 && std::strcmp(argv[1], "--bench") == 0)
+    {
+        int warmup = 1000;
+        int ticks = 1000;
+        bool render = false;
+        for (int i = 2; i < argc - 1; i++)
+        {
+            if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc - 1)
+                warmup = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--ticks") == 0 && i + 1 < argc - 1)
+                ticks = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--render") == 0)
+                render = true;
+        }
+
+        if (!render)
+            return runBenchmark(argv[argc - 1], warmup, ticks, false);
+
+        // The scene needs an application, which runs without a display
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+
+        QApplication application(argc, argv);
+        return runBenchmark(argv[argc - 1], warmup, ticks, true);
+    }
+
+    // Robots --kernel-test [--samples <count>]
+    if (argc >= 2 && std::strcmp(argv[1], "--kernel-test") == 0)
+    {
+        int samples = 1000000;
+        if (argc == 4 && std::strcmp(argv[2], "--samples") == 0)
+            samples = std::atoi(argv[3]);
+
+        return runKernelTest(samples);
+    }
+
+    // Robots --trace <file> [--mode <mode>] [--threads <count>] [--ticks <count>] [--seed <seed>] <map>
+    // Robots --check <file> [--mode <mode>] [--threads <count>] <map>
+    if (argc >= 4 && (std::strcmp(argv[1], "--trace") == 0 || std::strcmp(argv[1], "--check") == 0))
+    {
+        const char *mode = "step";
+        int threads = qMax(1u, std::thread::hardware_concurrency());
+        int ticks = 1000;
+        qint64 seed = -1;
+        for (int i = 3; i + 1 < argc - 1; i += 2)
+        {
+            if (std::strcmp(argv[i], "--mode") == 0)
+                mode = argv[i + 1];
+            else if (std::strcmp(argv[i], "--threads") == 0)
+                threads = qMax(1, std::atoi(argv[i + 1]));
+            else if (std::strcmp(argv[i], "--ticks") == 0)
+                ticks = std::atoi(argv[i + 1]);
+            else if (std::strcmp(argv[i], "--seed") == 0)
+                seed = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+
+        return runTrace(argv[argc - 1], argv[2], std::strcmp(argv[1], "--check") == 0, mode, threads, ticks, seed);
+    }
+
+#ifdef ROBOTS_MULTIPROCESS
+    // Worker processes of the multi-process mode are started with the socket of the coordinator
+    if (argc == 3 && std::strcmp(argv[1], "--worker") == 0)
+        return DistributedWorker::Main(argv[2]);
+
+    // Robots --processes <count> [--ticks <count>] <map>
+    if (argc >= 4 && std::strcmp(argv[1], "--processes") == 0)
+    {
+        int ticks = 1000;
+        if (argc == 6 && std::strcmp(argv[3], "--ticks") == 0)
+            ticks = std::atoi(argv[4]);
+
+        return runDistributed(argv[argc - 1], std::atoi(argv[2]), ticks);
+    }
+#endif
+
     QApplication a(argc, argv);
 
     // Set the dark style
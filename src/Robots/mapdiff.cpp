@@ -0,0 +1,241 @@
+/**
+* @file mapdiff.cpp
+* @brief Implementation of the MapDiff class, which applies the changes of a map file edited during a simulation.
+* @details The objects of the loaded map file are remembered. When the file changes, the new objects are compared with
+* them and only the difference is applied to the environment. Obstacles are compared by position, none is added where
+* one already is. No obstacle is added over a robot, it stays pending and is added by a later change of the file.
+* A robot is kept, together with its simulated state, as long as the file still contains its entry, an edited
+* entry is a removed robot and an added one. Kept robots keep their order, added robots are appended after them.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "mapdiff.h"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+/**
+ * @brief Remembers the objects of a map file, called with the file the environment was loaded from.
+ * @param file Reference to an ifstream of the map file.
+ * @return False if the file is not a valid map.
+ */
+bool MapDiff::Load(std::ifstream &file)
+{
+    return read(file, size, obstacles, robots);
+}
+
+/**
+ * @brief Applies the difference between the remembered map file and its new content to the environment.
+ * @details The environment has to contain the remembered robots in the same order. Its size cannot change, a map of
+ * another size has to be loaded again. An obstacle already present, for example added by the user during the
+ * simulation, is not added again. An obstacle refused because a robot stands there is not remembered, it is added by
+ * the next change of the file, when the robot may have moved away.
+ * @param file Reference to an ifstream of the changed map file.
+ * @param environment The environment loaded from the remembered file.
+ * @param changes Receives the removed and added robots and the chunks of the removed and added obstacles.
+ * @return Invalid if the file cannot be read, for example while it is being written, Reload if the map has to be
+ * loaded again, Unchanged if no object changed and Applied otherwise.
+ */
+MapDiff::Result MapDiff::Apply(std::ifstream &file, Environment &environment, Changes &changes)
+{
+    changes.removedRobots.clear();
+    changes.addedRobots = 0;
+    changes.obstacleChunks.clear();
+
+    QPointF newSize;
+    std::vector<QPointF> newObstacles;
+    std::vector<RobotEntry> newRobots;
+    if (!read(file, newSize, newObstacles, newRobots))
+        return Invalid;
+
+    if (newSize != size || environment.GetRobots().size() != robots.size())
+        return Reload;
+
+    // Obstacles present more times in the old file are removed, present more times in the new file added
+    std::unordered_map<quint64, int> counts;
+    for (QPointF pos : obstacles)
+        counts[positionKey(pos)]++;
+    for (QPointF pos : newObstacles)
+        counts[positionKey(pos)]--;
+
+    for (QPointF pos : obstacles)
+    {
+        int &count = counts[positionKey(pos)];
+        if (count > 0 && environment.RemoveObstacle(pos))
+        {
+            count--;
+            changes.obstacleChunks.push_back(Environment::ChunkKey(pos));
+        }
+    }
+
+    std::vector<QPointF> refused;
+    for (QPointF pos : newObstacles)
+    {
+        int &count = counts[positionKey(pos)];
+        if (count < 0)
+        {
+            count++;
+            if (!environment.GetRobotsIn(QRectF(pos, QSizeF(25, 25))).empty())
+            {
+                refused.push_back(pos);
+                continue;
+            }
+
+            // An obstacle added during the simulation at the same position already matches the file
+            if (environment.CreateObstacle(pos))
+                changes.obstacleChunks.push_back(Environment::ChunkKey(pos));
+        }
+    }
+
+    for (QPointF pos : refused)
+        newObstacles.erase(std::find(newObstacles.begin(), newObstacles.end(), pos));
+
+    std::sort(changes.obstacleChunks.begin(), changes.obstacleChunks.end());
+    changes.obstacleChunks.erase(std::unique(changes.obstacleChunks.begin(), changes.obstacleChunks.end()), changes.obstacleChunks.end());
+
+    // Every kept robot takes the first unused new entry equal to its own
+    std::map<std::tuple<int, int, int, int>, std::vector<int>> entries;
+    for (int i = newRobots.size() - 1; i >= 0; i--)
+        entries[std::make_tuple(newRobots[i].x, newRobots[i].y, newRobots[i].angle, newRobots[i].base)].push_back(i);
+
+    std::vector<bool> used(newRobots.size(), false);
+    std::vector<bool> kept(robots.size(), false);
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        auto entry = entries.find(std::make_tuple(robots[i].x, robots[i].y, robots[i].angle, robots[i].base));
+        if (entry == entries.end() || entry->second.empty())
+            continue;
+
+        used[entry->second.back()] = true;
+        entry->second.pop_back();
+        kept[i] = true;
+    }
+
+    std::vector<RobotEntry> remaining;
+    for (size_t i = 0; i < robots.size(); i++)
+    {
+        if (kept[i])
+            remaining.push_back(robots[i]);
+    }
+
+    for (int i = robots.size() - 1; i >= 0; i--)
+    {
+        if (!kept[i])
+        {
+            environment.RemoveRobot(i + 1);
+            changes.removedRobots.push_back(i + 1);
+        }
+    }
+
+    for (size_t i = 0; i < newRobots.size(); i++)
+    {
+        if (used[i])
+            continue;
+
+        environment.CreateRobot(QPointF(newRobots[i].x, newRobots[i].y), newRobots[i].angle);
+        if (newRobots[i].base >= 0)
+            environment.SetRobotBase(environment.GetRobots().size(), newRobots[i].base);
+        remaining.push_back(newRobots[i]);
+        changes.addedRobots++;
+    }
+
+    obstacles.swap(newObstacles);
+    robots.swap(remaining);
+
+    if (changes.removedRobots.empty() && changes.addedRobots == 0 && changes.obstacleChunks.empty())
+        return Unchanged;
+
+    return Applied;
+}
+
+/**
+ * @brief Reads the size and the objects of a map file with the same rules as Environment::LoadEnvironment and
+ * Environment::LoadObjects.
+ * @param file Reference to an ifstream of the map file.
+ * @param size Receives the size of the environment.
+ * @param obstacles Receives the positions of the obstacles.
+ * @param robots Receives the entries of the robots in the order of the file.
+ * @return False if the file is not a valid map.
+ */
+bool MapDiff::read(std::ifstream &file, QPointF &size, std::vector<QPointF> &obstacles, std::vector<RobotEntry> &robots)
+{
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || !std::getline(file, line) || line.find("ENV") != 0)
+        return false;
+
+    std::vector<std::string> tokens;
+    auto split = [&tokens](const std::string &line) {
+        std::stringstream ss(line);
+        std::string token;
+        tokens.clear();
+        while (std::getline(ss, token, ','))
+            tokens.push_back(token);
+    };
+
+    split(line);
+    char *end = nullptr;
+    if (tokens.size() < 3)
+        return false;
+
+    double width = std::strtod(tokens[1].c_str(), &end);
+    if (end == tokens[1].c_str())
+        return false;
+
+    double height = std::strtod(tokens[2].c_str(), &end);
+    if (end == tokens[2].c_str())
+        return false;
+
+    size = QPointF(width, height);
+    obstacles.clear();
+    robots.clear();
+
+    while (std::getline(file, line))
+    {
+        split(line);
+
+        int x, y, angle, base = -1;
+        if (tokens.size() < 3 || !readInteger(tokens[1], x) || !readInteger(tokens[2], y))
+            return false;
+
+        if (tokens[0] == "O" && tokens.size() == 3)
+            obstacles.push_back(QPointF(x, y));
+        else if (tokens[0] == "R" && (tokens.size() == 4 || (tokens.size() == 5 && readInteger(tokens[4], base))) &&
+                 readInteger(tokens[3], angle))
+            robots.push_back({ x, y, angle, tokens.size() == 5 ? qBound(0, base, TriangleCache::MaxBase) : -1 });
+        else
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads an integer the way std::stoi does, without throwing on invalid input.
+ * @param token The text of the integer.
+ * @param value Receives the integer.
+ * @return False if the text does not start with an integer.
+ */
+bool MapDiff::readInteger(const std::string &token, int &value)
+{
+    char *end = nullptr;
+    long result = std::strtol(token.c_str(), &end, 10);
+    if (end == token.c_str())
+        return false;
+
+    value = static_cast<int>(result);
+    return true;
+}
+
+/**
+ * @brief Creates a key of the position of an obstacle, the positions in a map file are whole numbers.
+ * @param pos Position of the obstacle.
+ * @return Key of the position.
+ */
+quint64 MapDiff::positionKey(QPointF pos)
+{
+    return (static_cast<quint64>(static_cast<quint32>(qRound(pos.y()))) << 32) | static_cast<quint32>(qRound(pos.x()));
+}
@@ -0,0 +1,65 @@
+/**
+* @file mapdiff.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef MAPDIFF_H
+#define MAPDIFF_H
+
+#include "environment.h"
+#include <fstream>
+#include <vector>
+
+class MapDiff
+{
+public:
+    /**
+     * @brief Outcome of applying a changed map file.
+     */
+    enum Result
+    {
+        Applied,
+        Unchanged,
+        Invalid,
+        Reload
+    };
+
+    /**
+     * @brief What applying a changed map file did to the environment.
+     * @details Removed robots are given by their numbers before the removal, the highest first, so they can be
+     * removed one by one. Added robots got the numbers after the kept ones.
+     */
+    struct Changes
+    {
+        std::vector<int> removedRobots;
+        int addedRobots;
+        std::vector<quint64> obstacleChunks;
+    };
+
+    bool Load(std::ifstream &file);
+    Result Apply(std::ifstream &file, Environment &environment, Changes &changes);
+
+private:
+    /**
+     * @brief Robot as written in the map file, a robot keeps its entry while it is simulated.
+     * @details The base is -1 if the entry has none, the robot then keeps the default base.
+     */
+    struct RobotEntry
+    {
+        int x;
+        int y;
+        int angle;
+        int base;
+    };
+
+    QPointF size;
+    std::vector<QPointF> obstacles;
+    std::vector<RobotEntry> robots;
+
+    static bool read(std::ifstream &file, QPointF &size, std::vector<QPointF> &obstacles, std::vector<RobotEntry> &robots);
+    static bool readInteger(const std::string &token, int &value);
+    static quint64 positionKey(QPointF pos);
+};
+
+#endif // MAPDIFF_H
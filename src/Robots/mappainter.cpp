@@ -27,6 +27,7 @@ void MapPainter::PaintMap(Environment &environment)
     
     QPen pen(Qt::darkGray); // Set the pen color for drawing lines.
     clear(); // Clear any existing items in the scene.
+    obstacleItems.clear();
 
     // Draw the borders of the map using lines.
     QPointF topLeft = sceneRect().topLeft();
@@ -46,27 +47,176 @@ void MapPainter::PaintMap(Environment &environment)
 
 /**
  * @brief Paints obstacles within the environment onto the map.
+ * @details The obstacles of each chunk are painted as a single item, empty chunks are not visited.
  * @param environment The environment containing obstacles to be painted.
  */
 void MapPainter::paintObstacles(Environment &environment)
 {
-    // Iterate through each obstacle in the environment and paint it on the scene.
-    for (auto obstacle : environment.GetObstacles())
+    for (auto &chunk : environment.GetChunks())
     {
-        ObjectPainter::PaintObstacle(this, obstacle);
+        if (!chunk.second.obstacles.empty())
+            obstacleItems[chunk.first] = ObjectPainter::PaintObstacles(this, chunk.second, chunk.first);
     }
 }
 
+/**
+ * @brief Paints the obstacles of one chunk again after obstacles were added to it or removed from it.
+ * @details Only the item of the chunk is replaced, the items of the other chunks are kept.
+ * @param environment The environment containing the obstacles.
+ * @param key Key of the chunk containing the top left corner of the changed obstacles.
+ */
+void MapPainter::UpdateObstacles(Environment &environment, quint64 key)
+{
+    auto item = obstacleItems.find(key);
+    if (item != obstacleItems.end())
+    {
+        removeItem(item->second);
+        delete item->second;
+        obstacleItems.erase(item);
+    }
+
+    auto chunk = environment.GetChunks().find(key);
+    if (chunk != environment.GetChunks().end() && !chunk->second.obstacles.empty())
+        obstacleItems[key] = ObjectPainter::PaintObstacles(this, chunk->second, key);
+}
+
 /**
  * @brief Paints numbered robots within the environment onto the map.
  * @param environment The environment containing robots to be painted.
  */
 void MapPainter::paintRobots(Environment &environment)
 {
+    robotItems.clear();
+    robotItems.reserve(environment.GetRobots().size());
+
     int counter = 1;
     for (auto robot : environment.GetRobots())
     {
-        ObjectPainter::PaintRobot(this, robot, counter);
+        robotItems.push_back(ObjectPainter::PaintRobot(this, robot, counter));
+        ObjectPainter::PlaceRobot(robotItems.back(), robot, isSelected(counter));
         counter++;
     }
 }
+
+/**
+ * @brief Checks whether a robot is selected in the robot table.
+ * @param number Number of the robot.
+ * @return True if the robot is outlined.
+ */
+bool MapPainter::isSelected(int number)
+{
+    return number <= static_cast<int>(selection.size()) && selection[number - 1];
+}
+
+/**
+ * @brief Paints one robot again without rebuilding the rest of the map.
+ * @details The items of the robot are moved, rotated and outlined in place, no items are created. Falls back to
+ * PaintMap if the robots of the environment no longer match the painted ones.
+ * @param environment The environment containing the robot.
+ * @param number Number of the robot.
+ */
+void MapPainter::UpdateRobot(Environment &environment, int number)
+{
+    if (robotItems.size() != environment.GetRobots().size())
+    {
+        PaintMap(environment);
+        return;
+    }
+
+    if (number < 1 || number > static_cast<int>(robotItems.size()))
+        return;
+
+    ObjectPainter::PlaceRobot(robotItems[number - 1], environment.GetRobots()[number - 1], isSelected(number));
+}
+
+/**
+ * @brief Paints a robot added to the environment after the map was painted.
+ * @param environment The environment containing the robot.
+ * @param number Number of the robot, one after the last painted robot.
+ */
+void MapPainter::AddRobot(Environment &environment, int number)
+{
+    if (number != static_cast<int>(robotItems.size()) + 1 || number > static_cast<int>(environment.GetRobots().size()))
+        return;
+
+    Robot *robot = environment.GetRobots()[number - 1];
+    robotItems.push_back(ObjectPainter::PaintRobot(this, robot, number));
+    ObjectPainter::PlaceRobot(robotItems.back(), robot, isSelected(number));
+}
+
+/**
+ * @brief Removes the items of a robot removed from the environment.
+ * @details The robots after it are numbered again, their items are kept.
+ * @param number Number of the robot before the removal.
+ */
+void MapPainter::RemoveRobot(int number)
+{
+    if (number < 1 || number > static_cast<int>(robotItems.size()))
+        return;
+
+    removeItem(robotItems[number - 1].group);
+    delete robotItems[number - 1].group;
+    robotItems.erase(robotItems.begin() + number - 1);
+
+    if (number <= static_cast<int>(selection.size()))
+        selection.erase(selection.begin() + number - 1);
+
+    for (size_t i = number - 1; i < robotItems.size(); i++)
+        ObjectPainter::NumberRobot(robotItems[i], i + 1);
+}
+
+/**
+ * @brief Sets whether a robot is outlined as selected, the change is visible after the robot is painted again.
+ * @param number Number of the robot.
+ * @param selected True if the robot is selected.
+ */
+void MapPainter::SetSelected(int number, bool selected)
+{
+    if (number > static_cast<int>(selection.size()))
+        selection.resize(number, false);
+
+    selection[number - 1] = selected;
+}
+
+/**
+ * @brief Clears the selection of all robots, the change is visible after the next PaintMap.
+ */
+void MapPainter::ClearSelection()
+{
+    selection.clear();
+}
+
+/**
+ * @brief Sets the monitor which records how long the view takes to paint the scene.
+ * @param monitor The monitor, nullptr to record nothing.
+ */
+void MapPainter::SetMonitor(PerformanceMonitor *monitor)
+{
+    this->monitor = monitor;
+}
+
+/**
+ * @brief Paints the background of the scene, the view paints the items after it.
+ * @details Starts the measurement of the frame.
+ * @param painter The painter of the view.
+ * @param rect The exposed area in scene coordinates.
+ */
+void MapPainter::drawBackground(QPainter *painter, const QRectF &rect)
+{
+    frameTimer.start();
+    QGraphicsScene::drawBackground(painter, rect);
+}
+
+/**
+ * @brief Paints the foreground of the scene, the view has painted the items before it.
+ * @details Records the time since the background was painted as the duration of the frame.
+ * @param painter The painter of the view.
+ * @param rect The exposed area in scene coordinates.
+ */
+void MapPainter::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    QGraphicsScene::drawForeground(painter, rect);
+
+    if (monitor != nullptr && frameTimer.isValid())
+        monitor->RecordRender(frameTimer.nsecsElapsed());
+}
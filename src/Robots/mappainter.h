@@ -8,19 +8,50 @@
 #define MAPPAINTER_H
 
 #include "environment.h"
+#include "performancemonitor.h"
+#include <QElapsedTimer>
 #include <QGraphicsScene>
 
 class MapPainter : public QGraphicsScene
 {
 public:
+    /**
+     * @brief Items of a painted robot, drawn around the origin and moved and rotated with the robot.
+     */
+    struct RobotItem
+    {
+        QGraphicsItemGroup *group;
+        QGraphicsPolygonItem *triangle;
+        QGraphicsEllipseItem *outline;
+        QGraphicsTextItem *label;
+        int base;
+    };
+
     int width;
     int height;
     explicit MapPainter(QObject *parent = nullptr);
     void PaintMap(Environment &environment);
+    void UpdateRobot(Environment &environment, int number);
+    void AddRobot(Environment &environment, int number);
+    void RemoveRobot(int number);
+    void UpdateObstacles(Environment &environment, quint64 key);
+    void SetSelected(int number, bool selected);
+    void ClearSelection();
+    void SetMonitor(PerformanceMonitor *monitor);
+
+protected:
+    void drawBackground(QPainter *painter, const QRectF &rect) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
 
 private:
+    PerformanceMonitor *monitor = nullptr;
+    QElapsedTimer frameTimer;
+    std::vector<bool> selection;
+    std::vector<RobotItem> robotItems;
+    std::unordered_map<quint64, QGraphicsItem*> obstacleItems;
     void paintObstacles(Environment &environment);
     void paintRobots(Environment &environment);
+    bool isSelected(int number);
 };
 
 #endif // MAPPAINTER_H
@@ -0,0 +1,106 @@
+/**
+* @file mapsaver.cpp
+* @brief Implementation of the MapSaver class, that writes a map created in the editor to a CSV file on a background thread.
+* @details The lines are formatted into a large buffer which is written at once, the file replaces the original only
+* after all data has been written, so an interrupted save never leaves a half-written map behind.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "mapsaver.h"
+#include <QSaveFile>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Constructor for the MapSaver class.
+ * @param filePath Path to the saved file.
+ * @param width Width of the room.
+ * @param height Height of the room.
+ * @param records Snapshot of all objects of the room, taken on the GUI thread.
+ * @param parent The parent QObject.
+ */
+MapSaver::MapSaver(QString filePath, int width, int height, std::vector<MapRecord> records, QObject *parent)
+    : QThread(parent)
+    , filePath(filePath)
+    , width(width)
+    , height(height)
+    , records(std::move(records))
+{}
+
+/**
+ * @brief Writes the map, reporting progress and stopping when an interruption is requested.
+ */
+void MapSaver::run()
+{
+    const size_t bufferSize = 1 << 20;
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        emit saved(false, file.errorString());
+        return;
+    }
+
+    std::string buffer;
+    buffer.reserve(bufferSize + 64);
+
+    char line[64];
+    std::snprintf(line, sizeof(line), "ENV,%d,%d\n", width, height);
+    buffer += "Type, row, col, angle(robot)\n";
+    buffer += line;
+
+    int reported = -1;
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const MapRecord &record = records[i];
+
+        // %g formats numbers like the default std::ostream output used in the existing map files
+        if (record.robot)
+            std::snprintf(line, sizeof(line), "R,%g,%g,%d\n", record.x, record.y, record.angle);
+        else
+            std::snprintf(line, sizeof(line), "O,%g,%g\n", record.x, record.y);
+        buffer += line;
+
+        if (buffer.size() >= bufferSize || i + 1 == records.size())
+        {
+            if (isInterruptionRequested())
+            {
+                // The temporary file is discarded, the original map stays untouched
+                file.cancelWriting();
+                emit saved(false, QString());
+                return;
+            }
+
+            if (file.write(buffer.data(), buffer.size()) != static_cast<qint64>(buffer.size()))
+            {
+                emit saved(false, file.errorString());
+                return;
+            }
+            buffer.clear();
+
+            int percent = static_cast<int>((i + 1) * 100 / records.size());
+            if (percent != reported)
+            {
+                reported = percent;
+                emit progressChanged(percent);
+            }
+        }
+    }
+
+    if (!buffer.empty() && file.write(buffer.data(), buffer.size()) != static_cast<qint64>(buffer.size()))
+    {
+        emit saved(false, file.errorString());
+        return;
+    }
+
+    if (!file.commit())
+    {
+        emit saved(false, file.errorString());
+        return;
+    }
+
+    emit progressChanged(100);
+    emit saved(true, QString());
+}
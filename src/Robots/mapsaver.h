@@ -0,0 +1,46 @@
+/**
+* @file mapsaver.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef MAPSAVER_H
+#define MAPSAVER_H
+
+#include <QThread>
+#include <QString>
+#include <vector>
+
+/**
+ * @brief One line of a saved map, obstacles are stored with their top left corner and robots with their center.
+ */
+struct MapRecord
+{
+    bool robot;
+    double x;
+    double y;
+    int angle;
+};
+
+class MapSaver : public QThread
+{
+    Q_OBJECT
+
+public:
+    MapSaver(QString filePath, int width, int height, std::vector<MapRecord> records, QObject *parent = nullptr);
+
+Q_SIGNALS:
+    void progressChanged(int percent);
+    void saved(bool success, QString error);
+
+protected:
+    void run() override;
+
+private:
+    QString filePath;
+    int width;
+    int height;
+    std::vector<MapRecord> records;
+};
+
+#endif // MAPSAVER_H
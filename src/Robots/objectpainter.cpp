@@ -18,8 +18,9 @@
  * 
  * @param scene Pointer to the CustomGraphicsScene where the robot will be painted.
  * @param robot Pointer to the Robot object to be painted.
+ * @return The item representing the robot.
  */
-void ObjectPainter::PaintRobot(CustomGraphicsScene *scene, Robot *robot)
+QGraphicsItem* ObjectPainter::PaintRobot(CustomGraphicsScene *scene, Robot *robot)
 {
     // Determining the smaller of the width and height values of the cell for the circle diameter
     qreal radius = 12.5;
@@ -39,6 +40,7 @@ void ObjectPainter::PaintRobot(CustomGraphicsScene *scene, Robot *robot)
     circle->setBrush(brush);
 
     scene->addItem(circle);
+    return circle;
 }
 
 /**
@@ -46,74 +48,104 @@ void ObjectPainter::PaintRobot(CustomGraphicsScene *scene, Robot *robot)
  * 
  * This function paints a representation of a robot with a number and triangle representing the robot's field of view on the provided scene.
  * 
+ * The items of the robot are grouped and drawn around the origin for the heading 0, PlaceRobot then moves and rotates
+ * the group, so a moving robot is painted again without creating any items.
+ * 
  * @param scene Pointer to the MapPainter where the robot will be painted.
  * @param robot Pointer to the Robot object to be painted.
  * @param num The number associated with the robot.
+ * @return The items of the robot.
  */
-void ObjectPainter::PaintRobot(MapPainter *scene, Robot *robot, int num)
+MapPainter::RobotItem ObjectPainter::PaintRobot(MapPainter *scene, Robot *robot, int num)
 {
     qreal radius = 12.5;
-    QPointF position = robot->getPosition();
     qreal smallRadius = 3.0;
-    qreal angleInRadians = qDegreesToRadians(static_cast<float>(robot->angle()));
+    qreal eyeAngle = qDegreesToRadians(static_cast<double>(25));
     qreal eyeDistance = 2; // Distance of eyes from the center of the robot
 
     // Creating the main circle representing the robot
-    QGraphicsEllipseItem *circle = new QGraphicsEllipseItem(position.x() - radius, position.y() - radius, 2 * radius, 2 * radius);
+    QGraphicsEllipseItem *circle = new QGraphicsEllipseItem(-radius, -radius, 2 * radius, 2 * radius);
     circle->setBrush(Qt::white);
 
     // Creating the first small "eye"
-    qreal firstEyeCenterX = position.x() + (radius - eyeDistance) * cos(angleInRadians - qDegreesToRadians(static_cast<double>(25)));
-    qreal firstEyeCenterY = position.y() - (radius - eyeDistance) * sin(angleInRadians - qDegreesToRadians(static_cast<double>(25)));
-    QGraphicsEllipseItem *firstEye = new QGraphicsEllipseItem(firstEyeCenterX - smallRadius, firstEyeCenterY - smallRadius, 2 * smallRadius, 2 * smallRadius);
+    qreal eyeX = (radius - eyeDistance) * cos(eyeAngle);
+    qreal eyeY = (radius - eyeDistance) * sin(eyeAngle);
+    QGraphicsEllipseItem *firstEye = new QGraphicsEllipseItem(eyeX - smallRadius, eyeY - smallRadius, 2 * smallRadius, 2 * smallRadius);
     firstEye->setBrush(Qt::red);
 
     // Creating the second small "eye"
-    qreal secondEyeCenterX = position.x() + (radius - eyeDistance) * cos(angleInRadians + qDegreesToRadians(static_cast<double>(25)));
-    qreal secondEyeCenterY = position.y() - (radius - eyeDistance) * sin(angleInRadians + qDegreesToRadians(static_cast<double>(25)));
-    QGraphicsEllipseItem *secondEye = new QGraphicsEllipseItem(secondEyeCenterX - smallRadius, secondEyeCenterY - smallRadius, 2 * smallRadius, 2 * smallRadius);
+    QGraphicsEllipseItem *secondEye = new QGraphicsEllipseItem(eyeX - smallRadius, -eyeY - smallRadius, 2 * smallRadius, 2 * smallRadius);
     secondEye->setBrush(Qt::red);
 
-    // Creating a text item with the number
-    QGraphicsTextItem *textItem = new QGraphicsTextItem(QString::number(num));
+    // Creating a text item with the number, it is turned back against the rotation of the robot to stay upright
+    QGraphicsTextItem *textItem = new QGraphicsTextItem();
     textItem->setFont(QFont("Arial", 16, QFont::Bold));
     textItem->setDefaultTextColor(Qt::black);
-    textItem->setPos(position.x() - textItem->boundingRect().width() / 2.0, position.y() - textItem->boundingRect().height() / 2.0);
 
-    // Adding the main circle, eyes, and text item to the scene
-
-    int nextX = position.x();
-    int nextY = position.y();
+    QGraphicsPolygonItem *polygonItem = new QGraphicsPolygonItem();
+    QPen pen(Qt::yellow);
+    polygonItem->setPen(pen);
 
-    QPointF nextCenter = QPointF(nextX, nextY);
+    // The outline of a robot selected in the robot table is only shown or hidden
+    QGraphicsEllipseItem *outline = new QGraphicsEllipseItem(-radius - 3, -radius - 3, 2 * radius + 6, 2 * radius + 6);
+    outline->setPen(QPen(QColor(42, 130, 218), 3));
+    outline->setVisible(false);
 
-    // Calculation of triangle points
-    int triangleBase = robot->getBase(); // Length of one arm of the triangle
-    int offset = triangleBase / 2.2; // Offset from the center
+    QGraphicsItemGroup *group = new QGraphicsItemGroup;
+    group->addToGroup(polygonItem);
+    group->addToGroup(circle);
+    group->addToGroup(firstEye);
+    group->addToGroup(secondEye);
+    group->addToGroup(textItem);
+    group->addToGroup(outline);
 
-    // Adjusting the bottom left corner
-    int triangleLeftX = nextX + static_cast<int>(triangleBase * qCos(angleInRadians)) + static_cast<int>(offset * qCos(angleInRadians - M_PI_2));
-    int triangleLeftY = nextY - static_cast<int>(triangleBase * qSin(angleInRadians)) - static_cast<int>(offset * qSin(angleInRadians - M_PI_2));
+    scene->addItem(group);
 
-    // Adjusting the bottom right corner
-    int triangleRightX = nextX + static_cast<int>(triangleBase * qCos(angleInRadians)) + static_cast<int>(offset * qCos(angleInRadians + M_PI_2));
-    int triangleRightY = nextY - static_cast<int>(triangleBase * qSin(angleInRadians)) - static_cast<int>(offset * qSin(angleInRadians + M_PI_2));
+    MapPainter::RobotItem item = { group, polygonItem, outline, textItem, -1 };
+    NumberRobot(item, num);
+    return item;
+}
 
-    QPointF point1(triangleLeftX, triangleLeftY);  // Bottom left corner
-    QPointF point2(triangleRightX, triangleRightY);  // Bottom right corner
-    QPointF point3(nextCenter); // Vertex
+/**
+ * @brief Sets the number shown on a painted robot, used when the robots before it are removed.
+ * @param item The items of the robot.
+ * @param num The number of the robot.
+ */
+void ObjectPainter::NumberRobot(MapPainter::RobotItem &item, int num)
+{
+    item.label->setPlainText(QString::number(num));
+    QRectF textRect = item.label->boundingRect();
+    item.label->setPos(-textRect.width() / 2.0, -textRect.height() / 2.0);
+    item.label->setTransformOriginPoint(textRect.center());
+}
 
-    QPolygonF triangle;
-    triangle << point1 << point2 << point3;
-    QGraphicsPolygonItem *polygonItem = new QGraphicsPolygonItem(triangle);
-    QPen pen(Qt::yellow);
-    polygonItem->setPen(pen);
+/**
+ * @brief Moves and rotates the items of a robot to the current position and heading of the robot.
+ * @details The triangle is taken from the triangle cache for the heading 0 and rotated with the group, it is only
+ * replaced when the base of the robot changes.
+ * @param item The items of the robot.
+ * @param robot The painted robot.
+ * @param selected True if the robot is outlined as selected.
+ */
+void ObjectPainter::PlaceRobot(MapPainter::RobotItem &item, Robot *robot, bool selected)
+{
+    if (item.base != robot->getBase())
+    {
+        TriangleGeometry geometry = TriangleCache::Get(0, robot->getBase());
+
+        QPolygonF triangle;
+        triangle << QPointF(FixedPoint::ToDouble(geometry.left.x), FixedPoint::ToDouble(geometry.left.y))
+                 << QPointF(FixedPoint::ToDouble(geometry.right.x), FixedPoint::ToDouble(geometry.right.y))
+                 << QPointF(0, 0);
+        item.triangle->setPolygon(triangle);
+        item.base = robot->getBase();
+    }
 
-    scene->addItem(polygonItem);
-    scene->addItem(circle);
-    scene->addItem(firstEye);
-    scene->addItem(secondEye);
-    scene->addItem(textItem);
+    // The heading grows counterclockwise, the rotation of the scene clockwise
+    item.outline->setVisible(selected);
+    item.group->setPos(robot->getPosition());
+    item.group->setRotation(-robot->angle());
+    item.label->setRotation(robot->angle());
 }
 
 /**
@@ -123,60 +155,38 @@ void ObjectPainter::PaintRobot(MapPainter *scene, Robot *robot, int num)
  * 
  * @param scene The CustomGraphicsScene where the obstacle will be painted.
  * @param obstacle The obstacle to be painted.
+ * @return The item representing the obstacle.
  */
-void ObjectPainter::PaintObstacle(CustomGraphicsScene *scene, Obstacle *obstacle)
+QGraphicsItem* ObjectPainter::PaintObstacle(CustomGraphicsScene *scene, Obstacle *obstacle)
 {
     QRectF rect(obstacle->getPosition().x()-12.5, obstacle->getPosition().y()-12.5, 25, 25);
     QBrush brush(Qt::lightGray);
     brush.setStyle(Qt::DiagCrossPattern);
-    scene->addRect(rect, QPen(), brush);
+    return scene->addRect(rect, QPen(), brush);
 }
 
 /**
- * @brief Paints an obstacle on the scene.
+ * @brief Paints all obstacles of one chunk as a single item.
  * 
- * This function creates a rectangle representing the obstacle and adds it to the scene
- * with a diagonal cross pattern brush.
+ * Obstacles overlapping several chunks are painted only by the chunk containing their top left corner.
  * 
  * @param scene A pointer to the MapPainter scene.
- * @param obstacle A pointer to the obstacle to be painted.
+ * @param chunk The chunk whose obstacles are painted.
+ * @param key Key of the chunk.
+ * @return The item representing the obstacles of the chunk.
  */
-void ObjectPainter::PaintObstacle(MapPainter *scene, Obstacle *obstacle)
+QGraphicsItem* ObjectPainter::PaintObstacles(MapPainter *scene, Chunk &chunk, quint64 key)
 {
-    QRectF rect(obstacle->getPosition().x(), obstacle->getPosition().y(), 25, 25);
-    QBrush brush(Qt::lightGray);
-    brush.setStyle(Qt::DiagCrossPattern);
-    scene->addRect(rect, QPen(), brush);
-}
+    QPainterPath path;
+    path.setFillRule(Qt::WindingFill);
 
-/**
- * @brief Removes objects from the scene at the specified position.
- * 
- * This function removes all objects that intersect with the given position
- * from the specified scene. It iterates through all items at the position
- * and checks if they are QGraphicsLineItems. If an item is not a line item
- * and it intersects with the position, it is removed from the scene and
- * its memory is deallocated.
- * 
- * @param scene The scene from which to remove objects.
- * @param scenePos The position in the scene where objects should be removed.
- */
-void ObjectPainter::RemoveObject(CustomGraphicsScene *scene, QPointF scenePos)
-{
-    QList<QGraphicsItem*> itemsAtPos = scene->items(scenePos);
-
-    for (QGraphicsItem* item : itemsAtPos)
+    for (auto obstacle : chunk.obstacles)
     {
-        QGraphicsLineItem* lineItem = qgraphicsitem_cast<QGraphicsLineItem*>(item);
-        if (lineItem)
-        {
-            continue;
-        }
-
-        if (item->contains(item->mapFromScene(scenePos)))
-        {
-            scene->removeItem(item);
-            delete item; // Uvolnění paměti alokované pro položku
-        }
+        if (Environment::ChunkKey(obstacle->getPosition()) == key)
+            path.addRect(obstacle->getPosition().x(), obstacle->getPosition().y(), 25, 25);
     }
+
+    QBrush brush(Qt::lightGray);
+    brush.setStyle(Qt::DiagCrossPattern);
+    return scene->addPath(path, QPen(), brush);
 }
@@ -13,11 +13,12 @@
 class ObjectPainter
 {
 public:
-    static void PaintRobot(CustomGraphicsScene *scene, Robot *robot);
-    static void PaintRobot(MapPainter *scene, Robot *robot, int num);
-    static void PaintObstacle(CustomGraphicsScene *scene, Obstacle *obstacle);
-    static void PaintObstacle(MapPainter *scene, Obstacle *obstacle);
-    static void RemoveObject(CustomGraphicsScene *scene, QPointF scenePos);
+    static QGraphicsItem* PaintRobot(CustomGraphicsScene *scene, Robot *robot);
+    static MapPainter::RobotItem PaintRobot(MapPainter *scene, Robot *robot, int num);
+    static void PlaceRobot(MapPainter::RobotItem &item, Robot *robot, bool selected);
+    static void NumberRobot(MapPainter::RobotItem &item, int num);
+    static QGraphicsItem* PaintObstacle(CustomGraphicsScene *scene, Obstacle *obstacle);
+    static QGraphicsItem* PaintObstacles(MapPainter *scene, Chunk &chunk, quint64 key);
 };
 
 #endif // OBJECTPAINTER_H
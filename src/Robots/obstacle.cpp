@@ -26,6 +26,24 @@ QPointF Obstacle::getPosition()
     return position; // Return the stored position.
 }
 
+/**
+ * @brief Returns the index of the obstacle in the obstacles of its environment.
+ * @return The index, -1 if the obstacle does not belong to an environment.
+ */
+int Obstacle::getIndex()
+{
+    return index;
+}
+
+/**
+ * @brief Sets the index of the obstacle in the obstacles of its environment, so it is removed without a search.
+ * @param index The index.
+ */
+void Obstacle::setIndex(int index)
+{
+    this->index = index;
+}
+
 /**
  * @brief Static factory method to create and return a new obstacle at a given position.
  * @param pos QPointF indicating the position where the obstacle should be created.
@@ -13,10 +13,13 @@ class Obstacle : public QGraphicsItem
 {
 private:
     QPointF position;
+    int index = -1;
 
 public:
     Obstacle(QPointF pos);
     QPointF getPosition();
+    int getIndex();
+    void setIndex(int index);
     static Obstacle* create(QPointF);
 
     // Metody pro QGraphicsItem
@@ -0,0 +1,331 @@
+/**
+* @file occupancygrid.cpp
+* @brief Implementation of the OccupancyGrid class, a packed bitmap of the cells covered by static obstacles.
+* @details The grid is split into chunks of 256 x 256 cells stored in a hash map, chunks without obstacles are
+* not stored. Each row of a chunk is packed into 64-bit words, so testing a shape scans one short span of words
+* per covered row and the cost does not depend on the number of obstacles.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "occupancygrid.h"
+#include <QtMath>
+#include <algorithm>
+
+/**
+ * @brief Constructor for the OccupancyGrid class.
+ * @param resolution Size of one cell in scene units. Coarser grids use less memory, but cells partially
+ * covered by an obstacle are treated as fully occupied.
+ */
+OccupancyGrid::OccupancyGrid(double resolution)
+{
+    this->resolution = resolution > 0 ? resolution : 1;
+}
+
+/**
+ * @brief Returns the size of one cell of the grid.
+ * @return Size of a cell in scene units.
+ */
+double OccupancyGrid::Resolution() const
+{
+    return resolution;
+}
+
+/**
+ * @brief Marks all cells covered by a rectangle as occupied.
+ * @param rect Rectangle in scene coordinates, its right and bottom edges are exclusive.
+ */
+void OccupancyGrid::Fill(QRectF rect)
+{
+    rect = rect.normalized();
+    if (rect.isEmpty())
+        return;
+
+    qint64 first = cell(rect.left());
+    qint64 last = qCeil(rect.right() / resolution) - 1;
+
+    for (qint64 row = cell(rect.top()); row <= qCeil(rect.bottom() / resolution) - 1; row++)
+        fillSpan(row, first, last);
+}
+
+/**
+ * @brief Marks all cells covered by a rectangle as free, the cells are the same as filled by Fill.
+ * @details The chunks are kept even if they become empty. Cells covered by other obstacles have to be filled again.
+ * @param rect Rectangle in scene coordinates, its right and bottom edges are exclusive.
+ */
+void OccupancyGrid::Erase(QRectF rect)
+{
+    rect = rect.normalized();
+    if (rect.isEmpty())
+        return;
+
+    qint64 first = cell(rect.left());
+    qint64 last = qCeil(rect.right() / resolution) - 1;
+
+    for (qint64 row = cell(rect.top()); row <= qCeil(rect.bottom() / resolution) - 1; row++)
+        eraseSpan(row, first, last);
+}
+
+/**
+ * @brief Marks all cells of the grid as free and releases the memory.
+ */
+void OccupancyGrid::Clear()
+{
+    bitmaps.clear();
+}
+
+/**
+ * @brief Checks whether a point lies in an occupied cell.
+ * @param pos Position in scene coordinates.
+ * @return True if the cell is occupied.
+ */
+bool OccupancyGrid::Test(QPointF pos) const
+{
+    qint64 column = cell(pos.x());
+    return testSpan(cell(pos.y()), column, column);
+}
+
+/**
+ * @brief Checks whether a disc touches any occupied cell.
+ * @details For every row of cells the widest chord of the disc inside the row is tested.
+ * @param center Center of the disc.
+ * @param radius Radius of the disc.
+ * @return True if the disc touches an occupied cell.
+ */
+bool OccupancyGrid::IntersectsDisc(QPointF center, double radius) const
+{
+    qint64 firstRow = cell(center.y() - radius);
+    qint64 lastRow = cell(center.y() + radius);
+
+    for (qint64 row = firstRow; row <= lastRow; row++)
+    {
+        // Distance from the center to the nearest point of the row
+        double top = row * resolution;
+        double dy = qMax(0.0, qMax(top - center.y(), center.y() - (top + resolution)));
+        if (dy > radius)
+            continue;
+
+        double halfWidth = qSqrt(radius * radius - dy * dy);
+        if (testSpan(row, cell(center.x() - halfWidth), cell(center.x() + halfWidth)))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Checks whether a convex polygon touches any occupied cell.
+ * @details For every row of cells the polygon is clipped to the row and the horizontal extent of the clipped part
+ * is tested. The extent is given by the vertices inside the row and the crossings of the edges with its borders.
+ * A degenerate polygon, such as a triangle with a zero base, is tested as the segment it collapses to.
+ * @param polygon The convex polygon in scene coordinates.
+ * @return True if the polygon touches an occupied cell.
+ */
+bool OccupancyGrid::IntersectsPolygon(const QPolygonF &polygon) const
+{
+    return IntersectsPolygon(polygon.constData(), polygon.size());
+}
+
+/**
+ * @brief Checks whether a convex polygon given by an array of vertices touches any occupied cell.
+ * @details Used in the collision tests, where the vertices are kept on the stack instead of in a QPolygonF.
+ * @param points The vertices of the polygon in scene coordinates.
+ * @param count Number of the vertices.
+ * @return True if the polygon touches an occupied cell.
+ */
+bool OccupancyGrid::IntersectsPolygon(const QPointF *points, int count) const
+{
+    if (count == 0)
+        return false;
+
+    double minX = points[0].x();
+    double maxX = points[0].x();
+    double minY = points[0].y();
+    double maxY = points[0].y();
+    for (int i = 1; i < count; i++)
+    {
+        minX = qMin(minX, points[i].x());
+        maxX = qMax(maxX, points[i].x());
+        minY = qMin(minY, points[i].y());
+        maxY = qMax(maxY, points[i].y());
+    }
+
+    QRectF bounds(QPointF(minX, minY), QPointF(maxX, maxY));
+    qint64 firstRow = cell(bounds.top());
+    qint64 lastRow = cell(bounds.bottom());
+
+    for (qint64 row = firstRow; row <= lastRow; row++)
+    {
+        double top = qMax(bounds.top(), row * resolution);
+        double bottom = qMin(bounds.bottom(), (row + 1) * resolution);
+        double left = bounds.right();
+        double right = bounds.left();
+
+        for (int i = 0; i < count; i++)
+        {
+            QPointF from = points[i];
+            QPointF to = points[(i + 1) % count];
+
+            if (from.y() >= top && from.y() <= bottom)
+            {
+                left = qMin(left, from.x());
+                right = qMax(right, from.x());
+            }
+
+            if (from.y() == to.y())
+                continue;
+
+            for (double y : {top, bottom})
+            {
+                if (y < qMin(from.y(), to.y()) || y > qMax(from.y(), to.y()))
+                    continue;
+
+                double x = from.x() + (to.x() - from.x()) * (y - from.y()) / (to.y() - from.y());
+                left = qMin(left, x);
+                right = qMax(right, x);
+            }
+        }
+
+        if (left <= right && testSpan(row, cell(left), cell(right)))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Converts a scene coordinate to the index of the cell containing it.
+ * @param coordinate Coordinate in scene units.
+ * @return Index of the cell.
+ */
+qint64 OccupancyGrid::cell(double coordinate) const
+{
+    return qFloor(coordinate / resolution);
+}
+
+/**
+ * @brief Checks whether any cell of a horizontal span is occupied.
+ * @param row Row of the span.
+ * @param first First column of the span.
+ * @param last Last column of the span, inclusive.
+ * @return True if at least one cell is occupied.
+ */
+bool OccupancyGrid::testSpan(qint64 row, qint64 first, qint64 last) const
+{
+    qint64 chunkY = chunkOf(row);
+    int localRow = static_cast<int>(row - chunkY * ChunkCells);
+
+    for (qint64 chunkX = chunkOf(first); chunkX <= chunkOf(last); chunkX++)
+    {
+        auto bitmap = bitmaps.find(chunkKey(chunkX, chunkY));
+        if (bitmap == bitmaps.end())
+            continue;
+
+        int from = static_cast<int>(qMax<qint64>(first - chunkX * ChunkCells, 0));
+        int to = static_cast<int>(qMin<qint64>(last - chunkX * ChunkCells, ChunkCells - 1));
+        const quint64 *words = bitmap->second.data() + localRow * WordsPerRow;
+
+        for (int word = from >> 6; word <= to >> 6; word++)
+        {
+            quint64 mask = ~0ULL;
+            if (word == from >> 6)
+                mask &= ~0ULL << (from & 63);
+            if (word == to >> 6)
+                mask &= ~0ULL >> (63 - (to & 63));
+
+            if (words[word] & mask)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Marks all cells of a horizontal span as occupied, the chunks are created when needed.
+ * @param row Row of the span.
+ * @param first First column of the span.
+ * @param last Last column of the span, inclusive.
+ */
+void OccupancyGrid::fillSpan(qint64 row, qint64 first, qint64 last)
+{
+    qint64 chunkY = chunkOf(row);
+    int localRow = static_cast<int>(row - chunkY * ChunkCells);
+
+    for (qint64 chunkX = chunkOf(first); chunkX <= chunkOf(last); chunkX++)
+    {
+        std::vector<quint64> &bitmap = bitmaps[chunkKey(chunkX, chunkY)];
+        if (bitmap.empty())
+            bitmap.resize(ChunkCells * WordsPerRow, 0);
+
+        int from = static_cast<int>(qMax<qint64>(first - chunkX * ChunkCells, 0));
+        int to = static_cast<int>(qMin<qint64>(last - chunkX * ChunkCells, ChunkCells - 1));
+        quint64 *words = bitmap.data() + localRow * WordsPerRow;
+
+        for (int word = from >> 6; word <= to >> 6; word++)
+        {
+            quint64 mask = ~0ULL;
+            if (word == from >> 6)
+                mask &= ~0ULL << (from & 63);
+            if (word == to >> 6)
+                mask &= ~0ULL >> (63 - (to & 63));
+
+            words[word] |= mask;
+        }
+    }
+}
+
+/**
+ * @brief Marks all cells of a horizontal span as free, missing chunks are free already.
+ * @param row Row of the span.
+ * @param first First column of the span.
+ * @param last Last column of the span, inclusive.
+ */
+void OccupancyGrid::eraseSpan(qint64 row, qint64 first, qint64 last)
+{
+    qint64 chunkY = chunkOf(row);
+    int localRow = static_cast<int>(row - chunkY * ChunkCells);
+
+    for (qint64 chunkX = chunkOf(first); chunkX <= chunkOf(last); chunkX++)
+    {
+        auto bitmap = bitmaps.find(chunkKey(chunkX, chunkY));
+        if (bitmap == bitmaps.end())
+            continue;
+
+        int from = static_cast<int>(qMax<qint64>(first - chunkX * ChunkCells, 0));
+        int to = static_cast<int>(qMin<qint64>(last - chunkX * ChunkCells, ChunkCells - 1));
+        quint64 *words = bitmap->second.data() + localRow * WordsPerRow;
+
+        for (int word = from >> 6; word <= to >> 6; word++)
+        {
+            quint64 mask = ~0ULL;
+            if (word == from >> 6)
+                mask &= ~0ULL << (from & 63);
+            if (word == to >> 6)
+                mask &= ~0ULL >> (63 - (to & 63));
+
+            words[word] &= ~mask;
+        }
+    }
+}
+
+/**
+ * @brief Returns the chunk containing a cell, also for negative cells.
+ * @param cell Row or column of the cell.
+ * @return Row or column of the chunk.
+ */
+qint64 OccupancyGrid::chunkOf(qint64 cell)
+{
+    return cell >= 0 ? cell / ChunkCells : -((-cell + ChunkCells - 1) / ChunkCells);
+}
+
+/**
+ * @brief Creates the key of a chunk from its coordinates.
+ * @param chunkX Column of the chunk.
+ * @param chunkY Row of the chunk.
+ * @return Key of the chunk.
+ */
+quint64 OccupancyGrid::chunkKey(qint64 chunkX, qint64 chunkY)
+{
+    return (static_cast<quint64>(static_cast<quint32>(chunkY)) << 32) | static_cast<quint32>(chunkX);
+}
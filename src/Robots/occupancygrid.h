@@ -0,0 +1,44 @@
+/**
+* @file occupancygrid.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <unordered_map>
+#include <vector>
+
+class OccupancyGrid
+{
+private:
+    static constexpr int ChunkCells = 256;
+    static constexpr int WordsPerRow = ChunkCells / 64;
+
+    double resolution;
+    std::unordered_map<quint64, std::vector<quint64>> bitmaps;
+
+    qint64 cell(double coordinate) const;
+    bool testSpan(qint64 row, qint64 first, qint64 last) const;
+    void fillSpan(qint64 row, qint64 first, qint64 last);
+    void eraseSpan(qint64 row, qint64 first, qint64 last);
+    static qint64 chunkOf(qint64 cell);
+    static quint64 chunkKey(qint64 chunkX, qint64 chunkY);
+
+public:
+    explicit OccupancyGrid(double resolution = 1);
+    double Resolution() const;
+    void Fill(QRectF rect);
+    void Erase(QRectF rect);
+    void Clear();
+    bool Test(QPointF pos) const;
+    bool IntersectsDisc(QPointF center, double radius) const;
+    bool IntersectsPolygon(const QPolygonF &polygon) const;
+    bool IntersectsPolygon(const QPointF *points, int count) const;
+};
+
+#endif // OCCUPANCYGRID_H
@@ -0,0 +1,181 @@
+/**
+* @file performancemonitor.cpp
+* @brief Implementation of the LatencyHistogram class, which records durations in logarithmic buckets, and of the
+* PerformanceMonitor class, which collects the durations of the ticks and frames for the performance overlay.
+* @details Recording a value is one relaxed atomic increment of a counter, there are no locks and no allocations, so
+* the monitor can stay on in every run. The overlay drains the counters a few times per second and computes the
+* percentiles from the drained counts.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "performancemonitor.h"
+#include <QtAlgorithms>
+#include <cstdio>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Constructor for the LatencyHistogram class, all buckets are empty.
+ */
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records a value, it may be called from any thread.
+ * @param value The recorded value.
+ */
+void LatencyHistogram::Record(quint64 value)
+{
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Moves the counts of all buckets out of the histogram, values recorded meanwhile go to the next drain.
+ * @param counts Receives the count of every bucket.
+ */
+void LatencyHistogram::Drain(std::vector<quint64> &counts)
+{
+    counts.resize(BucketCount);
+    for (int i = 0; i < BucketCount; i++)
+        counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Computes a percentile of drained counts.
+ * @param counts The count of every bucket.
+ * @param percentile The percentile from 0 to 100.
+ * @return The highest value of the bucket containing the percentile, zero if there are no values.
+ */
+quint64 LatencyHistogram::Percentile(const std::vector<quint64> &counts, double percentile)
+{
+    quint64 total = 0;
+    for (quint64 count : counts)
+        total += count;
+
+    if (total == 0)
+        return 0;
+
+    quint64 rank = qMax<quint64>(1, static_cast<quint64>(total * percentile / 100 + 0.5));
+    quint64 seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return highestOf(i);
+    }
+
+    return highestOf(counts.size() - 1);
+}
+
+/**
+ * @brief Finds the bucket of a value.
+ * @details Values below SubBuckets have a bucket each, every higher power of two is split into SubBuckets buckets,
+ * so a value is known to within one part in SubBuckets.
+ * @param value The value.
+ * @return Index of the bucket.
+ */
+int LatencyHistogram::bucketOf(quint64 value)
+{
+    if (value < SubBuckets)
+        return value;
+
+    int exponent = 63 - qCountLeadingZeroBits(value);
+    int shift = exponent - SubBits;
+    return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+}
+
+/**
+ * @brief Returns the highest value falling into a bucket.
+ * @param bucket Index of the bucket.
+ * @return The highest value of the bucket.
+ */
+quint64 LatencyHistogram::highestOf(int bucket)
+{
+    if (bucket < SubBuckets)
+        return bucket;
+
+    int shift = bucket / SubBuckets - 1;
+    quint64 sub = bucket % SubBuckets;
+    return ((static_cast<quint64>(SubBuckets) + sub + 1) << shift) - 1;
+}
+
+/**
+ * @brief Constructor for the PerformanceMonitor class, nothing is recorded yet.
+ */
+PerformanceMonitor::PerformanceMonitor()
+    : ticks(0)
+    , collisionChecks(0)
+{
+    counts.reserve(LatencyHistogram::BucketCount);
+}
+
+/**
+ * @brief Records one simulation tick.
+ * @param nanoseconds Duration of the tick.
+ * @param collisionChecks Number of collision tests performed in the tick.
+ */
+void PerformanceMonitor::RecordTick(quint64 nanoseconds, quint64 collisionChecks)
+{
+    tickTimes.Record(nanoseconds);
+    ticks.fetch_add(1, std::memory_order_relaxed);
+    this->collisionChecks.fetch_add(collisionChecks, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Records one painted frame.
+ * @param nanoseconds Duration of painting the frame.
+ */
+void PerformanceMonitor::RecordRender(quint64 nanoseconds)
+{
+    renderTimes.Record(nanoseconds);
+}
+
+/**
+ * @brief Takes everything recorded since the previous sample.
+ * @return The number of ticks and collision tests and the percentiles of the durations.
+ */
+PerformanceMonitor::Sample PerformanceMonitor::TakeSample()
+{
+    Sample sample;
+    sample.ticks = ticks.exchange(0, std::memory_order_relaxed);
+    sample.collisionChecks = collisionChecks.exchange(0, std::memory_order_relaxed);
+
+    tickTimes.Drain(counts);
+    sample.tickP50 = LatencyHistogram::Percentile(counts, 50);
+    sample.tickP99 = LatencyHistogram::Percentile(counts, 99);
+
+    renderTimes.Drain(counts);
+    sample.renderP50 = LatencyHistogram::Percentile(counts, 50);
+    sample.renderP99 = LatencyHistogram::Percentile(counts, 99);
+
+    return sample;
+}
+
+/**
+ * @brief Reads the resident memory of the process.
+ * @details The number of resident pages is the second field of /proc/self/statm.
+ * @return The resident memory in bytes, -1 if it is not known on this system.
+ */
+qint64 PerformanceMonitor::ResidentMemory()
+{
+#ifdef Q_OS_LINUX
+    std::FILE *file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr)
+        return -1;
+
+    long long size = 0;
+    long long resident = 0;
+    int read = std::fscanf(file, "%lld %lld", &size, &resident);
+    std::fclose(file);
+
+    return read == 2 ? resident * sysconf(_SC_PAGESIZE) : -1;
+#else
+    return -1;
+#endif
+}
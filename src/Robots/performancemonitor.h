@@ -0,0 +1,62 @@
+/**
+* @file performancemonitor.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef PERFORMANCEMONITOR_H
+#define PERFORMANCEMONITOR_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <vector>
+
+class LatencyHistogram
+{
+public:
+    static constexpr int SubBits = 4;
+    static constexpr int SubBuckets = 1 << SubBits;
+    static constexpr int BucketCount = (64 - SubBits + 1) * SubBuckets;
+
+    LatencyHistogram();
+    void Record(quint64 value);
+    void Drain(std::vector<quint64> &counts);
+    static quint64 Percentile(const std::vector<quint64> &counts, double percentile);
+
+private:
+    std::atomic<quint64> buckets[BucketCount];
+    static int bucketOf(quint64 value);
+    static quint64 highestOf(int bucket);
+};
+
+class PerformanceMonitor
+{
+public:
+    /**
+     * @brief Everything recorded since the previous sample, times are in nanoseconds.
+     */
+    struct Sample
+    {
+        quint64 ticks;
+        quint64 collisionChecks;
+        quint64 tickP50;
+        quint64 tickP99;
+        quint64 renderP50;
+        quint64 renderP99;
+    };
+
+    PerformanceMonitor();
+    void RecordTick(quint64 nanoseconds, quint64 collisionChecks);
+    void RecordRender(quint64 nanoseconds);
+    Sample TakeSample();
+    static qint64 ResidentMemory();
+
+private:
+    LatencyHistogram tickTimes;
+    LatencyHistogram renderTimes;
+    std::atomic<quint64> ticks;
+    std::atomic<quint64> collisionChecks;
+    std::vector<quint64> counts;
+};
+
+#endif // PERFORMANCEMONITOR_H
@@ -0,0 +1,191 @@
+/**
+* @file regionscheduler.cpp
+* @brief Implementation of the RegionScheduler class, which steps the robots of separate parts of the world in parallel.
+* @details The world is split into vertical strips, the active robots whose center lies in a strip form one group of
+* robots of the tick, see Environment::RobotGroup. The groups are tested on the worker threads, then decided on the
+* worker threads, and finally the environment is updated with the results of all groups on the calling thread. A
+* pass of a group writes only the robots of the group and every decision reads the state at the start of the tick, so
+* the result is the same as of Environment::StepActiveRobots, whatever the number of threads. A strip is at least as
+* wide as the farthest distance at which two robots can affect each other, so only the robots near its edges have
+* neighbours in another strip, whose pairs are tested from both sides.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "regionscheduler.h"
+
+/**
+ * @brief Constructor for the RegionScheduler class, starts the worker threads.
+ * @param environment The simulated environment.
+ * @param threads Number of worker threads, at least one.
+ */
+RegionScheduler::RegionScheduler(Environment *environment, int threads)
+{
+    this->environment = environment;
+    threadCount = qMax(1, threads);
+    stripWidth = 0;
+    generation = 0;
+    pass = Test;
+    pending = 0;
+    stopping = false;
+
+    for (int worker = 0; worker < threadCount; worker++)
+        workers.emplace_back(&RegionScheduler::work, this, worker);
+}
+
+/**
+ * @brief Destructor for the RegionScheduler class, stops and joins the worker threads.
+ */
+RegionScheduler::~RegionScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief Performs one tick of the simulation.
+ * @details The active robots are assigned to the strips containing their centers at the start of the tick. The robots
+ * which fall asleep are put to sleep before any robot moves, as in Environment::StepActiveRobots.
+ * @return Numbers of the stepped robots, valid until the next call.
+ */
+const std::vector<int>& RegionScheduler::Step()
+{
+    if (regions.empty() || requiredWidth() > stripWidth)
+        layout();
+
+    // The lists are only read by the workers
+    environment->BeginTick();
+
+    for (Environment::RobotGroup &region : regions)
+        region.robots.clear();
+
+    for (int index : environment->GetActiveRobots())
+        regions[regionAt(environment->GetRobots()[index]->getPosition().x())].robots.push_back(index);
+
+    for (Environment::RobotGroup &region : regions)
+        environment->PrepareGroup(region);
+
+    runPass(Test);
+    runPass(Decide);
+
+    for (Environment::RobotGroup &region : regions)
+        environment->ApplySleeps(region);
+
+    changed.clear();
+
+    for (Environment::RobotGroup &region : regions)
+    {
+        environment->ApplyMoves(region);
+
+        for (int index : region.robots)
+            changed.push_back(index + 1);
+    }
+
+    return changed;
+}
+
+/**
+ * @brief Returns the number of strips the world is split into.
+ * @return Number of strips, one if the world is too narrow to be split.
+ */
+int RegionScheduler::GetRegionCount()
+{
+    return regions.size();
+}
+
+/**
+ * @brief Computes the narrowest strip in which the robots have neighbours in the neighbouring strips only.
+ * @details A robot tests the robots in its neighbour list, which reaches its sensed area extended by the skin. Both
+ * robots move by up to half of the skin before the lists are rebuilt and by one more step in the tick.
+ * @return The width in scene units.
+ */
+double RegionScheduler::requiredWidth()
+{
+    double width = 0;
+
+    for (auto robot : environment->GetRobots())
+    {
+        double range = robot->sensedArea().width() / 2 + 2 * Environment::NeighbourSkin + 2 * robot->getMoveDistance();
+        width = qMax(width, range);
+    }
+
+    return width;
+}
+
+/**
+ * @brief Splits the world into strips of the required width.
+ * @details The strips depend only on the world and the robots, not on the number of threads, the workers take the
+ * strips in turn.
+ */
+void RegionScheduler::layout()
+{
+    double worldWidth = environment->GetSize().x();
+    stripWidth = qMax(1.0, requiredWidth());
+    int count = qMax(1, static_cast<int>(worldWidth / stripWidth));
+
+    regions.resize(count);
+}
+
+/**
+ * @brief Finds the strip containing a position, the last strip takes the remainder of the world.
+ * @param x The x coordinate of the position.
+ * @return Index of the strip.
+ */
+int RegionScheduler::regionAt(double x)
+{
+    return qBound(0, qFloor(x / stripWidth), static_cast<int>(regions.size()) - 1);
+}
+
+/**
+ * @brief Runs one pass over all strips on the worker threads and waits until they are done.
+ * @param pass The pass, all strips are tested before any strip is decided.
+ */
+void RegionScheduler::runPass(Pass pass)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    this->pass = pass;
+    pending = threadCount;
+    generation++;
+    started.notify_all();
+
+    finished.wait(lock, [this] { return pending == 0; });
+}
+
+/**
+ * @brief Loop of a worker thread, the worker runs the current pass for every strip assigned to it.
+ * @param worker Index of the worker.
+ */
+void RegionScheduler::work(int worker)
+{
+    quint64 seen = 0;
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        started.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+            return;
+
+        seen = generation;
+        Pass current = pass;
+        lock.unlock();
+
+        for (size_t region = worker; region < regions.size(); region += threadCount)
+        {
+            if (current == Test)
+                environment->TestGroup(regions[region]);
+            else
+                environment->DecideGroup(regions[region]);
+        }
+
+        lock.lock();
+        if (--pending == 0)
+            finished.notify_one();
+    }
+}
@@ -0,0 +1,53 @@
+/**
+* @file regionscheduler.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef REGIONSCHEDULER_H
+#define REGIONSCHEDULER_H
+
+#include "environment.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RegionScheduler
+{
+private:
+    enum Pass
+    {
+        Test,
+        Decide
+    };
+
+    Environment *environment;
+    int threadCount;
+    double stripWidth;
+    std::vector<Environment::RobotGroup> regions;
+    std::vector<int> changed;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    quint64 generation;
+    Pass pass;
+    int pending;
+    bool stopping;
+
+    double requiredWidth();
+    void layout();
+    int regionAt(double x);
+    void runPass(Pass pass);
+    void work(int worker);
+
+public:
+    RegionScheduler(Environment *environment, int threads);
+    ~RegionScheduler();
+    const std::vector<int>& Step();
+    int GetRegionCount();
+};
+
+#endif // REGIONSCHEDULER_H
@@ -6,13 +6,17 @@
 */
 
 #include "robot.h"
+#include "collisionkernel.h"
+#include "environment.h"
+#include "trianglecache.h"
 #include "qgraphicsscene.h"
 #include "qpainter.h"
 #include <QtMath>
 
 Robot::Robot(QPointF pos)
 {
-    this->position = pos;
+    x = FixedPoint::FromDouble(pos.x());
+    y = FixedPoint::FromDouble(pos.y());
 }
 
 /**
@@ -31,11 +35,57 @@ Robot* Robot::create(QPointF pos)
 /**
  * @brief Get the position of the robot.
  * 
+ * The position is held in fixed point, the conversion to scene units is exact.
+ * 
  * @return The position of the robot as a QPointF object.
  */
 QPointF Robot::getPosition()
 {
-    return this->position;
+    return QPointF(FixedPoint::ToDouble(x), FixedPoint::ToDouble(y));
+}
+
+/**
+ * @brief Get the position of the robot in fixed point.
+ *
+ * @return The position of the robot, 1/256 of a scene unit per step.
+ */
+FixedPoint::Vector Robot::getFixedPosition()
+{
+    return { x, y };
+}
+
+/**
+ * @brief Places the robot at a position with a heading, for example to continue a robot simulated elsewhere.
+ *
+ * @param x The x coordinate in fixed point.
+ * @param y The y coordinate in fixed point.
+ * @param direction The heading in degrees.
+ */
+void Robot::setState(qint32 x, qint32 y, int direction)
+{
+    this->x = x;
+    this->y = y;
+    this->direction = FixedPoint::Normalize(direction);
+}
+
+/**
+ * @brief Get the number of the robot in its environment.
+ *
+ * @return The number of the robot, zero if the robot is not in an environment.
+ */
+int Robot::getNumber()
+{
+    return number;
+}
+
+/**
+ * @brief Set the number of the robot in its environment.
+ *
+ * @param number The number of the robot.
+ */
+void Robot::setNumber(int number)
+{
+    this->number = number;
 }
 
 /**
@@ -48,114 +98,313 @@ QPointF Robot::getPosition()
  */
 void Robot::turn(int angle = 30)
 {
-    direction += angle % 360;
+    direction = FixedPoint::Normalize(direction + angle);
 }
 
 /**
  * @brief Returns the angle of the robot.
  *
- * @return The angle of the robot.
+ * @return The angle of the robot in the range 0 to 359 degrees.
  */
 int Robot::angle()
 {
     return direction;
 }
 
+/**
+ * @brief Returns the step of the robot in its current direction.
+ * @return The step in fixed point, the same for testing and for moving.
+ */
+FixedPoint::Vector Robot::step()
+{
+    return FixedPoint::Polar(moveDistance * FixedPoint::One, direction);
+}
+
+/**
+ * @brief Calculates the triangle of the robot with its vertex at the given position.
+ * @details The corners are taken from the triangle cache in fixed point and converted to scene units exactly, so
+ * the same position always gives the same triangle.
+ * @param vertexX The x coordinate of the vertex in fixed point.
+ * @param vertexY The y coordinate of the vertex in fixed point.
+ * @return The triangle with the bottom left corner, the bottom right corner and the vertex.
+ */
+QPolygonF Robot::triangleAt(qint32 vertexX, qint32 vertexY)
+{
+    QPointF corners[3];
+    cornersAt(geometry(), vertexX, vertexY, corners);
+
+    QPolygonF triangle;
+    triangle << corners[0] << corners[1] << corners[2];
+    return triangle;
+}
+
+/**
+ * @brief Calculates the corners of a triangle of the robot with its vertex at the given position, without allocating.
+ * @param geometry The geometry of the triangle from the triangle cache.
+ * @param vertexX The x coordinate of the vertex in fixed point.
+ * @param vertexY The y coordinate of the vertex in fixed point.
+ * @param corners Receives the bottom left corner, the bottom right corner and the vertex.
+ */
+void Robot::cornersAt(const TriangleGeometry &geometry, qint32 vertexX, qint32 vertexY, QPointF corners[3])
+{
+    corners[0] = QPointF(FixedPoint::ToDouble(vertexX + geometry.left.x), FixedPoint::ToDouble(vertexY + geometry.left.y));
+    corners[1] = QPointF(FixedPoint::ToDouble(vertexX + geometry.right.x), FixedPoint::ToDouble(vertexY + geometry.right.y));
+    corners[2] = QPointF(FixedPoint::ToDouble(vertexX), FixedPoint::ToDouble(vertexY));
+}
+
+/**
+ * @brief Returns the triangle of the robot at its current position, as it is painted.
+ * @return The triangle with the bottom left corner, the bottom right corner and the vertex.
+ */
+QPolygonF Robot::triangle()
+{
+    return triangleAt(x, y);
+}
+
 /**
  * @brief Determines whether the robot can move to the next position without colliding with other robots or obstacles.
  * @details The function calculates the next position of the robot based on its current position and direction and uses
  * a triangle with the base set by user and checks for collisions with other robots and obstacles.
- * @param robots A vector of pointers to Robot objects representing other robots in the environment.
- * @param obstacles A vector of pointers to Obstacle objects representing obstacles in the environment.
- * @param size A QPointF object representing the size of the environment.
+ * Walls and obstacles are tested by canMoveStatic, other robots only if they are in the neighbour list of the robot,
+ * by the collision kernel from the positions stored by the environment. The triangle is taken from the triangle cache.
+ * @param environment The environment containing the robot, other robots and obstacles.
  * @return True if the robot can move to the next position without collision, false otherwise.
  */
-bool Robot::canMove(std::vector<Robot *> &robots, std::vector<Obstacle*> &obstacles, QPointF size)
+bool Robot::canMove(Environment &environment)
+{
+    return clearOfStatic(environment, direction) && clearOfRobots(environment, direction);
+}
+
+/**
+ * @brief Determines whether the robot can move to the next position without colliding with walls or obstacles.
+ * @details Obstacles are tested against the occupancy grid of the environment. Walls and obstacles are not tested at
+ * all while the clearance of the robot exceeds its step plus the reach of its triangle.
+ * @param environment The environment containing the robot and obstacles.
+ * @return True if the disc and the triangle of the robot at the next position are inside the world and free of obstacles.
+ */
+bool Robot::canMoveStatic(Environment &environment)
+{
+    return clearOfStatic(environment, direction);
+}
+
+/**
+ * @brief Finds a heading in which the robot can move, testing every whole degree exactly as canMove does.
+ * @details Used when the sampled headings of the distance field are all blocked. The headings are tried from the
+ * starting one on, so a random start spreads the chosen headings.
+ * @param environment The environment containing the robot, other robots and obstacles.
+ * @param start The first tried heading in degrees.
+ * @return The first heading in which the robot can move or -1 if it cannot move in any heading.
+ */
+int Robot::movableHeading(Environment &environment, int start)
+{
+    for (int i = 0; i < 360; i++)
+    {
+        int heading = FixedPoint::Normalize(start + i);
+        if (clearOfStatic(environment, heading) && clearOfRobots(environment, heading))
+            return heading;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Tests the step of the robot in a heading against walls and obstacles.
+ * @param environment The environment containing the robot and obstacles.
+ * @param heading The heading of the step and of the triangle in degrees.
+ * @return True if the disc and the triangle at the end of the step are inside the world and free of obstacles.
+ */
+bool Robot::clearOfStatic(Environment &environment, int heading)
 {
-    double nextX = position.x();
-    double nextY = position.y();
+    // The static geometry can only be hit if it is closer than the step plus the reach of the robot
+    if (environment.GetDistanceField().Clearance(getPosition()) > moveDistance + reach() + environment.GetOccupancy().Resolution())
+        return true;
 
-    double radians = qDegreesToRadians(static_cast<double>(direction));
+    QPointF size = environment.GetSize();
 
-    nextX += static_cast<int>(moveDistance * qCos(radians));
-    nextY -= static_cast<int>(moveDistance * qSin(radians));
+    // The tested position is exactly the one the robot moves to
+    FixedPoint::Vector next = positionAfterStep(heading);
+    double nextX = FixedPoint::ToDouble(next.x);
+    double nextY = FixedPoint::ToDouble(next.y);
 
     if (nextX + 12.5 >= size.x() || nextX - 12.5 < 0 || nextY + 12.5 >= size.y() || nextY - 12.5 < 0)
         return false;
 
-    // Calculation of triangle points
-    double offset = triangleBase / 2.2; // Offset from the center
+    TriangleGeometry geometry = TriangleCache::Get(heading, triangleBase);
 
-    // Adjusting the bottom left corner
-    double triangleLeftX = nextX + static_cast<int>(triangleBase * qCos(radians)) + static_cast<int>(offset * qCos(radians - M_PI_2));
-    double triangleLeftY = nextY - static_cast<int>(triangleBase * qSin(radians)) - static_cast<int>(offset * qSin(radians - M_PI_2));
+    // The base corners span the bounds of the triangle together with the vertex, which is tested with the disc
+    if (FixedPoint::ToDouble(next.x + geometry.boundsMin.x) < 0 || FixedPoint::ToDouble(next.x + geometry.boundsMax.x) >= size.x() ||
+        FixedPoint::ToDouble(next.y + geometry.boundsMin.y) < 0 || FixedPoint::ToDouble(next.y + geometry.boundsMax.y) >= size.y()) {
+        return false; // Collision detected
+    }
 
-    // Adjusting the bottom right corner
-    double triangleRightX = nextX + static_cast<int>(triangleBase * qCos(radians)) + static_cast<int>(offset * qCos(radians + M_PI_2));
-    double triangleRightY = nextY - static_cast<int>(triangleBase * qSin(radians)) - static_cast<int>(offset * qSin(radians + M_PI_2));
+    // Obstacles are static, so they are tested against the occupancy grid instead of one by one
+    const OccupancyGrid &occupancy = environment.GetOccupancy();
+    QPointF corners[3];
+    cornersAt(geometry, next.x, next.y, corners);
+    if (occupancy.IntersectsDisc(QPointF(nextX, nextY), 13) || occupancy.IntersectsPolygon(corners, 3))
+        return false;
 
-    QPointF point1(triangleLeftX, triangleLeftY);  // Bottom left corner
-    QPointF point2(triangleRightX, triangleRightY);  // Bottom right corner
-    QPointF point3(nextX, nextY); // Vertex
+    return true;
+}
 
-    QPolygonF triangle;
-    triangle << point1 << point2 << point3;
+/**
+ * @brief Tests the step of the robot in a heading against the robots in its neighbour list.
+ * @details The robots are tested by the collision kernel, relative to the end of the step and many at a time.
+ * @param environment The environment containing the robot and other robots.
+ * @param heading The heading of the step and of the triangle in degrees.
+ * @return True if no other robot touches the disc or the triangle at the end of the step.
+ */
+bool Robot::clearOfRobots(Environment &environment, int heading)
+{
+    FixedPoint::Vector next = positionAfterStep(heading);
+    TriangleGeometry geometry = TriangleCache::Get(heading, triangleBase);
+    const std::vector<int> &neighbours = environment.GetNeighbours(number);
+    const std::vector<FixedPoint::Vector> &positions = environment.GetStoredPositions();
+    int count = (static_cast<int>(neighbours.size()) + CollisionKernel::Lanes - 1) / CollisionKernel::Lanes * CollisionKernel::Lanes;
+    thread_local std::vector<float> xs;
+    thread_local std::vector<float> ys;
+    xs.assign(count, CollisionKernel::Far);
+    ys.assign(count, CollisionKernel::Far);
+
+    for (size_t i = 0; i < neighbours.size(); i++)
+    {
+        const FixedPoint::Vector &position = positions[neighbours[i]];
+        xs[i] = FixedPoint::ToDouble(position.x - next.x);
+        ys[i] = FixedPoint::ToDouble(position.y - next.y);
+    }
 
-    // // Adding the triangle to the scene
+    return count == 0 || !CollisionKernel::AnyHit(geometry.query, xs.data(), ys.data(), count);
+}
 
-    QRectF rect = QRectF(nextX-13, nextY-13, 26, 26);
-    QPainterPath robotPath;
-    QPainterPath trianglePath;
+/**
+ * @brief Returns the position the robot moves to in its next step.
+ * @return The position in fixed point.
+ */
+FixedPoint::Vector Robot::nextPosition()
+{
+    return positionAfterStep(direction);
+}
 
-    robotPath.addEllipse(rect);
-    trianglePath.addPolygon(triangle);
+/**
+ * @brief Returns the position the robot would move to in a heading.
+ * @param heading The heading in degrees.
+ * @return The position in fixed point.
+ */
+FixedPoint::Vector Robot::positionAfterStep(int heading)
+{
+    FixedPoint::Vector delta = FixedPoint::Polar(moveDistance * FixedPoint::One, heading);
 
-    if (triangleLeftX < 0 || triangleLeftX >= size.x() ||
-        triangleLeftY < 0 || triangleLeftY >= size.y() ||
-        triangleRightX < 0 || triangleRightX >= size.x() ||
-        triangleRightY < 0 || triangleRightY >= size.y()) {
-        return false; // Collision detected
-    }
+    return { x + delta.x, y + delta.y };
+}
 
-    for (auto robot : robots)
-    {
-        if (robot == this)
-            continue;
-        QPainterPath objectPath;
-        objectPath.addEllipse(robot->boundingRect());
+/**
+ * @brief Returns the geometry of the triangle of the robot relative to its vertex.
+ * @return The geometry from the triangle cache.
+ */
+TriangleGeometry Robot::geometry()
+{
+    return TriangleCache::Get(direction, triangleBase);
+}
 
-        if (objectPath.intersects(robotPath) || objectPath.intersects(trianglePath))
-            return false;
-    }
+/**
+ * @brief Returns the distance from the next position of the robot to the farthest point of its disc or triangle.
+ * @details Includes a margin for the rounding of the triangle corners.
+ * @return The reach in scene units.
+ */
+double Robot::reach()
+{
+    double offset = triangleBase / 2.2;
 
-    for (auto obstacle : obstacles)
-    {
-        QPainterPath objectPath;
-        objectPath.addRect(obstacle->boundingRect());
+    return qMax(13.0, qSqrt(triangleBase * triangleBase + offset * offset) + 1.5);
+}
 
-        if (objectPath.intersects(robotPath) || objectPath.intersects(trianglePath))
-            return false;
-    }
+/**
+ * @brief Returns the area in which another robot could block this robot in its next step.
+ * @return Square around the robot covering its step, its reach and the radius of the other robot.
+ */
+QRectF Robot::sensedArea()
+{
+    double radius = moveDistance + reach() + 12.5;
 
-    return true;
+    QPointF position = getPosition();
+
+    return QRectF(position.x() - radius, position.y() - radius, 2 * radius, 2 * radius);
 }
 
-bool Robot::move()
+/**
+ * @brief Finds a heading in which the robot is not blocked by walls and obstacles.
+ * @details The disc of the robot has to be able to travel its step plus the length of its triangle and the base of
+ * the triangle has to fit at the end. The current heading is never returned, the robot is called when it is blocked
+ * in it. Other robots are not taken into account.
+ * @param environment The environment containing the robot.
+ * @param start The first tried heading in degrees.
+ * @return The found heading in degrees or -1 if there is none.
+ */
+int Robot::freeHeading(Environment &environment, int start)
 {
-    // Výpočet posunu v závislosti na směru
-    qreal dx = moveDistance * cos(qDegreesToRadians(static_cast<qreal>(direction)));
-    qreal dy = -moveDistance * sin(qDegreesToRadians(static_cast<qreal>(direction)));
+    return environment.GetDistanceField().FreeHeading(getPosition(), 12.5, moveDistance + triangleBase, triangleBase / 2.2, start, direction);
+}
 
+/**
+ * @brief Computes for how many ticks the robot is certain to be able to move forward.
+ * @details The clearance decreases by at most one step per tick, so the walls and obstacles cannot be reached
+ * while the clearance exceeds the step plus the reach of the robot. Other robots move by at most one step per tick
+ * as well, so the distance to the nearest one decreases by at most two steps per tick. The pairwise tests of the
+ * environment are padded by the step of the other robot and test the triangles of both robots, so another robot has
+ * to stay out of the larger reach of the two plus both steps, see Environment::TestGroup. Only then the robot would
+ * neither be blocked nor wait for the other one in any of the ticks.
+ * @param environment The environment containing the robot.
+ * @param limit The largest returned number of ticks.
+ * @return Number of following ticks in which the robot can move without any test.
+ */
+int Robot::safeTicks(Environment &environment, int limit)
+{
+    QPointF position = getPosition();
+    double margin = reach() + environment.GetOccupancy().Resolution();
+    int ticks = qMin(limit, qFloor((environment.GetDistanceField().Clearance(position) - margin) / moveDistance) - 1);
+    if (ticks <= 0)
+        return 0;
+
+    double closing = 2.0 * moveDistance;
+    double radius = qMax(reach(), environment.GetLargestReach()) + closing + 13.5 + closing * ticks;
+
+    QRectF area(position.x() - radius, position.y() - radius, 2 * radius, 2 * radius);
+    environment.ForEachChunk(area, [&](Chunk &chunk) {
+        for (auto robot : chunk.robots)
+        {
+            if (robot == this)
+                continue;
+
+            QPointF delta = robot->getPosition() - position;
+            double distance = qSqrt(delta.x() * delta.x() + delta.y() * delta.y());
+            double contact = qMax(reach(), robot->reach()) + closing + 13.5;
+            ticks = qMin(ticks, qMax(0, qFloor((distance - contact) / closing)));
+        }
+
+        return ticks > 0;
+    });
+
+    return ticks;
+}
 
-    // Aktualizace pozice robota
-    position += QPointF(dx, dy);
+/**
+ * @brief Moves the robot one step forward in its current direction.
+ *
+ * @return Always true.
+ */
+bool Robot::move()
+{
+    FixedPoint::Vector delta = step();
+
+    x += delta.x;
+    y += delta.y;
 
     return true;
 }
 
 QRectF Robot::boundingRect() const
 {
-    return QRectF(position.x()-12.5, position.y()-12.5, 25, 25);
+    return QRectF(FixedPoint::ToDouble(x) - 12.5, FixedPoint::ToDouble(y) - 12.5, 25, 25);
 }
 
 /// @internal
@@ -198,6 +447,16 @@ int Robot::getBase()
     return triangleBase;
 }
 
+/**
+ * @brief Retrieves the distance the robot moves in one step.
+ *
+ * @return The step length in scene units.
+ */
+int Robot::getMoveDistance()
+{
+    return moveDistance;
+}
+
 /**
  * @brief Sets the base size of the robot.
  * 
@@ -7,28 +7,55 @@
 #ifndef ROBOT_H
 #define ROBOT_H
 
+#include "fixedpoint.h"
 #include "obstacle.h"
+#include "trianglecache.h"
 #include <QGraphicsItem>
+#include <QPolygonF>
 #include <vector>
 
+class Environment;
+
 class Robot : public QGraphicsItem
 {
 private:
     int direction = 0;
-    QPointF position;
+    qint32 x;
+    qint32 y;
     bool enabled = true;
     int moveDistance = 3;
     int triangleBase = 40;
+    int number = 0;
+    FixedPoint::Vector step();
+    QPolygonF triangleAt(qint32 vertexX, qint32 vertexY);
+    void cornersAt(const TriangleGeometry &geometry, qint32 vertexX, qint32 vertexY, QPointF corners[3]);
+    FixedPoint::Vector positionAfterStep(int heading);
+    bool clearOfStatic(Environment &environment, int heading);
+    bool clearOfRobots(Environment &environment, int heading);
 
 public:
     Robot(QPointF pos);
     static Robot* create(QPointF);
     QPointF getPosition();
-    bool canMove(std::vector<Robot*> &robots, std::vector<Obstacle*> &obstacles, QPointF size);
+    FixedPoint::Vector getFixedPosition();
+    void setState(qint32 x, qint32 y, int direction);
+    int getNumber();
+    void setNumber(int number);
+    QPolygonF triangle();
+    bool canMove(Environment &environment);
+    bool canMoveStatic(Environment &environment);
+    FixedPoint::Vector nextPosition();
+    TriangleGeometry geometry();
+    int freeHeading(Environment &environment, int start);
+    int movableHeading(Environment &environment, int start);
+    double reach();
+    QRectF sensedArea();
+    int safeTicks(Environment &environment, int limit);
     bool move();
     void turn(int times);
     int angle();
     int getBase();
+    int getMoveDistance();
     void setBase(double size);
     bool isEnabled();
     void switchEnabled();
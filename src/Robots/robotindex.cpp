@@ -0,0 +1,121 @@
+/**
+* @file robotindex.cpp
+* @brief Implementation of the RobotIndex class, a spatial index over the current positions of the robots.
+* @details The robots are stored as (cell key, robot index) pairs sorted by the key, where the key orders the cells
+* row by row. A query looks up each covered row of cells with a binary search, so hit-testing costs O(log N)
+* and the memory of the index depends only on the number of robots, not on the size of the environment.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "robotindex.h"
+#include <algorithm>
+#include <QtMath>
+
+/**
+ * @brief Constructor for the RobotIndex class.
+ * @param cellSize Size of one cell of the index in scene units.
+ */
+RobotIndex::RobotIndex(double cellSize)
+{
+    this->cellSize = cellSize;
+    robots = nullptr;
+}
+
+/**
+ * @brief Creates the sort key of a cell, cells are ordered by rows and then by columns.
+ * @param cellX Column of the cell.
+ * @param cellY Row of the cell.
+ * @return Key of the cell.
+ */
+quint64 RobotIndex::cellKey(int cellX, int cellY)
+{
+    return (static_cast<quint64>(static_cast<quint32>(cellY)) << 32) | static_cast<quint32>(cellX);
+}
+
+/**
+ * @brief Rebuilds the index from the current positions of the robots.
+ * @param robots Vector of robots, the index refers to them by their position in this vector.
+ */
+void RobotIndex::Rebuild(std::vector<Robot*> &robots)
+{
+    this->robots = &robots;
+    entries.clear();
+    entries.reserve(robots.size());
+
+    for (int i = 0; i < static_cast<int>(robots.size()); i++)
+    {
+        QPointF position = robots[i]->getPosition();
+        int cellX = qMax(0, qFloor(position.x() / cellSize));
+        int cellY = qMax(0, qFloor(position.y() / cellSize));
+        entries.push_back({cellKey(cellX, cellY), i});
+    }
+
+    std::sort(entries.begin(), entries.end());
+}
+
+/**
+ * @brief Finds all robots whose body intersects the given rectangle.
+ * @param rect Rectangle in scene coordinates.
+ * @return Indexes of the found robots in ascending order.
+ */
+std::vector<int> RobotIndex::Query(QRectF rect)
+{
+    std::vector<int> result;
+
+    if (robots == nullptr)
+        return result;
+
+    const double radius = 12.5;
+    rect = rect.normalized();
+
+    // A robot can reach into the rectangle from the neighbouring cells
+    int firstX = qMax(0, qFloor((rect.left() - radius) / cellSize));
+    int lastX = qMax(0, qFloor((rect.right() + radius) / cellSize));
+    int firstY = qMax(0, qFloor((rect.top() - radius) / cellSize));
+    int lastY = qMax(0, qFloor((rect.bottom() + radius) / cellSize));
+
+    for (int cellY = firstY; cellY <= lastY; cellY++)
+    {
+        auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(cellKey(firstX, cellY), -1));
+        quint64 lastKey = cellKey(lastX, cellY);
+
+        for (; it != entries.end() && it->first <= lastKey; ++it)
+        {
+            QPointF center = (*robots)[it->second]->getPosition();
+            double dx = center.x() - qBound(rect.left(), center.x(), rect.right());
+            double dy = center.y() - qBound(rect.top(), center.y(), rect.bottom());
+
+            if (dx * dx + dy * dy <= radius * radius)
+                result.push_back(it->second);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ * @brief Finds the robot at the given position.
+ * @param pos Position in scene coordinates.
+ * @return Index of the robot closest to the position, -1 if there is no robot at the position.
+ */
+int RobotIndex::At(QPointF pos)
+{
+    int found = -1;
+    double foundDistance = 0;
+
+    for (int index : Query(QRectF(pos, pos)))
+    {
+        QPointF delta = (*robots)[index]->getPosition() - pos;
+        double distance = QPointF::dotProduct(delta, delta);
+
+        if (found == -1 || distance < foundDistance)
+        {
+            found = index;
+            foundDistance = distance;
+        }
+    }
+
+    return found;
+}
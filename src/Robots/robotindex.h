@@ -0,0 +1,30 @@
+/**
+* @file robotindex.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef ROBOTINDEX_H
+#define ROBOTINDEX_H
+
+#include "robot.h"
+#include <QRectF>
+#include <utility>
+#include <vector>
+
+class RobotIndex
+{
+private:
+    double cellSize;
+    std::vector<std::pair<quint64, int>> entries;
+    std::vector<Robot*> *robots;
+    quint64 cellKey(int cellX, int cellY);
+
+public:
+    explicit RobotIndex(double cellSize = 25);
+    void Rebuild(std::vector<Robot*> &robots);
+    std::vector<int> Query(QRectF rect);
+    int At(QPointF pos);
+};
+
+#endif // ROBOTINDEX_H
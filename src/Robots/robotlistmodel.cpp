@@ -0,0 +1,283 @@
+/**
+* @file robotlistmodel.cpp
+* @brief Implementation of the RobotListModel class, a table model exposing the robots of an environment to item views.
+* @details Rows are created on demand by the view, so the cost of the robot panel does not grow with the number of robots.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "robotlistmodel.h"
+
+/**
+ * @brief Constructor for the RobotListModel class.
+ * @param parent The parent QObject.
+ */
+RobotListModel::RobotListModel(QObject *parent)
+    : QAbstractTableModel(parent)
+    , environment(nullptr)
+{}
+
+/**
+ * @brief Sets the environment whose robots are exposed by the model and resets all attached views.
+ * @param environment Pointer to the environment, may be nullptr.
+ */
+void RobotListModel::SetEnvironment(Environment *environment)
+{
+    beginResetModel();
+    this->environment = environment;
+    endResetModel();
+}
+
+/**
+ * @brief Enables or disables all robots in the given rows.
+ * @param rows Indexes of the rows to change, typically the selected rows of the view.
+ * @param enabled New enabled state of the robots.
+ */
+void RobotListModel::SetEnabled(const QModelIndexList &rows, bool enabled)
+{
+    if (rows.isEmpty())
+        return;
+
+    int first = rowCount();
+    int last = -1;
+
+    for (const QModelIndex &index : rows)
+    {
+        Robot *robot = robotAt(index.row());
+        if (robot == nullptr)
+            continue;
+
+        environment->SetRobotEnabled(index.row() + 1, enabled);
+
+        first = qMin(first, index.row());
+        last = qMax(last, index.row());
+    }
+
+    rowsChanged(first, last, EnabledColumn);
+}
+
+/**
+ * @brief Sets the triangle base of all robots in the given rows.
+ * @param rows Indexes of the rows to change, typically the selected rows of the view.
+ * @param base New triangle base, clamped to the range 0 - 300.
+ */
+void RobotListModel::SetBase(const QModelIndexList &rows, int base)
+{
+    if (rows.isEmpty())
+        return;
+
+    int first = rowCount();
+    int last = -1;
+
+    for (const QModelIndex &index : rows)
+    {
+        Robot *robot = robotAt(index.row());
+        if (robot == nullptr)
+            continue;
+
+        environment->SetRobotBase(index.row() + 1, qBound(0, base, 300));
+        emit robotChanged(index.row() + 1);
+
+        first = qMin(first, index.row());
+        last = qMax(last, index.row());
+    }
+
+    rowsChanged(first, last, BaseColumn);
+}
+
+/**
+ * @brief Hands the control over to the given robot.
+ * @param number Number of the robot to be controlled, zero releases the controlled robot.
+ */
+void RobotListModel::SetControlled(int number)
+{
+    if (environment == nullptr || number < 0 || number > rowCount())
+        return;
+
+    int previous = environment->GetControlledNumber();
+    environment->SetControlledRobot(number);
+
+    if (previous != 0)
+        rowsChanged(previous - 1, previous - 1, ControlColumn);
+    if (number != 0)
+        rowsChanged(number - 1, number - 1, ControlColumn);
+}
+
+/**
+ * @brief Returns the number of robots in the environment.
+ * @param parent Parent index, the model is flat so only the invalid index has children.
+ * @return Number of rows.
+ */
+int RobotListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || environment == nullptr)
+        return 0;
+
+    return environment->GetRobots().size();
+}
+
+/**
+ * @brief Returns the number of columns of the model.
+ * @param parent Parent index, the model is flat so only the invalid index has children.
+ * @return Number of columns.
+ */
+int RobotListModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return ColumnCount;
+}
+
+/**
+ * @brief Returns the data of one cell of the robot table.
+ * @param index Index of the cell.
+ * @param role Requested data role.
+ * @return The data of the cell or an invalid QVariant.
+ */
+QVariant RobotListModel::data(const QModelIndex &index, int role) const
+{
+    Robot *robot = robotAt(index.row());
+    if (robot == nullptr)
+        return QVariant();
+
+    switch (index.column()) {
+    case NumberColumn:
+        if (role == Qt::DisplayRole)
+            return QString("Robot %1").arg(index.row() + 1);
+        break;
+    case EnabledColumn:
+        if (role == Qt::CheckStateRole)
+            return robot->isEnabled() ? Qt::Checked : Qt::Unchecked;
+        break;
+    case BaseColumn:
+        if (role == Qt::DisplayRole || role == Qt::EditRole)
+            return robot->getBase();
+        break;
+    case ControlColumn:
+        if (role == Qt::CheckStateRole)
+            return isControlled(index.row()) ? Qt::Checked : Qt::Unchecked;
+        break;
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+/**
+ * @brief Returns the titles of the columns.
+ * @param section Column number.
+ * @param orientation Orientation of the header.
+ * @param role Requested data role.
+ * @return Title of the column or an invalid QVariant.
+ */
+QVariant RobotListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section) {
+    case NumberColumn:
+        return tr("Robot");
+    case EnabledColumn:
+        return tr("On");
+    case BaseColumn:
+        return tr("Base");
+    case ControlColumn:
+        return tr("Ctrl");
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * @brief Changes the enabled state, triangle base or controlled robot from an item view.
+ * @param index Index of the edited cell.
+ * @param value New value of the cell.
+ * @param role Role of the edited data.
+ * @return True if the robot was changed.
+ */
+bool RobotListModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    Robot *robot = robotAt(index.row());
+    if (robot == nullptr)
+        return false;
+
+    if (index.column() == EnabledColumn && role == Qt::CheckStateRole)
+    {
+        SetEnabled({index}, value.toInt() == Qt::Checked);
+        return true;
+    }
+
+    if (index.column() == BaseColumn && role == Qt::EditRole)
+    {
+        SetBase({index}, value.toInt());
+        return true;
+    }
+
+    if (index.column() == ControlColumn && role == Qt::CheckStateRole)
+    {
+        SetControlled(value.toInt() == Qt::Checked ? index.row() + 1 : 0);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Returns the item flags of a cell, the check boxes and the triangle base are editable.
+ * @param index Index of the cell.
+ * @return Flags of the cell.
+ */
+Qt::ItemFlags RobotListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemNeverHasChildren;
+
+    if (index.column() == EnabledColumn || index.column() == ControlColumn)
+        flags |= Qt::ItemIsUserCheckable;
+    else if (index.column() == BaseColumn)
+        flags |= Qt::ItemIsEditable;
+
+    return flags;
+}
+
+/**
+ * @brief Returns the robot shown in the given row.
+ * @param row Row of the table.
+ * @return Pointer to the robot or nullptr if the row is out of range.
+ */
+Robot* RobotListModel::robotAt(int row) const
+{
+    if (environment == nullptr || row < 0 || row >= static_cast<int>(environment->GetRobots().size()))
+        return nullptr;
+
+    return environment->GetRobots()[row];
+}
+
+/**
+ * @brief Checks whether the robot in the given row is the controlled one.
+ * @param row Row of the table.
+ * @return True if the robot is controlled by the user.
+ */
+bool RobotListModel::isControlled(int row) const
+{
+    return environment != nullptr && environment->GetControlledNumber() == row + 1;
+}
+
+/**
+ * @brief Notifies the views that one column of a range of rows has changed.
+ * @param first First changed row.
+ * @param last Last changed row.
+ * @param column The changed column.
+ */
+void RobotListModel::rowsChanged(int first, int last, int column)
+{
+    if (first > last)
+        return;
+
+    emit dataChanged(index(first, column), index(last, column));
+}
@@ -0,0 +1,50 @@
+/**
+* @file robotlistmodel.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef ROBOTLISTMODEL_H
+#define ROBOTLISTMODEL_H
+
+#include "environment.h"
+#include <QAbstractTableModel>
+
+class RobotListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        NumberColumn,
+        EnabledColumn,
+        BaseColumn,
+        ControlColumn,
+        ColumnCount
+    };
+
+    explicit RobotListModel(QObject *parent = nullptr);
+    void SetEnvironment(Environment *environment);
+    void SetEnabled(const QModelIndexList &rows, bool enabled);
+    void SetBase(const QModelIndexList &rows, int base);
+    void SetControlled(int number);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+Q_SIGNALS:
+    void robotChanged(int number);
+
+private:
+    Environment *environment;
+    Robot* robotAt(int row) const;
+    bool isControlled(int row) const;
+    void rowsChanged(int first, int last, int column);
+};
+
+#endif // ROBOTLISTMODEL_H
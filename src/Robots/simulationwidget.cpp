@@ -21,12 +21,48 @@ SimulationWidget::SimulationWidget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::SimulationWidget)
     , scene(new MapPainter(parent))
+    , robotModel(new RobotListModel(this))
     , environment(nullptr)
+    , scheduler(nullptr)
+    , regionScheduler(nullptr)
+    , coordinator(nullptr)
 {
     ui->setupUi(this);
     scene = new MapPainter(parent);
     ui->graphicsView->setScene(scene);
 
+    // Rows have a fixed height, so the view lays out and paints only the visible robots
+    ui->robotView->setModel(robotModel);
+    ui->robotView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->robotView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    // Repaints are coalesced to at most one per display frame
+    QScreen *screen = QGuiApplication::primaryScreen();
+    frameInterval = qMax(1, qRound(1000.0 / (screen != nullptr && screen->refreshRate() > 0 ? screen->refreshRate() : 60.0)));
+    repaintTimer = new QTimer(this);
+    repaintTimer->setSingleShot(true);
+    connect(repaintTimer, &QTimer::timeout, this, &SimulationWidget::flushRepaint);
+
+    // The performance overlay floats over the top left corner of the view and lets clicks through
+    scene->SetMonitor(&monitor);
+    hudLabel = new QLabel(ui->graphicsView);
+    hudLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+    hudLabel->setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 160); color: white; padding: 6px; font-family: monospace; }");
+    hudLabel->move(8, 8);
+    hudLabel->hide();
+    hudTimer = new QTimer(this);
+    connect(hudTimer, &QTimer::timeout, this, &SimulationWidget::updateHud);
+
+    connect(robotModel, &RobotListModel::robotChanged, this, [=](int number) {
+        requestRepaint(number);
+    });
+    connect(robotModel, &QAbstractItemModel::dataChanged, this, &SimulationWidget::robotData_changed);
+
+    // Robots are picked in the view by a click or a rubber band, the selection is shared with the robot table
+    rubberBand = new QRubberBand(QRubberBand::Rectangle, ui->graphicsView->viewport());
+    ui->graphicsView->viewport()->installEventFilter(this);
+    connect(ui->robotView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &SimulationWidget::robotSelection_changed);
+
     connect(ui->backButton, SIGNAL(clicked(bool)), this, SLOT(backButton_clicked()));
     connect(ui->ppButton, SIGNAL(clicked(bool)), this, SLOT(ppButton_clicked()));
     connect(ui->forwardButton, SIGNAL(clicked(bool)), this, SLOT(forwardMove()));
@@ -34,6 +70,25 @@ SimulationWidget::SimulationWidget(QWidget *parent)
     connect(ui->rightButton, SIGNAL(clicked(bool)), this, SLOT(rightRotate()));
     connect(ui->multiplySpin, SIGNAL(valueChanged(double)), this, SLOT(multiplySpin_valueChanged()));
     connect(ui->reloadButton, SIGNAL(clicked(bool)), this, SLOT(reloadButton_clicked()));
+    connect(ui->startButton, SIGNAL(clicked(bool)), this, SLOT(startButton_clicked()));
+    connect(ui->stopButton, SIGNAL(clicked(bool)), this, SLOT(stopButton_clicked()));
+    connect(ui->baseButton, SIGNAL(clicked(bool)), this, SLOT(baseButton_clicked()));
+    connect(ui->controlButton, SIGNAL(clicked(bool)), this, SLOT(controlButton_clicked()));
+    connect(ui->eventCheck, SIGNAL(toggled(bool)), this, SLOT(eventCheck_toggled(bool)));
+    connect(ui->parallelCheck, SIGNAL(toggled(bool)), this, SLOT(parallelCheck_toggled(bool)));
+    connect(ui->processCheck, SIGNAL(toggled(bool)), this, SLOT(processCheck_toggled(bool)));
+    connect(ui->hudCheck, SIGNAL(toggled(bool)), this, SLOT(hudCheck_toggled(bool)));
+    connect(ui->historySlider, SIGNAL(valueChanged(int)), this, SLOT(historySlider_valueChanged(int)));
+#ifndef ROBOTS_MULTIPROCESS
+    ui->processCheck->hide();
+#endif
+
+    // Editors write a file in several steps, the changes of the map file are applied once it is quiet
+    mapWatcher = new QFileSystemWatcher(this);
+    mapChangeTimer = new QTimer(this);
+    mapChangeTimer->setSingleShot(true);
+    connect(mapWatcher, &QFileSystemWatcher::fileChanged, this, &SimulationWidget::mapFile_changed);
+    connect(mapChangeTimer, &QTimer::timeout, this, &SimulationWidget::applyMapChanges);
 
     this->mapFilePath = QFileDialog::getOpenFileName(this, tr("Open CSV File"), "", tr("CSV Files (*.csv);;All Files (*)"));
 
@@ -51,6 +106,11 @@ SimulationWidget::SimulationWidget(QWidget *parent)
  */
 SimulationWidget::~SimulationWidget()
 {
+    delete scheduler;
+    delete regionScheduler;
+#ifdef ROBOTS_MULTIPROCESS
+    delete coordinator;
+#endif
     delete ui;
 }
 
@@ -69,7 +129,7 @@ void SimulationWidget::backButton_clicked()
 /**
  * @brief Loads the map from the selected CSV file and creates the map.
  * 
- * Creates dynamicly UI elements for each robot in the environment.
+ * Hands the robots of the environment over to the robot table model.
  */
 void SimulationWidget::loadMap()
 {
@@ -106,96 +166,274 @@ void SimulationWidget::loadMap()
 
     scene->PaintMap(*environment);
 
-    QWidget *widget = new QWidget;
-    QHBoxLayout *layout = new QHBoxLayout(widget);
-    QButtonGroup *buttonGroup = new QButtonGroup(this);
-    QRadioButton *noneRadioButton = new QRadioButton(QString("None"));
-    noneRadioButton->setChecked(true);
+    robotModel->SetEnvironment(environment);
+    timeline.Reset(*environment);
+    updateHistorySlider();
+    watchMap();
 
-    layout->setAlignment(Qt::AlignTop);
+    // Set up the simulation timer
+    simulationTimer = new QTimer(this);
+    connect(simulationTimer, &QTimer::timeout, this, &SimulationWidget::simulate);
+}
+
+/**
+ * @brief Starts all robots selected in the robot table.
+ */
+void SimulationWidget::startButton_clicked()
+{
+    robotModel->SetEnabled(ui->robotView->selectionModel()->selectedRows(), true);
+}
 
-    layout->addWidget(noneRadioButton);
-    widget->setLayout(layout);
+/**
+ * @brief Stops all robots selected in the robot table.
+ */
+void SimulationWidget::stopButton_clicked()
+{
+    robotModel->SetEnabled(ui->robotView->selectionModel()->selectedRows(), false);
+}
 
-    ui->robotWidget->layout()->addWidget(widget);
-    buttonGroup->addButton(noneRadioButton);
+/**
+ * @brief Sets the triangle base of all robots selected in the robot table to the value of the base spin box.
+ */
+void SimulationWidget::baseButton_clicked()
+{
+    robotModel->SetBase(ui->robotView->selectionModel()->selectedRows(), ui->baseSpin->value());
+}
 
-    for (int i = 1; i <= environment->GetRobots().size(); i++) {
-        QWidget *widget = new QWidget;
-        QVBoxLayout *layout = new QVBoxLayout(widget);
-        QHBoxLayout *buttonLayout = new QHBoxLayout;
-        QPushButton *startStopButton = new QPushButton("Stop");
-        QRadioButton *robotRadioButton = new QRadioButton(QString("Robot %1").arg(i));
-        QSlider *triangleBaseSlider = new QSlider(Qt::Horizontal);
+/**
+ * @brief Hands the control over to the first robot selected in the robot table.
+ *
+ * If no robot is selected, the controlled robot is released.
+ */
+void SimulationWidget::controlButton_clicked()
+{
+    QModelIndexList rows = ui->robotView->selectionModel()->selectedRows();
+
+    robotModel->SetControlled(rows.isEmpty() ? 0 : rows.first().row() + 1);
+}
+
+/**
+ * @brief Outlines the robots selected in the robot table in the scene.
+ *
+ * Only the robots whose selection state changed are painted again.
+ *
+ * @param selected The newly selected items.
+ * @param deselected The newly deselected items.
+ */
+void SimulationWidget::robotSelection_changed(const QItemSelection &selected, const QItemSelection &deselected)
+{
+    if (environment == nullptr)
+        return;
+
+    for (const QItemSelectionRange &range : selected)
+    {
+        for (int row = range.top(); row <= range.bottom(); row++)
+        {
+            scene->SetSelected(row + 1, true);
+            requestRepaint(row + 1);
+        }
+    }
 
-        triangleBaseSlider->setRange(0, 300);
-        triangleBaseSlider->setValue(30);
+    for (const QItemSelectionRange &range : deselected)
+    {
+        for (int row = range.top(); row <= range.bottom(); row++)
+        {
+            scene->SetSelected(row + 1, false);
+            requestRepaint(row + 1);
+        }
+    }
+}
 
-        layout->setAlignment(Qt::AlignTop);
+/**
+ * @brief Requests a repaint of the whole map, performed with the next display frame.
+ */
+void SimulationWidget::requestRepaint()
+{
+    fullRepaintPending = true;
+    scheduleRepaint();
+}
 
-        buttonLayout->addWidget(robotRadioButton);
-        buttonLayout->addWidget(startStopButton);
+/**
+ * @brief Marks one robot as changed, it is painted again with the next display frame.
+ * @param number Number of the changed robot.
+ */
+void SimulationWidget::requestRepaint(int number)
+{
+    if (number < 1)
+        return;
 
-        layout->addLayout(buttonLayout);
+    if (number > static_cast<int>(robotDirty.size()))
+        robotDirty.resize(number, false);
 
-        layout->addWidget(triangleBaseSlider);
+    if (!robotDirty[number - 1])
+    {
+        robotDirty[number - 1] = true;
+        dirtyRobots.push_back(number);
+    }
 
-        widget->setLayout(layout);
+    scheduleRepaint();
+}
 
-        ui->robotWidget->layout()->addWidget(widget);
+/**
+ * @brief Starts the repaint timer, so that repaints are at least one display frame apart.
+ */
+void SimulationWidget::scheduleRepaint()
+{
+    if (repaintTimer->isActive())
+        return;
 
-        buttonGroup->addButton(robotRadioButton);
+    qint64 elapsed = lastRepaint.isValid() ? lastRepaint.elapsed() : frameInterval;
+    repaintTimer->start(qMax<qint64>(0, frameInterval - elapsed));
+}
 
-        // Connect signals and slots for the robot triangle base slider 
-        connect(triangleBaseSlider, &QSlider::valueChanged, this, [=](int value) {
-            environment->GetRobotByNumber(i).setBase(value);
-            scene->PaintMap(*environment);
-        });
+/**
+ * @brief Paints all pending changes, either the whole map or only the changed robots.
+ */
+void SimulationWidget::flushRepaint()
+{
+    lastRepaint.start();
 
-        // Connect signals and slots for the start/stop button
-        connect(startStopButton, &QPushButton::clicked, this, [=]() {
-            environment->GetRobotByNumber(i).switchEnabled();
+    if (environment == nullptr)
+        return;
 
-            if (environment->GetRobotByNumber(i).isEnabled())
-                startStopButton->setText("Stop");
-            else
-                startStopButton->setText("Start");
-        });
+    if (fullRepaintPending)
+        scene->PaintMap(*environment);
+    else
+    {
+        for (int number : dirtyRobots)
+            scene->UpdateRobot(*environment, number);
     }
 
-    // Add a signal to the button group to detect when a radio button is clicked
-    connect(buttonGroup, SIGNAL(buttonClicked(QAbstractButton*)), this, SLOT(robotPicker(QAbstractButton*)));
+    for (int number : dirtyRobots)
+        robotDirty[number - 1] = false;
 
-    // Set up the simulation timer
-    simulationTimer = new QTimer(this);
-    connect(simulationTimer, &QTimer::timeout, this, &SimulationWidget::simulate);
+    dirtyRobots.clear();
+    fullRepaintPending = false;
 }
 
 /**
- * @brief Sets the controlled robot based on the selected radio button.
- * 
- * This function is called when a radio button is clicked in the simulation widget.
- * It retrieves the text of the selected radio button and determines the robot number
- * based on the text. If the selected radio button is "None", the controlled robot is set to 0.
- * Otherwise, the text is split into parts and the last part is converted to an integer to get
- * the robot number. The controlled robot is then set to the determined robot number.
- * 
- * @param button A pointer to the selected radio button.
+ * @brief Selects robots in the robot table.
+ *
+ * Consecutive robot numbers are merged into a single selection range, so selecting a large swarm
+ * creates only a few ranges.
+ *
+ * @param numbers Numbers of the robots in ascending order.
+ * @param toggle If true, the selection state of the robots is toggled, otherwise they replace the current selection.
+ */
+void SimulationWidget::selectRobots(const std::vector<int> &numbers, bool toggle)
+{
+    QItemSelection selection;
+
+    for (size_t first = 0; first < numbers.size();)
+    {
+        size_t last = first;
+        while (last + 1 < numbers.size() && numbers[last + 1] == numbers[last] + 1)
+            last++;
+
+        selection.select(robotModel->index(numbers[first] - 1, 0), robotModel->index(numbers[last] - 1, RobotListModel::ColumnCount - 1));
+        first = last + 1;
+    }
+
+    QItemSelectionModel::SelectionFlags command = toggle ? QItemSelectionModel::Toggle : QItemSelectionModel::ClearAndSelect;
+    ui->robotView->selectionModel()->select(selection, command | QItemSelectionModel::Rows);
+
+    if (!numbers.empty())
+        ui->robotView->scrollTo(robotModel->index(numbers.front() - 1, 0));
+}
+
+/**
+ * @brief Handles mouse events of the simulation view to pick robots.
+ *
+ * A click selects the robot under the cursor, dragging selects all robots in the rubber band.
+ * Holding Ctrl toggles the robots instead of replacing the selection.
+ * While "Edit obstacles" is checked, a click adds or removes an obstacle instead, see toggleObstacle.
+ *
+ * @param watched The object receiving the event.
+ * @param event The received event.
+ * @return True if the event was consumed.
  */
-void SimulationWidget::robotPicker(QAbstractButton *button) {
-    QRadioButton *selectedRadioButton = qobject_cast<QRadioButton*>(button);
-    if (selectedRadioButton && selectedRadioButton->isChecked()) 
+bool SimulationWidget::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched != ui->graphicsView->viewport() || environment == nullptr)
+        return QWidget::eventFilter(watched, event);
+
+    if (event->type() == QEvent::MouseButtonPress)
     {
-        QString robotName = selectedRadioButton->text();
-        if (robotName == "None")
-            environment->SetControlledRobot(0);
-        else 
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+        if (mouseEvent->button() == Qt::LeftButton && ui->obstacleCheck->isChecked())
         {
-            QStringList parts = robotName.split(" ");
-            int robotNumber = parts.back().toInt();
-            environment->SetControlledRobot(robotNumber);
+            toggleObstacle(ui->graphicsView->mapToScene(mouseEvent->pos()));
+            return true;
+        }
+
+        if (mouseEvent->button() == Qt::LeftButton)
+        {
+            selectionOrigin = mouseEvent->pos();
+            rubberBand->setGeometry(QRect(selectionOrigin, QSize()));
+            rubberBand->show();
+            return true;
         }
     }
+    else if (event->type() == QEvent::MouseMove && rubberBand->isVisible())
+    {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+        rubberBand->setGeometry(QRect(selectionOrigin, mouseEvent->pos()).normalized());
+        return true;
+    }
+    else if (event->type() == QEvent::MouseButtonRelease && rubberBand->isVisible())
+    {
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+        bool toggle = mouseEvent->modifiers() & Qt::ControlModifier;
+        rubberBand->hide();
+
+        if ((mouseEvent->pos() - selectionOrigin).manhattanLength() < QApplication::startDragDistance())
+        {
+            int number = environment->GetRobotAt(ui->graphicsView->mapToScene(mouseEvent->pos()));
+            selectRobots(number == 0 ? std::vector<int>() : std::vector<int>{number}, toggle);
+        }
+        else
+        {
+            QRectF rect = ui->graphicsView->mapToScene(rubberBand->geometry()).boundingRect();
+            selectRobots(environment->GetRobotsIn(rect), toggle);
+        }
+
+        return true;
+    }
+
+    return QWidget::eventFilter(watched, event);
+}
+
+/**
+ * @brief Removes the obstacle under the cursor or adds one centered at it, while the simulation runs.
+ * @details Only the chunks, the occupancy grid, the distance field and the painted obstacles around the obstacle are
+ * updated. No obstacle is added over a robot. In the event-driven mode the robots which could reach an added obstacle
+ * before their next test are tested in the next tick, the worker processes repeat the edit before their next tick.
+ * The recorded history holds only the robots, so it starts again from the edited map.
+ * @param pos Position of the cursor in scene coordinates.
+ */
+void SimulationWidget::toggleObstacle(QPointF pos)
+{
+    if (!QRectF(QPointF(0, 0), environment->GetSize()).contains(pos))
+        return;
+
+    // Positions in a map file are whole numbers
+    Obstacle *obstacle = environment->GetObstacleAt(pos);
+    bool adding = obstacle == nullptr;
+    QPointF corner = adding ? QPointF(qRound(pos.x() - 12.5), qRound(pos.y() - 12.5)) : obstacle->getPosition();
+    QRectF rect(corner, QSizeF(25, 25));
+
+    if (adding && !environment->GetRobotsIn(rect).empty())
+        return;
+
+    if (!environment->SetObstacle(corner, adding))
+        return;
+
+    scene->UpdateObstacles(*environment, Environment::ChunkKey(corner));
+    if (adding && scheduler != nullptr)
+        scheduler->WakeNear(rect);
+
+    timeline.Reset(*environment);
+    updateHistorySlider();
 }
 
 /**
@@ -223,25 +461,75 @@ void SimulationWidget::ppButton_clicked()
 /**
  * @brief Simulates the movement of robots in the environment.
  *
- * This function iterates through each robot in the environment and checks if it is enabled and not the controlled robot.
+ * This function iterates through the active robots of the environment, stopped, sleeping and controlled robots are skipped.
  * If the robot can move without colliding with other robots or obstacles, it moves in a straight line.
- * Otherwise, it randomly turns the robot.
+ * Otherwise, it turns the robot to a free heading found in the distance field, starting the search at a random heading.
+ *
+ * In the event-driven mode the robots are tested only when they could possibly be blocked, see EventScheduler.
+ * In the multi-core mode separate parts of the world are stepped by worker threads, see RegionScheduler.
+ * In the multi-process mode they are stepped by worker processes, see DistributedCoordinator.
  *
- * After simulating the movement of all robots, the scene is updated to reflect the changes in the environment.
+ * Every moved or turned robot is marked for the next repaint of the scene.
+ *
+ * The heap allocations of the tick are recorded in the tick statistics, see AllocationCounter, its duration and
+ * collision tests in the performance monitor. The resulting state is recorded in the timeline.
  */
 void SimulationWidget::simulate()
 {
-    for (auto robot : environment->GetRobots())
+    quint64 checks = environment->GetCollisionChecks();
+    QElapsedTimer timer;
+    timer.start();
+
+    tickStatistics.BeginTick();
+    step();
+    tickStatistics.EndTick();
+
+    monitor.RecordTick(timer.nsecsElapsed(), environment->GetCollisionChecks() - checks);
+
+    timeline.Record(*environment);
+    updateHistorySlider();
+}
+
+/**
+ * @brief Performs one tick of the simulation in the selected mode.
+ */
+void SimulationWidget::step()
+{
+    if (scheduler != nullptr)
     {
-        if (!robot->isEnabled() || robot == &environment->GetControlledRobot())
-            continue;
-        if(robot->canMove(environment->GetRobots(), environment->GetObstacles(), environment->GetSize()))
-            robot->move();
-        else
-            robot->turn(rand()%360 + 1);
+        for (int number : scheduler->Step())
+            requestRepaint(number);
+        return;
+    }
 
+    if (regionScheduler != nullptr)
+    {
+        for (int number : regionScheduler->Step())
+            requestRepaint(number);
+        return;
     }
-    scene->PaintMap(*environment);
+
+#ifdef ROBOTS_MULTIPROCESS
+    if (coordinator != nullptr)
+    {
+        // Robots changed by the user are sent to the workers before they step
+        bool ok = coordinator->Update(pendingUpdates) && coordinator->Step();
+        pendingUpdates.clear();
+
+        for (int number : coordinator->Gather())
+            requestRepaint(number);
+
+        if (!ok)
+        {
+            QMessageBox::warning(this, tr("Error"), tr("A worker process has failed."));
+            ui->processCheck->setChecked(false);
+        }
+        return;
+    }
+#endif
+
+    for (int number : environment->StepActiveRobots())
+        requestRepaint(number);
 }
 
 /**
@@ -252,12 +540,17 @@ void SimulationWidget::forwardMove()
 {
     Robot* robot = &environment->GetControlledRobot();
 
-    if (robot == nullptr || !robot->canMove(environment->GetRobots(), environment->GetObstacles(), environment->GetSize()))
+    if (robot == nullptr || !robot->canMove(*environment))
         return;
 
-    robot->move();
+    environment->MoveRobot(robot);
 
-    scene->PaintMap(*environment);
+    // The controlled robot may move faster than the simulation, so no robot is known to be free anymore
+    if (scheduler != nullptr)
+        scheduler->WakeAll();
+
+    pendingUpdates.push_back(environment->GetControlledNumber());
+    requestRepaint(environment->GetControlledNumber());
 }
 
 /**
@@ -273,7 +566,8 @@ void SimulationWidget::leftRotate()
 
     robot->turn(10);
 
-    scene->PaintMap(*environment);
+    pendingUpdates.push_back(environment->GetControlledNumber());
+    requestRepaint(environment->GetControlledNumber());
 }
 
 /**
@@ -289,7 +583,8 @@ void SimulationWidget::rightRotate()
 
     robot->turn(-10);
 
-    scene->PaintMap(*environment);
+    pendingUpdates.push_back(environment->GetControlledNumber());
+    requestRepaint(environment->GetControlledNumber());
 }
 
 /**
@@ -323,12 +618,212 @@ void SimulationWidget::multiplySpin_valueChanged()
         simulationTimer->start(100 / ui->multiplySpin->value());
 }
 
+/**
+ * @brief Shows or hides the performance overlay.
+ * @details The monitor records all the time, the values recorded while the overlay was hidden are dropped.
+ * @param checked True if the overlay is shown.
+ */
+void SimulationWidget::hudCheck_toggled(bool checked)
+{
+    if (checked)
+    {
+        monitor.TakeSample();
+        hudClock.start();
+        hudLabel->setText(tr("Measuring..."));
+        hudLabel->adjustSize();
+        hudLabel->show();
+        hudLabel->raise();
+        hudTimer->start(500);
+    }
+    else
+    {
+        hudTimer->stop();
+        hudLabel->hide();
+    }
+}
+
+/**
+ * @brief Shows the performance of the simulation since the previous update in the overlay.
+ * @details The achieved speed is the requested multiplier scaled by the ticks per second achieved against the ticks
+ * per second requested by the simulation timer, whose interval is the budget of one tick.
+ */
+void SimulationWidget::updateHud()
+{
+    if (environment == nullptr)
+        return;
+
+    PerformanceMonitor::Sample sample = monitor.TakeSample();
+    double seconds = hudClock.restart() / 1000.0;
+    double ticksPerSecond = seconds > 0 ? sample.ticks / seconds : 0;
+
+    double budget = simulationTimer->interval();
+    double requested = simulationRunning ? ui->multiplySpin->value() : 0;
+    double achieved = simulationRunning && budget > 0 ? requested * ticksPerSecond * budget / 1000 : 0;
+
+    qint64 resident = PerformanceMonitor::ResidentMemory();
+    int active = environment->GetActiveRobots().size();
+
+    QStringList lines;
+    lines << tr("Ticks/s: %1").arg(ticksPerSecond, 0, 'f', 1)
+          << tr("Speed: %1x of %2x").arg(achieved, 0, 'f', 2).arg(requested, 0, 'f', 2)
+          << tr("Tick p50/p99: %1 / %2 ms (budget %3 ms)").arg(sample.tickP50 / 1e6, 0, 'f', 2).arg(sample.tickP99 / 1e6, 0, 'f', 2).arg(budget, 0, 'f', 0)
+          << tr("Render p50/p99: %1 / %2 ms").arg(sample.renderP50 / 1e6, 0, 'f', 2).arg(sample.renderP99 / 1e6, 0, 'f', 2)
+          << tr("Robots: %1 active, %2 sleeping").arg(active).arg(environment->GetSleepingCount())
+          << tr("Collision checks/tick: %1").arg(sample.ticks > 0 ? sample.collisionChecks / sample.ticks : 0)
+          << tr("Resident memory: %1").arg(resident < 0 ? tr("n/a") : tr("%1 MB").arg(resident / 1048576.0, 0, 'f', 1));
+
+    hudLabel->setText(lines.join('\n'));
+    hudLabel->adjustSize();
+}
+
+/**
+ * @brief Restores the tick selected by the history slider.
+ * @details The simulation is paused. The schedulers keep their own view of the robots, so they start again from the
+ * restored state and the worker processes receive all robots. Resuming the simulation drops the ticks after the
+ * restored one.
+ * @param value The selected tick.
+ */
+void SimulationWidget::historySlider_valueChanged(int value)
+{
+    if (environment == nullptr || static_cast<quint64>(value) == timeline.GetCurrentTick())
+        return;
+
+    if (simulationRunning)
+    {
+        simulationRunning = false;
+        simulationTimer->stop();
+    }
+
+    if (!timeline.Seek(*environment, value))
+    {
+        updateHistorySlider();
+        return;
+    }
+
+    if (scheduler != nullptr)
+        eventCheck_toggled(true);
+    if (regionScheduler != nullptr)
+        parallelCheck_toggled(true);
+    if (coordinator != nullptr)
+    {
+        for (int number = 1; number <= static_cast<int>(environment->GetRobots().size()); number++)
+            pendingUpdates.push_back(number);
+    }
+
+    requestRepaint();
+}
+
+/**
+ * @brief Sets the range of the history slider to the recorded ticks and its position to the current tick.
+ */
+void SimulationWidget::updateHistorySlider()
+{
+    QSignalBlocker blocker(ui->historySlider);
+    ui->historySlider->setRange(timeline.GetFirstTick(), timeline.GetLastTick());
+    ui->historySlider->setValue(timeline.GetCurrentTick());
+}
+
+/**
+ * @brief Remembers the objects of the loaded map file and starts watching the file for changes.
+ */
+void SimulationWidget::watchMap()
+{
+    std::ifstream file(mapFilePath.toStdString());
+    mapDiff.Load(file);
+
+    if (!mapWatcher->files().contains(mapFilePath))
+        mapWatcher->addPath(mapFilePath);
+}
+
+/**
+ * @brief Slot function triggered when the map file is changed by another program.
+ * @details The changes are applied after the file has not changed for 200 ms.
+ * @param path Path of the changed file.
+ */
+void SimulationWidget::mapFile_changed(const QString &path)
+{
+    Q_UNUSED(path);
+    mapChangeTimer->start(200);
+}
+
+/**
+ * @brief Applies the changes of the map file to the running simulation.
+ * @details Only the added and removed obstacles and robots are applied, the other robots keep their simulated state
+ * and the selection. The painted robots and the painted obstacles of the changed chunks are updated in place. The
+ * schedulers start again from the changed environment. A map of another size, or any change in the multi-process
+ * mode, whose workers received their strips when they were started, loads the map again as the reload button does.
+ * A file which cannot be read, for example while it is being written, is ignored until it changes again.
+ */
+void SimulationWidget::applyMapChanges()
+{
+    // Editors which replace the file when saving it make the watcher forget it
+    if (!mapWatcher->files().contains(mapFilePath) && QFile::exists(mapFilePath))
+        mapWatcher->addPath(mapFilePath);
+
+    if (environment == nullptr)
+        return;
+
+    if (coordinator != nullptr)
+    {
+        reloadButton_clicked();
+        return;
+    }
+
+    // The selected robots are selected again after the rows of the robot table are reset
+    std::vector<int> selected;
+    for (const QModelIndex &index : ui->robotView->selectionModel()->selectedRows())
+        selected.push_back(index.row() + 1);
+
+    std::ifstream file(mapFilePath.toStdString());
+    MapDiff::Changes changes;
+    MapDiff::Result result = mapDiff.Apply(file, *environment, changes);
+
+    if (result == MapDiff::Reload)
+    {
+        reloadButton_clicked();
+        return;
+    }
+
+    if (result != MapDiff::Applied)
+        return;
+
+    for (int number : changes.removedRobots)
+    {
+        scene->RemoveRobot(number);
+
+        auto removed = std::find(selected.begin(), selected.end(), number);
+        if (removed != selected.end())
+            selected.erase(removed);
+
+        for (int &other : selected)
+            other -= other > number;
+    }
+
+    int count = environment->GetRobots().size();
+    for (int number = count - changes.addedRobots + 1; number <= count; number++)
+        scene->AddRobot(*environment, number);
+
+    for (quint64 key : changes.obstacleChunks)
+        scene->UpdateObstacles(*environment, key);
+
+    robotModel->SetEnvironment(environment);
+    std::sort(selected.begin(), selected.end());
+    if (!selected.empty())
+        selectRobots(selected, false);
+
+    timeline.Reset(*environment);
+    updateHistorySlider();
+    eventCheck_toggled(ui->eventCheck->isChecked());
+    parallelCheck_toggled(ui->parallelCheck->isChecked());
+}
+
 /**
  * @brief Slot function triggered when the reload button is clicked in the SimulationWidget.
  * 
  * Seeds the random number generator with the memory address of the current object again.
  * Stops the simulation timer and sets the simulationRunning flag to false.
- * Load the map from the file again and create map.
+ * Load the map from the file again and create map. The schedulers and the worker processes of the previous
+ * environment are stopped before it is deleted, a map which cannot be loaded keeps it.
  */
 void SimulationWidget::reloadButton_clicked()
 {
@@ -347,23 +842,145 @@ void SimulationWidget::reloadButton_clicked()
 
     std::ifstream file(filePath.toStdString());
 
-    environment = Environment::LoadEnvironment(file);
+    Environment *loaded = Environment::LoadEnvironment(file);
 
-    if (environment == nullptr)
+    if (loaded == nullptr)
     {
         file.close();
         emit backRequested();
         return;
     }
 
-    if (!environment->LoadObjects(file))
+    if (!loaded->LoadObjects(file))
     {
         file.close();
+        delete loaded;
         emit backRequested();
         return;
     }
 
     file.close();
 
-    scene->PaintMap(*environment);
+    delete scheduler;
+    scheduler = nullptr;
+    delete regionScheduler;
+    regionScheduler = nullptr;
+#ifdef ROBOTS_MULTIPROCESS
+    delete coordinator;
+    coordinator = nullptr;
+    pendingUpdates.clear();
+#endif
+
+    Environment *previous = environment;
+    environment = loaded;
+    robotModel->SetEnvironment(environment);
+    delete previous;
+
+    timeline.Reset(*environment);
+    updateHistorySlider();
+    watchMap();
+    scene->ClearSelection();
+    eventCheck_toggled(ui->eventCheck->isChecked());
+    parallelCheck_toggled(ui->parallelCheck->isChecked());
+    processCheck_toggled(ui->processCheck->isChecked());
+    requestRepaint();
+}
+
+/**
+ * @brief Switches between testing every robot in every tick and the event-driven mode.
+ * @param checked True to test the robots only when they could possibly be blocked.
+ */
+void SimulationWidget::eventCheck_toggled(bool checked)
+{
+    delete scheduler;
+    scheduler = nullptr;
+
+    if (checked)
+    {
+        ui->parallelCheck->setChecked(false);
+        ui->processCheck->setChecked(false);
+    }
+
+    if (checked && environment != nullptr)
+        scheduler = new EventScheduler(environment);
+}
+
+/**
+ * @brief Switches between stepping all robots on one thread and the multi-core mode.
+ * @details The modes are exclusive, checking it unchecks the other modes.
+ * @param checked True to step separate parts of the world on worker threads, one per processor core.
+ */
+void SimulationWidget::parallelCheck_toggled(bool checked)
+{
+    delete regionScheduler;
+    regionScheduler = nullptr;
+
+    if (checked)
+    {
+        ui->eventCheck->setChecked(false);
+        ui->processCheck->setChecked(false);
+    }
+
+    if (checked && environment != nullptr)
+        regionScheduler = new RegionScheduler(environment, qMax(1u, std::thread::hardware_concurrency()));
+}
+
+/**
+ * @brief Switches between simulating in this process and the multi-process mode.
+ * @details The world is split between worker processes, one per processor core, and the robots are painted from
+ * the states gathered after every tick. Checking it unchecks the other modes.
+ * @param checked True to start the worker processes, false to stop them.
+ */
+void SimulationWidget::processCheck_toggled(bool checked)
+{
+#ifdef ROBOTS_MULTIPROCESS
+    delete coordinator;
+    coordinator = nullptr;
+    pendingUpdates.clear();
+
+    if (!checked || environment == nullptr)
+        return;
+
+    ui->eventCheck->setChecked(false);
+    ui->parallelCheck->setChecked(false);
+
+    coordinator = new DistributedCoordinator(environment, qMax(1u, std::thread::hardware_concurrency()));
+    if (!coordinator->Start())
+    {
+        delete coordinator;
+        coordinator = nullptr;
+        QMessageBox::warning(this, tr("Error"), tr("The worker processes cannot be started."));
+        ui->processCheck->setChecked(false);
+        return;
+    }
+#else
+    Q_UNUSED(checked);
+#endif
+}
+
+/**
+ * @brief Tests the changed robots in the next tick of the event-driven mode or sends them to the worker processes.
+ *
+ * Started robots and robots with a new triangle base may be blocked sooner than they were scheduled, and so may the
+ * robots around a robot with a larger triangle.
+ *
+ * @param topLeft The first changed cell of the robot table.
+ * @param bottomRight The last changed cell of the robot table.
+ */
+void SimulationWidget::robotData_changed(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    for (int row = topLeft.row(); row <= bottomRight.row(); row++)
+    {
+        if (scheduler != nullptr)
+        {
+            scheduler->Wake(row + 1);
+
+            // A larger triangle reaches robots which are not due either, they approach it by two steps per tick
+            Robot *robot = environment->GetRobots()[row];
+            double approach = (EventScheduler::MaxSkip + 1) * robot->getMoveDistance();
+            scheduler->WakeNear(robot->sensedArea().adjusted(-approach, -approach, approach, approach));
+        }
+        if (coordinator != nullptr)
+            pendingUpdates.push_back(row + 1);
+    }
 }
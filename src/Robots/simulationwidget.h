@@ -7,8 +7,20 @@
 #ifndef SIMULATIONWIDGET_H
 #define SIMULATIONWIDGET_H
 
+#include "allocationcounter.h"
 #include "environment.h"
+#include "eventscheduler.h"
+#include "mapdiff.h"
+#include "regionscheduler.h"
+#ifdef ROBOTS_MULTIPROCESS
+#include "distributedcoordinator.h"
+#else
+class DistributedCoordinator;
+#endif
 #include "mappainter.h"
+#include "performancemonitor.h"
+#include "robotlistmodel.h"
+#include "timeline.h"
 #include <QWidget>
 #include <QAbstractButton>
 #include "mappainter.h"
@@ -16,12 +28,19 @@
 #include "qradiobutton.h"
 #include "ui_simulationwidget.h"
 #include <QFileDialog>
+#include <QFileSystemWatcher>
 #include <QButtonGroup>
 #include <QKeyEvent>
+#include <QLabel>
 #include <QTimer>
 #include <QSlider>
 #include <QMessageBox>
 #include <QAbstractButton>
+#include <QHeaderView>
+#include <QRubberBand>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QScreen>
 
 namespace Ui {
 class SimulationWidget;
@@ -33,6 +52,7 @@ class SimulationWidget : public QWidget
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 public:
     explicit SimulationWidget(QWidget *parent = nullptr);
@@ -46,7 +66,21 @@ private slots:
     void rightRotate();
     void multiplySpin_valueChanged();
     void reloadButton_clicked();
-    void robotPicker(QAbstractButton*);
+    void startButton_clicked();
+    void stopButton_clicked();
+    void baseButton_clicked();
+    void controlButton_clicked();
+    void robotSelection_changed(const QItemSelection &selected, const QItemSelection &deselected);
+    void robotData_changed(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void eventCheck_toggled(bool checked);
+    void parallelCheck_toggled(bool checked);
+    void processCheck_toggled(bool checked);
+    void hudCheck_toggled(bool checked);
+    void historySlider_valueChanged(int value);
+    void mapFile_changed(const QString &path);
+    void applyMapChanges();
+    void flushRepaint();
+    void updateHud();
 
 Q_SIGNALS:
     void backRequested();
@@ -54,13 +88,43 @@ Q_SIGNALS:
 private:
     Ui::SimulationWidget *ui;
     MapPainter *scene;
+    RobotListModel *robotModel;
     void loadMap();
     void parseFile(std::string filePath);
     Environment *environment;
+    EventScheduler *scheduler;
+    RegionScheduler *regionScheduler;
+    DistributedCoordinator *coordinator;
+    std::vector<int> pendingUpdates;
     void simulate();
+    void step();
+    TickStatistics tickStatistics;
     QTimer *simulationTimer;
     bool simulationRunning = false;
     QString mapFilePath;
+    QRubberBand *rubberBand;
+    QPoint selectionOrigin;
+    void selectRobots(const std::vector<int> &numbers, bool toggle);
+    void toggleObstacle(QPointF pos);
+    QTimer *repaintTimer;
+    QElapsedTimer lastRepaint;
+    int frameInterval;
+    bool fullRepaintPending = false;
+    std::vector<int> dirtyRobots;
+    std::vector<bool> robotDirty;
+    void requestRepaint();
+    void requestRepaint(int number);
+    void scheduleRepaint();
+    PerformanceMonitor monitor;
+    QLabel *hudLabel;
+    QTimer *hudTimer;
+    QElapsedTimer hudClock;
+    Timeline timeline;
+    void updateHistorySlider();
+    QFileSystemWatcher *mapWatcher;
+    QTimer *mapChangeTimer;
+    MapDiff mapDiff;
+    void watchMap();
 };
 
 #endif // SIMULATIONWIDGET_H
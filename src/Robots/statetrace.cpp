@@ -0,0 +1,363 @@
+/**
+* @file statetrace.cpp
+* @brief Implementation of the StateHash class, which hashes the state of the robots, and of the TraceWriter and
+* TraceChecker classes, which write the hashes of a simulation to a trace file and compare a simulation with it.
+* @details A trace starts with a header holding the seed of the random headings and the number of robots. Every tick
+* is stored as the 64-bit hash of the state of all robots, followed by the 32-bit hashes of the robots which changed in
+* the tick, so the checker knows the expected state of every robot and reports which robots diverged. The first
+* record is the loaded map, where all robots are listed. The counts and robot numbers are stored as variable-length
+* integers and the hashes in little endian.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "statetrace.h"
+#include <algorithm>
+
+static const char TraceMagic[4] = { 'R', 'B', 'T', 'R' };
+static const quint64 TraceVersion = 1;
+
+/**
+ * @brief Computes the hash of the state of one robot.
+ * @details The position, direction, base direction, number of heading searches and whether the robot is enabled are
+ * hashed together with its number. Whether the robot sleeps is not, it only saves the tests of the robot.
+ * @param state The state of the robot.
+ * @return The hash of the state.
+ */
+quint64 StateHash::Robot(const Environment::RobotState &state)
+{
+    quint64 hash = mix(0, static_cast<quint32>(state.number));
+    hash = mix(hash, static_cast<quint64>(static_cast<quint32>(state.x)) << 32 | static_cast<quint32>(state.y));
+    hash = mix(hash, static_cast<quint64>(static_cast<quint32>(state.direction)) << 32 | static_cast<quint32>(state.base));
+    hash = mix(hash, static_cast<quint64>(state.turns) << 32 | static_cast<quint32>(state.enabled));
+
+    // Final avalanche of the 64-bit finalizer of MurmurHash3
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Computes the hash of the state of all robots.
+ * @details The hash is the sum of the hashes of the robots, so it does not depend on the order in which they moved.
+ * @param environment The simulated environment.
+ * @param robotHashes Receives the hash of every robot, indexed by robot number - 1.
+ * @return The hash of the state.
+ */
+quint64 StateHash::Compute(Environment &environment, std::vector<quint64> &robotHashes)
+{
+    int count = environment.GetRobots().size();
+    robotHashes.resize(count);
+
+    quint64 hash = 0;
+    for (int number = 1; number <= count; number++)
+    {
+        robotHashes[number - 1] = Robot(environment.GetRobotState(number));
+        hash += robotHashes[number - 1];
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Mixes a value into a hash.
+ * @param hash The hash so far.
+ * @param value The mixed value.
+ * @return The new hash.
+ */
+quint64 StateHash::mix(quint64 hash, quint64 value)
+{
+    hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    hash *= 0xBF58476D1CE4E5B9ull;
+    return hash ^ hash >> 31;
+}
+
+/**
+ * @brief Constructor for the TraceWriter class, nothing is written until Open is called.
+ */
+TraceWriter::TraceWriter()
+    : ticks(0)
+{}
+
+/**
+ * @brief Creates a trace file and records the loaded map as its first record.
+ * @param path Path of the trace file.
+ * @param environment The simulated environment, its seed is stored in the header.
+ * @return False if the file cannot be written.
+ */
+bool TraceWriter::Open(const std::string &path, Environment &environment)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    buffer.assign(TraceMagic, TraceMagic + sizeof(TraceMagic));
+    writeVarint(TraceVersion);
+    writeVarint(environment.GetSeed());
+    writeVarint(environment.GetRobots().size());
+    file.write(buffer.data(), buffer.size());
+
+    previous.clear();
+    ticks = 0;
+    return Record(environment);
+}
+
+/**
+ * @brief Appends the state of the environment after a tick.
+ * @param environment The simulated environment.
+ * @return False if the file cannot be written.
+ */
+bool TraceWriter::Record(Environment &environment)
+{
+    quint64 hash = StateHash::Compute(environment, hashes);
+
+    // The first record lists all robots
+    bool all = previous.size() != hashes.size();
+
+    buffer.clear();
+    for (int i = 0; i < 8; i++)
+        buffer.push_back(static_cast<char>(hash >> (8 * i)));
+
+    int changed = 0;
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        if (all || hashes[i] != previous[i])
+            changed++;
+    }
+
+    writeVarint(changed);
+
+    size_t last = 0;
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        if (!all && hashes[i] == previous[i])
+            continue;
+
+        writeVarint(i + 1 - last);
+        last = i + 1;
+        for (int byte = 0; byte < 4; byte++)
+            buffer.push_back(static_cast<char>(hashes[i] >> (8 * byte)));
+    }
+
+    previous.swap(hashes);
+    file.write(buffer.data(), buffer.size());
+    ticks++;
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Finishes the trace file.
+ * @return False if any write failed.
+ */
+bool TraceWriter::Close()
+{
+    file.close();
+    return !file.fail();
+}
+
+/**
+ * @brief Returns the number of records written, the loaded map and every tick.
+ * @return Number of records.
+ */
+quint64 TraceWriter::GetTicks()
+{
+    return ticks;
+}
+
+/**
+ * @brief Appends an unsigned integer to the buffer in seven bits per byte, the lowest bits first.
+ * @param value The value.
+ */
+void TraceWriter::writeVarint(quint64 value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+
+    buffer.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief Constructor for the TraceChecker class, nothing is read until Open is called.
+ */
+TraceChecker::TraceChecker()
+    : seed(0)
+    , ticks(0)
+    , divergentTick(0)
+    , divergentRobot(0)
+    , divergentCount(0)
+{}
+
+/**
+ * @brief Opens a trace file and reads its header.
+ * @param path Path of the trace file.
+ * @return False if the file cannot be read or is not a trace.
+ */
+bool TraceChecker::Open(const std::string &path)
+{
+    file.open(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    char magic[sizeof(TraceMagic)];
+    quint64 version = 0;
+    quint64 seed = 0;
+    quint64 count = 0;
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), TraceMagic) || !readVarint(version) ||
+        version != TraceVersion || !readVarint(seed) || !readVarint(count))
+        return false;
+
+    this->seed = seed;
+    expected.assign(count, 0);
+    ticks = 0;
+    return true;
+}
+
+/**
+ * @brief Returns the seed of the random headings of the traced simulation.
+ * @return The seed.
+ */
+quint32 TraceChecker::GetSeed()
+{
+    return seed;
+}
+
+/**
+ * @brief Returns the number of robots of the traced simulation.
+ * @return The number of robots.
+ */
+int TraceChecker::GetRobotCount()
+{
+    return expected.size();
+}
+
+/**
+ * @brief Compares the state of the environment with the next record of the trace.
+ * @details The first call compares the loaded map, every following one the state after one more tick. On a
+ * divergence the robots whose state differs from the trace are counted and the lowest numbered one is kept.
+ * @param environment The simulated environment.
+ * @param diverged Set to true if the state differs from the trace.
+ * @return False at the end of the trace.
+ */
+bool TraceChecker::Check(Environment &environment, bool &diverged)
+{
+    diverged = false;
+
+    char bytes[8];
+    quint64 changed = 0;
+    if (!file.read(bytes, sizeof(bytes)) || !readVarint(changed))
+        return false;
+
+    quint64 hash = 0;
+    for (int i = 0; i < 8; i++)
+        hash |= static_cast<quint64>(static_cast<quint8>(bytes[i])) << (8 * i);
+
+    quint64 number = 0;
+    for (quint64 i = 0; i < changed; i++)
+    {
+        quint64 gap = 0;
+        char robot[4];
+        if (!readVarint(gap) || !file.read(robot, sizeof(robot)))
+            return false;
+
+        number += gap;
+        if (number < 1 || number > expected.size())
+            return false;
+
+        quint32 robotHash = 0;
+        for (int byte = 0; byte < 4; byte++)
+            robotHash |= static_cast<quint32>(static_cast<quint8>(robot[byte])) << (8 * byte);
+        expected[number - 1] = robotHash;
+    }
+
+    ticks++;
+    if (environment.GetRobots().size() != expected.size())
+    {
+        diverged = true;
+        divergentTick = ticks - 1;
+        divergentRobot = 0;
+        divergentCount = expected.size();
+        return true;
+    }
+
+    if (StateHash::Compute(environment, hashes) == hash)
+        return true;
+
+    diverged = true;
+    divergentTick = ticks - 1;
+    divergentRobot = 0;
+    divergentCount = 0;
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        if (static_cast<quint32>(hashes[i]) == expected[i])
+            continue;
+
+        if (divergentCount++ == 0)
+            divergentRobot = i + 1;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the number of compared records.
+ * @return Number of records, the loaded map and every tick.
+ */
+quint64 TraceChecker::GetTicks()
+{
+    return ticks;
+}
+
+/**
+ * @brief Returns the tick of the last divergence, 0 is the loaded map.
+ * @return The tick.
+ */
+quint64 TraceChecker::GetDivergentTick()
+{
+    return divergentTick;
+}
+
+/**
+ * @brief Returns the lowest numbered robot whose state differed from the trace in the last divergence.
+ * @return Number of the robot, 0 if the number of robots differs.
+ */
+int TraceChecker::GetDivergentRobot()
+{
+    return divergentRobot;
+}
+
+/**
+ * @brief Returns the number of robots whose state differed from the trace in the last divergence.
+ * @return Number of robots.
+ */
+int TraceChecker::GetDivergentCount()
+{
+    return divergentCount;
+}
+
+/**
+ * @brief Reads an unsigned integer stored in seven bits per byte, the lowest bits first.
+ * @param value Receives the value.
+ * @return False if the file ends.
+ */
+bool TraceChecker::readVarint(quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        char byte;
+        if (!file.get(byte))
+            return false;
+
+        value |= static_cast<quint64>(static_cast<quint8>(byte) & 0x7F) << shift;
+        if ((static_cast<quint8>(byte) & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
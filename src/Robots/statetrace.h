@@ -0,0 +1,70 @@
+/**
+* @file statetrace.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef STATETRACE_H
+#define STATETRACE_H
+
+#include "environment.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+class StateHash
+{
+public:
+    static quint64 Robot(const Environment::RobotState &state);
+    static quint64 Compute(Environment &environment, std::vector<quint64> &robotHashes);
+
+private:
+    static quint64 mix(quint64 hash, quint64 value);
+};
+
+class TraceWriter
+{
+private:
+    std::ofstream file;
+    std::vector<quint64> hashes;
+    std::vector<quint64> previous;
+    std::vector<char> buffer;
+    quint64 ticks;
+
+    void writeVarint(quint64 value);
+
+public:
+    TraceWriter();
+    bool Open(const std::string &path, Environment &environment);
+    bool Record(Environment &environment);
+    bool Close();
+    quint64 GetTicks();
+};
+
+class TraceChecker
+{
+private:
+    std::ifstream file;
+    std::vector<quint64> hashes;
+    std::vector<quint32> expected;
+    quint32 seed;
+    quint64 ticks;
+    quint64 divergentTick;
+    int divergentRobot;
+    int divergentCount;
+
+    bool readVarint(quint64 &value);
+
+public:
+    TraceChecker();
+    bool Open(const std::string &path);
+    quint32 GetSeed();
+    int GetRobotCount();
+    bool Check(Environment &environment, bool &diverged);
+    quint64 GetTicks();
+    quint64 GetDivergentTick();
+    int GetDivergentRobot();
+    int GetDivergentCount();
+};
+
+#endif // STATETRACE_H
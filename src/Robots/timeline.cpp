@@ -0,0 +1,288 @@
+/**
+* @file timeline.cpp
+* @brief Implementation of the Timeline class, the recent history of the simulation for rewinding it.
+* @details The history is split into segments of KeyframeInterval ticks. A segment starts with the full state of all
+* robots, its keyframe, followed by the robots which changed in each of its ticks. A tick is restored from the
+* keyframe of its segment and the changes up to it, so at most KeyframeInterval - 1 ticks of changes are replayed.
+* When the history exceeds its memory, the oldest segment is dropped and its storage is reused for the next one.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "timeline.h"
+
+/**
+ * @brief Constructor for the Timeline class, nothing is recorded until Reset is called.
+ * @param maxBytes Memory of the history in bytes, the newest segment is always kept.
+ */
+Timeline::Timeline(size_t maxBytes)
+    : maxBytes(maxBytes)
+    , currentTick(0)
+    , lastTick(0)
+{}
+
+/**
+ * @brief Forgets the history and records the current state of the environment as tick 0.
+ * @param environment The simulated environment.
+ */
+void Timeline::Reset(Environment &environment)
+{
+    while (!segments.empty())
+    {
+        spare.push_back(std::move(segments.back()));
+        segments.pop_back();
+    }
+
+    currentTick = 0;
+    lastTick = 0;
+    startSegment(environment);
+}
+
+/**
+ * @brief Records the state of the environment after a tick.
+ * @details Only the robots which changed since the previous tick are stored, every KeyframeInterval ticks all robots
+ * are. If an earlier tick was restored, the ticks recorded after it are dropped first.
+ * @param environment The simulated environment.
+ */
+void Timeline::Record(Environment &environment)
+{
+    if (segments.empty() || latest.size() != environment.GetRobots().size())
+    {
+        Reset(environment);
+        return;
+    }
+
+    truncate();
+    currentTick++;
+    lastTick = currentTick;
+
+    Segment &segment = segments.back();
+    if (currentTick - segment.firstTick >= KeyframeInterval)
+    {
+        startSegment(environment);
+        return;
+    }
+
+    for (size_t i = 0; i < latest.size(); i++)
+    {
+        Entry entry = capture(environment, i + 1);
+        if (!same(entry, latest[i]))
+        {
+            segment.changes.push_back(entry);
+            latest[i] = entry;
+        }
+    }
+
+    segment.ends.push_back(segment.changes.size());
+}
+
+/**
+ * @brief Restores the environment to a recorded tick.
+ * @details The ticks after it are kept until the next tick is recorded, so the history can be scrubbed both ways.
+ * @param environment The simulated environment.
+ * @param tick The restored tick.
+ * @return False if the tick is no longer or not yet recorded.
+ */
+bool Timeline::Seek(Environment &environment, quint64 tick)
+{
+    if (segments.empty() || tick < GetFirstTick() || tick > lastTick || latest.size() != environment.GetRobots().size())
+        return false;
+
+    Segment &segment = segmentOf(tick);
+    scratch.assign(segment.keyframe.begin(), segment.keyframe.end());
+
+    quint32 end = tick > segment.firstTick ? segment.ends[tick - segment.firstTick - 1] : 0;
+    for (quint32 i = 0; i < end; i++)
+    {
+        const Entry &entry = segment.changes[i];
+        scratch[entry.number - 1] = entry;
+    }
+
+    restore(environment);
+    latest.swap(scratch);
+    currentTick = tick;
+    return true;
+}
+
+/**
+ * @brief Checks whether anything is recorded.
+ * @return True before the first Reset.
+ */
+bool Timeline::IsEmpty()
+{
+    return segments.empty();
+}
+
+/**
+ * @brief Returns the oldest recorded tick.
+ * @return The first tick of the oldest segment.
+ */
+quint64 Timeline::GetFirstTick()
+{
+    return segments.empty() ? 0 : segments.front().firstTick;
+}
+
+/**
+ * @brief Returns the newest recorded tick.
+ * @return The last recorded tick.
+ */
+quint64 Timeline::GetLastTick()
+{
+    return lastTick;
+}
+
+/**
+ * @brief Returns the tick the environment is in, the last recorded or the last restored one.
+ * @return The current tick.
+ */
+quint64 Timeline::GetCurrentTick()
+{
+    return currentTick;
+}
+
+/**
+ * @brief Reads the state of a robot from the environment.
+ * @param environment The simulated environment.
+ * @param number Number of the robot.
+ * @return The state of the robot.
+ */
+Timeline::Entry Timeline::capture(Environment &environment, int number)
+{
+    Environment::RobotState state = environment.GetRobotState(number);
+
+    Entry entry;
+    entry.number = number;
+    entry.x = state.x;
+    entry.y = state.y;
+    entry.direction = state.direction;
+    entry.base = state.base;
+    entry.turns = state.turns;
+    entry.enabled = state.enabled;
+    entry.sleeping = environment.IsSleeping(number);
+    return entry;
+}
+
+/**
+ * @brief Compares two states of the same robot.
+ * @return True if the states are equal.
+ */
+bool Timeline::same(const Entry &first, const Entry &second)
+{
+    return first.x == second.x && first.y == second.y && first.direction == second.direction && first.base == second.base &&
+           first.turns == second.turns && first.enabled == second.enabled && first.sleeping == second.sleeping;
+}
+
+/**
+ * @brief Starts a new segment with the full state of the environment in the current tick.
+ * @details Segments over the memory of the history are dropped from the oldest one, their storage is reused.
+ * @param environment The simulated environment.
+ */
+void Timeline::startSegment(Environment &environment)
+{
+    while (segments.size() > 1 && bytes() > maxBytes)
+    {
+        spare.push_back(std::move(segments.front()));
+        segments.pop_front();
+    }
+
+    Segment segment;
+    if (!spare.empty())
+    {
+        segment = std::move(spare.back());
+        spare.pop_back();
+    }
+
+    segment.firstTick = currentTick;
+    segment.keyframe.clear();
+    segment.changes.clear();
+    segment.ends.clear();
+
+    int count = environment.GetRobots().size();
+    for (int number = 1; number <= count; number++)
+        segment.keyframe.push_back(capture(environment, number));
+
+    latest.assign(segment.keyframe.begin(), segment.keyframe.end());
+    segments.push_back(std::move(segment));
+}
+
+/**
+ * @brief Drops the ticks recorded after the current tick.
+ */
+void Timeline::truncate()
+{
+    if (currentTick == lastTick)
+        return;
+
+    while (segments.back().firstTick > currentTick)
+    {
+        spare.push_back(std::move(segments.back()));
+        segments.pop_back();
+    }
+
+    Segment &segment = segments.back();
+    segment.ends.resize(currentTick - segment.firstTick);
+    segment.changes.resize(segment.ends.empty() ? 0 : segment.ends.back());
+    lastTick = currentTick;
+}
+
+/**
+ * @brief Computes the memory of the recorded segments.
+ * @return The reserved storage of all segments in bytes.
+ */
+size_t Timeline::bytes()
+{
+    size_t total = 0;
+    for (const Segment &segment : segments)
+        total += (segment.keyframe.capacity() + segment.changes.capacity()) * sizeof(Entry) + segment.ends.capacity() * sizeof(quint32);
+
+    return total;
+}
+
+/**
+ * @brief Finds the segment containing a recorded tick.
+ * @param tick The tick, it has to be recorded.
+ * @return The last segment starting at or before the tick.
+ */
+Timeline::Segment& Timeline::segmentOf(quint64 tick)
+{
+    size_t index = segments.size() - 1;
+    while (segments[index].firstTick > tick)
+        index--;
+
+    return segments[index];
+}
+
+/**
+ * @brief Applies the states in the scratch buffer to the environment.
+ * @details Only the robots differing from the environment are changed. Moving a robot wakes the robots around it,
+ * so whether a robot sleeps is applied after all robots are in place.
+ * @param environment The simulated environment.
+ */
+void Timeline::restore(Environment &environment)
+{
+    for (const Entry &entry : scratch)
+    {
+        Entry current = capture(environment, entry.number);
+        current.sleeping = entry.sleeping;
+        if (same(current, entry))
+            continue;
+
+        Environment::RobotState state;
+        state.number = entry.number;
+        state.x = entry.x;
+        state.y = entry.y;
+        state.direction = entry.direction;
+        state.base = entry.base;
+        state.turns = entry.turns;
+        state.enabled = entry.enabled;
+        environment.SetRobotState(state);
+    }
+
+    for (const Entry &entry : scratch)
+    {
+        if (entry.sleeping && !environment.IsSleeping(entry.number))
+            environment.SleepRobot(entry.number);
+        else if (!entry.sleeping && environment.IsSleeping(entry.number))
+            environment.WakeRobot(entry.number);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+* @file timeline.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include "environment.h"
+#include <deque>
+#include <vector>
+
+class Timeline
+{
+private:
+    /**
+     * @brief Recorded state of one robot.
+     */
+    struct Entry
+    {
+        qint32 number;
+        qint32 x;
+        qint32 y;
+        qint16 direction;
+        qint16 base;
+        quint32 turns;
+        quint8 enabled;
+        quint8 sleeping;
+    };
+
+    /**
+     * @brief Full state of all robots in the first tick and the changed robots of every following tick.
+     * @details The changes of the k-th following tick end at ends[k - 1] and start where the previous tick ends.
+     */
+    struct Segment
+    {
+        quint64 firstTick;
+        std::vector<Entry> keyframe;
+        std::vector<Entry> changes;
+        std::vector<quint32> ends;
+    };
+
+    size_t maxBytes;
+    std::deque<Segment> segments;
+    std::vector<Segment> spare;
+    std::vector<Entry> latest;
+    std::vector<Entry> scratch;
+    quint64 currentTick;
+    quint64 lastTick;
+
+    static Entry capture(Environment &environment, int number);
+    static bool same(const Entry &first, const Entry &second);
+    void startSegment(Environment &environment);
+    void truncate();
+    size_t bytes();
+    Segment& segmentOf(quint64 tick);
+    void restore(Environment &environment);
+
+public:
+    static constexpr int KeyframeInterval = 50;
+
+    explicit Timeline(size_t maxBytes = 64 << 20);
+    void Reset(Environment &environment);
+    void Record(Environment &environment);
+    bool Seek(Environment &environment, quint64 tick);
+    bool IsEmpty();
+    quint64 GetFirstTick();
+    quint64 GetLastTick();
+    quint64 GetCurrentTick();
+};
+
+#endif // TIMELINE_H
@@ -0,0 +1,82 @@
+/**
+* @file trianglecache.cpp
+* @brief Implementation of the TriangleCache class, the triangle geometry of every heading and base.
+* @details The heading of a robot is a whole degree and its base a whole number from 0 to 300, so the triangle is
+* one of a limited number of shapes moved to the position of the robot. The shapes of a base are computed for all
+* 360 headings when the base is first used and kept for the rest of the program, for the collision test and for
+* painting alike.
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#include "trianglecache.h"
+
+std::atomic<const TriangleGeometry*> TriangleCache::tables[TriangleCache::MaxBase + 1] = {};
+std::mutex TriangleCache::mutex;
+
+/**
+ * @brief Returns the geometry of a triangle.
+ * @details Bases outside the range of the cache are computed on every call.
+ * @param heading Heading of the robot in degrees.
+ * @param base Base of the triangle.
+ * @return The corners, the bounds and the collision query, all relative to the vertex.
+ */
+TriangleGeometry TriangleCache::Get(int heading, int base)
+{
+    if (base < 0 || base > MaxBase)
+        return compute(heading, base);
+
+    return table(base)[FixedPoint::Normalize(heading)];
+}
+
+/**
+ * @brief Returns the geometry of all headings of a base, computing it on first use.
+ * @param base Base of the triangle, from 0 to MaxBase.
+ * @return Array of 360 triangles indexed by the heading.
+ */
+const TriangleGeometry* TriangleCache::table(int base)
+{
+    const TriangleGeometry *headings = tables[base].load(std::memory_order_acquire);
+    if (headings)
+        return headings;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    headings = tables[base].load(std::memory_order_relaxed);
+    if (!headings)
+    {
+        TriangleGeometry *computed = new TriangleGeometry[360];
+        for (int heading = 0; heading < 360; heading++)
+            computed[heading] = compute(heading, base);
+
+        headings = computed;
+        tables[base].store(headings, std::memory_order_release);
+    }
+
+    return headings;
+}
+
+/**
+ * @brief Computes the geometry of a triangle.
+ * @param heading Heading of the robot in degrees.
+ * @param base Base of the triangle.
+ * @return The corners, the bounds and the collision query, all relative to the vertex.
+ */
+TriangleGeometry TriangleCache::compute(int heading, int base)
+{
+    // The base is offset from the center line by base / 2.2 on both sides
+    FixedPoint::Vector length = FixedPoint::Polar(base * FixedPoint::One, heading);
+    FixedPoint::Vector left = FixedPoint::Polar(base * FixedPoint::One * 10 / 22, heading - 90);
+    FixedPoint::Vector right = FixedPoint::Polar(base * FixedPoint::One * 10 / 22, heading + 90);
+
+    TriangleGeometry geometry;
+    geometry.left = { length.x + left.x, length.y + left.y };
+    geometry.right = { length.x + right.x, length.y + right.y };
+    geometry.boundsMin = { qMin(0, qMin(geometry.left.x, geometry.right.x)), qMin(0, qMin(geometry.left.y, geometry.right.y)) };
+    geometry.boundsMax = { qMax(0, qMax(geometry.left.x, geometry.right.x)), qMax(0, qMax(geometry.left.y, geometry.right.y)) };
+
+    float cornerX[3] = { float(FixedPoint::ToDouble(geometry.left.x)), float(FixedPoint::ToDouble(geometry.right.x)), 0 };
+    float cornerY[3] = { float(FixedPoint::ToDouble(geometry.left.y)), float(FixedPoint::ToDouble(geometry.right.y)), 0 };
+    geometry.query = CollisionKernel::MakeQuery(cornerX, cornerY);
+
+    return geometry;
+}
@@ -0,0 +1,41 @@
+/**
+* @file trianglecache.h
+* @author Ondrej Janecka
+* @author Rostyslav Kachan
+*/
+
+#ifndef TRIANGLECACHE_H
+#define TRIANGLECACHE_H
+
+#include "collisionkernel.h"
+#include "fixedpoint.h"
+#include <atomic>
+#include <mutex>
+
+/**
+ * @brief Geometry of the triangle of a robot relative to its vertex.
+ */
+struct TriangleGeometry
+{
+    FixedPoint::Vector left;
+    FixedPoint::Vector right;
+    FixedPoint::Vector boundsMin;
+    FixedPoint::Vector boundsMax;
+    CollisionQuery query;
+};
+
+class TriangleCache
+{
+private:
+    static std::atomic<const TriangleGeometry*> tables[];
+    static std::mutex mutex;
+    static const TriangleGeometry* table(int base);
+    static TriangleGeometry compute(int heading, int base);
+
+public:
+    static constexpr int MaxBase = 300;
+
+    static TriangleGeometry Get(int heading, int base);
+};
+
+#endif // TRIANGLECACHE_H